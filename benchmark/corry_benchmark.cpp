@@ -0,0 +1,311 @@
+/**
+ * @file
+ * @brief Microbenchmarks of the reconstruction hot paths on seeded synthetic data
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "core/Corryvreckan.hpp"
+#include "core/clipboard/Clipboard.hpp"
+#include "core/config/ConfigReader.hpp"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+#include "tools/SyntheticData.h"
+#include "tools/kdtree.h"
+
+using namespace corryvreckan;
+
+namespace {
+    // Results of the benchmark bodies are stored here, such that the compiler cannot optimize the computation away
+    volatile double sink = 0.;
+
+    /**
+     * @brief Timing of a single benchmark
+     */
+    struct Result {
+        std::string name;
+        std::string geometry;
+        uint64_t items{0};
+        std::vector<double> seconds;
+    };
+
+    /**
+     * @brief Run a benchmark once to warm up and then repeatedly while measuring the wall-clock time
+     * @param name Name of the benchmark
+     * @param geometry Name of the geometry the benchmark data were generated for
+     * @param repetitions Number of measured repetitions
+     * @param function Body of the benchmark, returning the number of processed items
+     * @return Measured times of all repetitions
+     */
+    Result measure(const std::string& name,
+                   const std::string& geometry,
+                   unsigned int repetitions,
+                   const std::function<uint64_t()>& function) {
+        Result result{name, geometry, function(), {}};
+        for(unsigned int i = 0; i < repetitions; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            auto items = function();
+            auto end = std::chrono::steady_clock::now();
+            result.seconds.push_back(std::chrono::duration<double>(end - start).count());
+            result.items = items;
+        }
+        LOG(STATUS) << name << (geometry.empty() ? "" : " (" + geometry + ")") << ": "
+                    << *std::min_element(result.seconds.begin(), result.seconds.end()) << "s for " << result.items
+                    << " items";
+        return result;
+    }
+
+    /**
+     * @brief Construct all detectors of a geometry file
+     */
+    std::vector<std::shared_ptr<Detector>> load_geometry(const std::filesystem::path& path) {
+        std::ifstream file(path);
+        if(!file) {
+            throw ConfigFileUnavailableError(path);
+        }
+        ConfigReader reader(file, std::filesystem::canonical(path));
+        std::vector<std::shared_ptr<Detector>> detectors;
+        for(auto& config : reader.getConfigurations()) {
+            detectors.push_back(Detector::factory(config));
+        }
+        return detectors;
+    }
+
+    /**
+     * @brief Benchmarks of the unit conversions used for every configuration value and in many log messages
+     */
+    std::vector<Result> benchmark_units(unsigned int repetitions) {
+        const size_t conversions = 1000000;
+        std::vector<Result> results;
+        results.push_back(measure("units_convert", "", repetitions, [&]() {
+            double sum = 0.;
+            for(size_t i = 0; i < conversions; ++i) {
+                sum += static_cast<double>(Units::convert(static_cast<double>(i), (i % 2 == 0) ? "um" : "ns"));
+            }
+            sink = sum;
+            return static_cast<uint64_t>(conversions);
+        }));
+        results.push_back(measure("units_get", "", repetitions, [&]() {
+            double sum = 0.;
+            for(size_t i = 0; i < conversions; ++i) {
+                sum += Units::get<double>(static_cast<double>(i), (i % 2 == 0) ? "mm" : "us");
+            }
+            sink = sum;
+            return static_cast<uint64_t>(conversions);
+        }));
+        return results;
+    }
+
+    /**
+     * @brief Benchmarks of the reconstruction building blocks for one geometry
+     */
+    std::vector<Result>
+    benchmark_geometry(const std::string& geometry, SyntheticData& data, unsigned int repetitions, size_t particles) {
+        std::vector<Result> results;
+
+        // Storing and retrieving the pixels of all detectors per event, as done by every event loader and clustering
+        const size_t events = 100;
+        std::vector<std::vector<PixelVector>> event_pixels;
+        for(size_t event = 0; event < events; ++event) {
+            auto event_particles = data.particles(particles / events, 0., Units::get<double>(10, "us"));
+            std::vector<PixelVector> detector_pixels;
+            for(const auto& detector : data.detectors()) {
+                detector_pixels.push_back(data.pixels(*detector, event_particles));
+            }
+            event_pixels.push_back(std::move(detector_pixels));
+        }
+        results.push_back(measure("clipboard_put_get", geometry, repetitions, [&]() {
+            uint64_t pixels = 0;
+            for(const auto& detector_pixels : event_pixels) {
+                // Only the module manager may clear a clipboard, use a fresh one for every event instead
+                auto clipboard = std::make_shared<Clipboard>();
+                for(size_t i = 0; i < detector_pixels.size(); ++i) {
+                    clipboard->putData(detector_pixels[i], data.detectors()[i]->getName());
+                }
+                for(const auto& detector : data.detectors()) {
+                    pixels += clipboard->getData<Pixel>(detector->getName()).size();
+                }
+            }
+            sink = static_cast<double>(pixels);
+            return static_cast<uint64_t>(event_pixels.size());
+        }));
+
+        // Spatial and temporal neighbour searches in the cluster trees of all detectors, as done by the tracking
+        auto tree_particles = data.particles(particles, 0., Units::get<double>(1, "ms"));
+        std::vector<ClusterVector> detector_clusters;
+        for(const auto& detector : data.detectors()) {
+            detector_clusters.push_back(data.clusters(*detector, tree_particles));
+        }
+        std::vector<KDTree<Cluster>> trees(detector_clusters.size());
+        results.push_back(measure("kdtree_build", geometry, repetitions, [&]() {
+            uint64_t clusters = 0;
+            for(size_t i = 0; i < detector_clusters.size(); ++i) {
+                trees[i].buildTrees(detector_clusters[i]);
+                clusters += detector_clusters[i].size();
+            }
+            return clusters;
+        }));
+        results.push_back(measure("kdtree_time_window", geometry, repetitions, [&]() {
+            uint64_t queries = 0;
+            size_t neighbours = 0;
+            for(size_t i = 0; i < detector_clusters.size(); ++i) {
+                for(const auto& cluster : detector_clusters[i]) {
+                    neighbours += trees[i].getAllElementsInTimeWindow(cluster, Units::get<double>(100, "ns")).size();
+                    queries++;
+                }
+            }
+            sink = static_cast<double>(neighbours);
+            return queries;
+        }));
+        results.push_back(measure("kdtree_space_window", geometry, repetitions, [&]() {
+            uint64_t queries = 0;
+            size_t neighbours = 0;
+            for(size_t i = 0; i < detector_clusters.size(); ++i) {
+                for(const auto& cluster : detector_clusters[i]) {
+                    neighbours += trees[i].getAllElementsInSpaceWindow(cluster, Units::get<double>(200, "um")).size();
+                    queries++;
+                }
+            }
+            sink = static_cast<double>(neighbours);
+            return queries;
+        }));
+
+        // Track fits with both track models
+        for(const auto& model : {std::string("straightline"), std::string("gbl")}) {
+            std::vector<ClusterVector> track_clusters;
+            auto tracks = data.tracks(model, data.particles(particles, 0., Units::get<double>(1, "ms")), track_clusters);
+            results.push_back(measure(model + "_fit", geometry, repetitions, [&]() {
+                double chi2 = 0.;
+                for(const auto& track : tracks) {
+                    track->fit();
+                    chi2 += track->getChi2();
+                }
+                sink = chi2;
+                return static_cast<uint64_t>(tracks.size());
+            }));
+        }
+
+        return results;
+    }
+
+    /**
+     * @brief Write all results in JSON format
+     */
+    void write_results(std::ostream& out, const std::vector<Result>& results, uint64_t seed, unsigned int repetitions) {
+        out.precision(9);
+        out << "{\n  \"seed\": " << seed << ",\n  \"repetitions\": " << repetitions << ",\n  \"benchmarks\": [";
+        for(size_t i = 0; i < results.size(); ++i) {
+            const auto& result = results[i];
+            auto minimum = *std::min_element(result.seconds.begin(), result.seconds.end());
+            auto maximum = *std::max_element(result.seconds.begin(), result.seconds.end());
+            auto mean = std::accumulate(result.seconds.begin(), result.seconds.end(), 0.) /
+                        static_cast<double>(result.seconds.size());
+            out << (i > 0 ? "," : "") << "\n    {\"name\": \"" << result.name << "\", \"geometry\": \"" << result.geometry
+                << "\", \"items\": " << result.items << ", \"min_seconds\": " << minimum << ", \"mean_seconds\": " << mean
+                << ", \"max_seconds\": " << maximum
+                << ", \"items_per_second\": " << static_cast<double>(result.items) / minimum << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+} // namespace
+
+/**
+ * @brief Main function running the benchmarks
+ */
+int main(int argc, const char* argv[]) {
+    Log::addStream(std::cerr);
+    Log::setReportingLevel(LogLevel::STATUS);
+
+    std::vector<std::string> geometries;
+    std::string output;
+    uint64_t seed = 0;
+    unsigned int repetitions = 5;
+    size_t particles = 10000;
+    bool print_help = false;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-h") == 0) {
+            print_help = true;
+        } else if(strcmp(argv[i], "-g") == 0 && (i + 1 < argc)) {
+            geometries.emplace_back(argv[++i]);
+        } else if(strcmp(argv[i], "-o") == 0 && (i + 1 < argc)) {
+            output = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "-s") == 0 && (i + 1 < argc)) {
+            seed = std::stoull(argv[++i]);
+        } else if(strcmp(argv[i], "-r") == 0 && (i + 1 < argc)) {
+            repetitions = static_cast<unsigned int>(std::max(std::stoi(argv[++i]), 1));
+        } else if(strcmp(argv[i], "-n") == 0 && (i + 1 < argc)) {
+            particles = static_cast<size_t>(std::max(std::stoi(argv[++i]), 100));
+        } else if(strcmp(argv[i], "-v") == 0 && (i + 1 < argc)) {
+            try {
+                Log::setReportingLevel(Log::getLevelFromString(std::string(argv[++i])));
+            } catch(std::invalid_argument& e) {
+                LOG(ERROR) << "Invalid verbosity level \"" << std::string(argv[i]) << "\", ignoring overwrite";
+            }
+        } else {
+            LOG(ERROR) << "Unrecognized command line argument \"" << argv[i] << "\"";
+            print_help = true;
+        }
+    }
+
+    if(print_help) {
+        std::cout << "Microbenchmarks of the Corryvreckan reconstruction on synthetic data" << std::endl;
+        std::cout << "Usage: corry_benchmark -g <geometry> [-g <geometry> ...] [-o <file>] [-s <seed>] [-r <repetitions>]"
+                  << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  -g <geometry>     geometry file, the benchmarks are run for each given geometry" << std::endl;
+        std::cout << "  -o <file>         file the JSON results are written to, defaults to standard output" << std::endl;
+        std::cout << "  -s <seed>         seed of the synthetic data, defaults to 0" << std::endl;
+        std::cout << "  -r <repetitions>  number of measured repetitions of each benchmark, defaults to 5" << std::endl;
+        std::cout << "  -n <particles>    number of particles generated per benchmark, defaults to 10000" << std::endl;
+        std::cout << "  -v <level>        verbosity level, defaults to STATUS" << std::endl;
+        std::cout << "  -h                print this help text" << std::endl;
+        return 1;
+    }
+
+    Corryvreckan::add_units();
+
+    std::vector<Result> results;
+    try {
+        auto units = benchmark_units(repetitions);
+        results.insert(results.end(), units.begin(), units.end());
+
+        for(const auto& geometry : geometries) {
+            auto name = std::filesystem::path(geometry).stem().string();
+            LOG(STATUS) << "Running benchmarks for geometry " << name;
+            SyntheticData data(load_geometry(geometry), seed);
+            auto geometry_results = benchmark_geometry(name, data, repetitions, particles);
+            results.insert(results.end(), geometry_results.begin(), geometry_results.end());
+        }
+    } catch(std::exception& e) {
+        LOG(FATAL) << "Benchmark failed: " << e.what();
+        return 1;
+    }
+
+    if(output.empty()) {
+        write_results(std::cout, results, seed, repetitions);
+    } else {
+        std::ofstream file(output);
+        if(!file) {
+            LOG(FATAL) << "Cannot create output file " << output;
+            return 1;
+        }
+        write_results(file, results, seed, repetitions);
+        LOG(STATUS) << "Wrote benchmark results to " << output;
+    }
+    return 0;
+}
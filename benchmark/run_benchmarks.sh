@@ -0,0 +1,34 @@
+#!/bin/bash
+# SPDX-FileCopyrightText: 2024 CERN and the Corryvreckan authors
+# SPDX-License-Identifier: MIT
+
+# Run all benchmarks and collect their JSON results in an output directory:
+# - corry_benchmark: microbenchmarks for all geometries in geometries/
+# - corry: full reconstruction chains on synthetic data, one timing report per configuration
+#
+# Usage: run_benchmarks.sh <directory of the corry executables> <output directory>
+
+ABSOLUTE_PATH="$( cd "$( dirname "${BASH_SOURCE}" )" && pwd )"
+BINARY_DIR="$1"
+OUTPUT_DIR="$2"
+
+if [ -z "${BINARY_DIR}" ] || [ -z "${OUTPUT_DIR}" ]; then
+    echo "Usage: $0 <directory of the corry executables> <output directory>"
+    exit 1
+fi
+mkdir -p "${OUTPUT_DIR}"
+OUTPUT_DIR="$( cd "${OUTPUT_DIR}" && pwd )"
+
+GEOMETRIES=""
+for GEOMETRY in "${ABSOLUTE_PATH}"/geometries/*.conf; do
+    GEOMETRIES="${GEOMETRIES} -g ${GEOMETRY}"
+done
+"${BINARY_DIR}/corry_benchmark" ${GEOMETRIES} -o "${OUTPUT_DIR}/microbenchmarks.json" || exit 1
+
+for CONFIG in "${ABSOLUTE_PATH}"/benchmark_*.conf; do
+    NAME="$( basename "${CONFIG}" .conf )"
+    echo "Running ${NAME}"
+    "${BINARY_DIR}/corry" -c "${CONFIG}" \
+        -o output_directory="${OUTPUT_DIR}" \
+        -o timing_report="${OUTPUT_DIR}/${NAME}.json" || exit 1
+done
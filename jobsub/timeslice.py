@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+
+# SPDX-FileCopyrightText: 2017-2024 CERN and the Corryvreckan authors
+# SPDX-License-Identifier: MIT
+
+"""
+timeslice: process a single run with several Corryvreckan instances
+
+The time range of the run is split into consecutive, disjoint slices.
+Every slice is reconstructed by a separate corry process which receives
+the lower slice edge via the skip_time parameter and the upper slice
+edge via the global run_time parameter. Events are attributed to the
+slice containing their start time, events starting at the upper edge of
+a slice are discarded by the framework and picked up by the next slice.
+
+Afterwards, the histogram files of all slices are merged with hadd, as
+well as optional data files written with the FileWriter module which
+can be read back via the FileReader module, e.g. to run the alignment
+on the combined track sample.
+
+Run
+python timeslice.py --help
+to see the list of command line options.
+
+"""
+import argparse
+import sys
+import logging
+import misc
+import os
+import multiprocessing
+import shlex
+
+# Conversion factors to the framework-internal time unit (nanoseconds)
+time_units = {"ps": 1e-3, "ns": 1., "us": 1e3, "ms": 1e6, "s": 1e9}
+
+def parseTime(inputstr):
+    """ Convert a time string with unit such as '1.5s' to nanoseconds """
+    inputstr = inputstr.strip()
+    for unit in sorted(time_units, key=len, reverse=True):
+        if inputstr.endswith(unit):
+            return float(inputstr[:-len(unit)]) * time_units[unit]
+    # Plain numbers are interpreted in framework-internal units
+    return float(inputstr)
+
+def formatTime(value):
+    """ Format a time in nanoseconds such that it can be passed on the corry command line """
+    return repr(float(value)) + "ns"
+
+def sliceEdges(start, end, slices, length, grid):
+    """ Calculate the edges of all time slices, optionally aligned to the event grid """
+    if length:
+        count = max(1, int(-(-(end - start) // length)))
+    else:
+        count = slices
+        length = (end - start) / slices
+
+    edges = [start]
+    for i in range(1, count):
+        edge = start + i * length
+        if grid:
+            # Align slice edges with the event windows of a fixed-length event definition
+            edge = start + round((edge - start) / grid) * grid
+        if edge > edges[-1] and edge < end:
+            edges.append(edge)
+    edges.append(end)
+    return edges
+
+def runSlice(index, slicedir, cmd, silent):
+    """ Runs a single time slice and stores the log of its output """
+    log = logging.getLogger('timeslice.slice%03d' % index)
+
+    import runner
+
+    try:
+        r = runner.Runner(log, os.path.join(slicedir, "slice%03d" % index), silent)
+        rcode = r.run(cmd)
+    except OSError as e:
+        log.critical("Problem with Corryvreckan execution: Command '%s' resulted in error %s", cmd, e)
+        return 2
+    return rcode
+
+def mergeFiles(log, target, sources):
+    """ Merge ROOT files of all slices in order of the slices """
+    hadd = misc.checkProgram("hadd")
+    if not hadd:
+        log.error("hadd executable not found in PATH, cannot merge '" + os.path.basename(target) + "'")
+        return 1
+
+    missing = [source for source in sources if not os.path.isfile(source)]
+    if missing:
+        log.error("Cannot merge '" + os.path.basename(target) + "', missing output: " + ", ".join(missing))
+        return 1
+
+    import subprocess
+    log.info("Merging " + str(len(sources)) + " files into " + target)
+    return subprocess.call([hadd, "-f", target] + sources)
+
+def main(argv=None):
+    """  main routine of timeslice: parallel processing of time slices of a single run """
+    log = logging.getLogger('timeslice') # set up logging
+    formatter = logging.Formatter('%(name)s(%(levelname)s): %(message)s',"%H:%M:%S")
+    handler_stream = logging.StreamHandler()
+    handler_stream.setFormatter(formatter)
+    log.addHandler(handler_stream)
+
+    if argv is None:
+        argv = sys.argv
+    progName = os.path.basename(argv[0])
+    argv = argv[1:]
+
+    # command line argument parsing
+    parser = argparse.ArgumentParser(prog=progName, description="A tool to reconstruct disjoint time slices of a single run with parallel Corryvreckan instances and to merge their output")
+    parser.add_argument("-c", "--conf-file", "--config", required=True, help="Configuration file with all Corryvreckan algorithms defined", metavar="FILE")
+    parser.add_argument('--option', '-o', action='append', default=[], metavar="NAME=VALUE", help="Further options passed on to every corry instance, e.g. 'Tracking4D.time_cut_abs=10ns'. This switch can be specified several times for multiple options.")
+    parser.add_argument("--start", default="0s", help="Start of the time range to process, including unit. Defaults to 0s", metavar="TIME")
+    parser.add_argument("--end", required=True, help="End of the time range to process, including unit", metavar="TIME")
+    parser.add_argument("-n", "--slices", type=int, help="Number of time slices to split the time range into", metavar="N")
+    parser.add_argument("--slice-length", help="Length of every time slice, including unit. Cannot be used together with --slices", metavar="TIME")
+    parser.add_argument("--event-length", help="Align the slice edges to a grid of fixed event windows of this length, e.g. the event_length of the Metronome module", metavar="TIME")
+    parser.add_argument("--skip-parameter", default="skip_time", help="Configuration key receiving the lower slice edge. Use e.g. 'Metronome.skip_time' to only set it for the module defining the event. Defaults to the global key skip_time", metavar="KEY")
+    parser.add_argument("--histogram-file", default="histograms.root", help="Name of the histogram file written by every slice and of the merged file. Defaults to histograms.root", metavar="FILE")
+    parser.add_argument("--data-file", action='append', default=[], help="Additional ROOT file written by every slice, e.g. by the FileWriter module, to merge. This switch can be specified several times", metavar="FILE")
+    parser.add_argument("--work-dir", default="timeslices", help="Directory in which one subdirectory per slice is created. Defaults to timeslices", metavar="DIR")
+    parser.add_argument("-j", "--cores", metavar='N', type=int, default=multiprocessing.cpu_count(), help="Number of slices processed concurrently, by default the number of cores")
+    parser.add_argument("--no-merge", action="store_true", default=False, help="Do not merge the output files after processing")
+    parser.add_argument("--merge-only", action="store_true", default=False, help="Only merge the output of previously processed slices")
+    parser.add_argument("-v", "--verbosity", default="info", help="Sets the verbosity of log messages where LEVEL is either debug, info, warning or error", metavar="LEVEL")
+    parser.add_argument("-s", "--silent", action="store_true", default=False, help="Suppress non-error (stdout) Corryvreckan output to console")
+    parser.add_argument("--dry-run", action="store_true", default=False, help="Print the commands for every slice but skip the actual Corryvreckan execution")
+    args = parser.parse_args(argv)
+
+    # Try to import the colorer module
+    try:
+        import Colorer
+    except ImportError:
+        pass
+
+    # set the logging level
+    numeric_level = getattr(logging, args.verbosity.upper(), None)
+    if not isinstance(numeric_level, int):
+        log.error('Invalid log level: %s' % args.verbosity)
+        return 2
+    handler_stream.setLevel(numeric_level)
+    log.setLevel(numeric_level)
+
+    if (args.slices is None) == (args.slice_length is None):
+        log.error("Exactly one of --slices and --slice-length has to be specified")
+        return 2
+
+    start = parseTime(args.start)
+    end = parseTime(args.end)
+    if end <= start:
+        log.error("End of the time range has to be after its start")
+        return 2
+    if args.slices is not None and args.slices < 1:
+        log.error("Number of slices has to be positive")
+        return 2
+
+    length = parseTime(args.slice_length) if args.slice_length else None
+    grid = parseTime(args.event_length) if args.event_length else None
+    edges = sliceEdges(start, end, args.slices, length, grid)
+    log.info("Processing " + str(len(edges) - 1) + " time slices between " + args.start + " and " + args.end)
+
+    config = os.path.abspath(args.conf_file)
+    if not os.path.isfile(config):
+        log.critical("Configuration file '" + config + "' not found!")
+        return 1
+
+    workdir = os.path.abspath(args.work_dir)
+    slicedirs = [os.path.join(workdir, "slice%03d" % i) for i in range(len(edges) - 1)]
+
+    if not args.merge_only:
+        # check for Corryvreckan executable
+        corry = misc.checkProgram("corry")
+        if not corry:
+            if not args.dry_run:
+                log.error("Corryvreckan executable not found in PATH!")
+                return 1
+            corry = "corry"
+
+        pool = multiprocessing.Pool(args.cores)
+        results = []
+        for i, slicedir in enumerate(slicedirs):
+            # Every slice writes to its own output directory such that relative output paths do not collide
+            cmd = [corry, "-c", config]
+            for option in args.option:
+                cmd += ["-o", option]
+            cmd += ["-o", args.skip_parameter + "=" + formatTime(edges[i])]
+            cmd += ["-o", "run_time=" + formatTime(edges[i + 1])]
+            cmd += ["-o", "output_directory=\"" + slicedir + "\""]
+            cmd += ["-o", "histogram_file=\"" + args.histogram_file + "\""]
+            log.info("Slice " + str(i) + ": [" + formatTime(edges[i]) + ", " + formatTime(edges[i + 1]) + ")")
+            cmd = " ".join(shlex.quote(token) for token in cmd)
+            log.debug("Executing: " + cmd)
+            if args.dry_run:
+                continue
+
+            os.makedirs(slicedir, exist_ok=True)
+            results.append((i, pool.apply_async(runSlice, (i, slicedir, cmd, args.silent))))
+        pool.close()
+        pool.join()
+
+        failed = [i for i, result in results if result.get() != 0]
+        if failed:
+            log.error("Processing failed for slices " + ", ".join(str(i) for i in failed))
+            return 1
+
+    if args.dry_run or args.no_merge:
+        return 0
+
+    # Merge histogram and data files in slice order
+    rcode = 0
+    for name in [args.histogram_file] + args.data_file:
+        sources = [os.path.join(slicedir, name) for slicedir in slicedirs]
+        if mergeFiles(log, os.path.join(workdir, name), sources) != 0:
+            rcode = 1
+    return rcode
+
+if __name__ == "__main__":
+    sys.exit(main())
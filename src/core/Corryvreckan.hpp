@@ -74,12 +74,13 @@ namespace corryvreckan {
          */
         void terminate();
 
-    private:
         /**
          * @brief Sets the default unit conventions
+         * @note Also used by tools which read configurations without running the framework
          */
-        void add_units();
+        static void add_units();
 
+    private:
         /**
          * @brief Set the default ROOT plot style
          */
@@ -0,0 +1,98 @@
+/**
+ * @file
+ * @brief Implementation of the dense lookup table of masked detector channels
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ChannelMask.hpp"
+
+#include <algorithm>
+
+using namespace corryvreckan;
+
+void ChannelMask::resize(int columns, int rows) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    columns_ = std::max(columns, 0);
+    rows_ = std::max(rows, 0);
+    count_ = 0;
+    masked_.assign(static_cast<size_t>(columns_) * static_cast<size_t>(rows_), false);
+    distance_.clear();
+    outdated_ = false;
+}
+
+void ChannelMask::mask(int id) {
+    if(!covers(id) || masked(id)) {
+        return;
+    }
+    masked_[static_cast<size_t>(id)] = true;
+    ++count_;
+    outdated_ = true;
+}
+
+int ChannelMask::distance(int column, int row) const {
+    // Without masked channels, there is no need to store the distances
+    if(count_ == 0) {
+        return columns_ + rows_;
+    }
+    if(outdated_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(outdated_.load(std::memory_order_relaxed)) {
+            build_distance();
+            outdated_.store(false, std::memory_order_release);
+        }
+    }
+    return distance_[static_cast<size_t>(column) + static_cast<size_t>(columns_) * static_cast<size_t>(row)];
+}
+
+void ChannelMask::build_distance() const {
+    const auto far = columns_ + rows_;
+    const auto width = static_cast<size_t>(columns_);
+    distance_.assign(masked_.size(), far);
+
+    // Chamfer distance transform with unit weights for all eight neighbours, which yields the exact Chebyshev distance
+    for(int row = 0; row < rows_; ++row) {
+        for(int column = 0; column < columns_; ++column) {
+            auto id = static_cast<size_t>(column) + width * static_cast<size_t>(row);
+            auto& value = distance_[id];
+            if(masked_[id]) {
+                value = 0;
+                continue;
+            }
+            if(column > 0) {
+                value = std::min(value, distance_[id - 1] + 1);
+            }
+            if(row > 0) {
+                value = std::min(value, distance_[id - width] + 1);
+                if(column > 0) {
+                    value = std::min(value, distance_[id - width - 1] + 1);
+                }
+                if(column < columns_ - 1) {
+                    value = std::min(value, distance_[id - width + 1] + 1);
+                }
+            }
+        }
+    }
+    for(int row = rows_ - 1; row >= 0; --row) {
+        for(int column = columns_ - 1; column >= 0; --column) {
+            auto id = static_cast<size_t>(column) + width * static_cast<size_t>(row);
+            auto& value = distance_[id];
+            if(column < columns_ - 1) {
+                value = std::min(value, distance_[id + 1] + 1);
+            }
+            if(row < rows_ - 1) {
+                value = std::min(value, distance_[id + width] + 1);
+                if(column < columns_ - 1) {
+                    value = std::min(value, distance_[id + width + 1] + 1);
+                }
+                if(column > 0) {
+                    value = std::min(value, distance_[id + width - 1] + 1);
+                }
+            }
+        }
+    }
+}
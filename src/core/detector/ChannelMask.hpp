@@ -0,0 +1,83 @@
+/**
+ * @file
+ * @brief Dense lookup table of masked detector channels
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CORRYVRECKAN_CHANNELMASK_H
+#define CORRYVRECKAN_CHANNELMASK_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace corryvreckan {
+    /**
+     * @brief Dense bitmap of masked channels on a rectangular grid
+     *
+     * Channels are addressed by the identifier column + columns * row. Next to the mask bit of every channel, the
+     * Chebyshev distance from every channel to the closest masked one is provided, such that checking for masked channels
+     * within a square window around a channel is a single lookup. The distance map is recomputed on first use after the
+     * mask has been changed.
+     */
+    class ChannelMask {
+    public:
+        /**
+         * @brief Set up an empty mask for a grid of channels
+         * @param columns Number of columns of the grid
+         * @param rows Number of rows of the grid
+         */
+        void resize(int columns, int rows);
+
+        /**
+         * @brief Check whether a channel identifier lies on the grid
+         * @param id Channel identifier
+         * @return True if the mask holds a bit for this channel
+         */
+        bool covers(int id) const { return id >= 0 && static_cast<size_t>(id) < masked_.size(); }
+
+        /**
+         * @brief Mask a channel, identifiers not on the grid are ignored
+         * @param id Channel identifier
+         */
+        void mask(int id);
+
+        /**
+         * @brief Mask status of a channel on the grid
+         * @param id Channel identifier, has to be covered by the grid
+         * @return True if the channel is masked
+         */
+        bool masked(int id) const { return masked_[static_cast<size_t>(id)]; }
+
+        /**
+         * @brief Chebyshev distance to the closest masked channel on the grid
+         * @param column Column of the channel, has to be on the grid
+         * @param row Row of the channel, has to be on the grid
+         * @return Distance in channels, larger than any distance on the grid if no channel is masked
+         */
+        int distance(int column, int row) const;
+
+    private:
+        /**
+         * @brief Recalculate the distance map with a forward and a backward pass over the grid
+         */
+        void build_distance() const;
+
+        int columns_{0};
+        int rows_{0};
+        size_t count_{0};
+        std::vector<bool> masked_;
+
+        mutable std::vector<int> distance_;
+        mutable std::atomic<bool> outdated_{false};
+        mutable std::mutex mutex_;
+    };
+} // namespace corryvreckan
+
+#endif // CORRYVRECKAN_CHANNELMASK_H
@@ -356,3 +356,12 @@ XYZVector Detector::getGlobalExtent() const {
     // the extent should always be positive in each direction - take the absolute value of all components
     return XYZVector(fabs(global.X()), fabs(global.Y()), fabs(global.Z()));
 }
+
+void Detector::inPixelBatch(
+    size_t count, const double* local_x, const double* local_y, double* inpixel_x, double* inpixel_y) const {
+    for(size_t i = 0; i < count; ++i) {
+        auto inpixel = inPixel(PositionVector3D<Cartesian3D<double>>(local_x[i], local_y[i], 0));
+        inpixel_x[i] = inpixel.X();
+        inpixel_y[i] = inpixel.Y();
+    }
+}
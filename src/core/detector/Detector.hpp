@@ -29,6 +29,7 @@
 #include <TFormula.h>
 #include <TMatrixD.h>
 
+#include "ChannelMask.hpp"
 #include "core/config/Configuration.hpp"
 #include "core/utils/ROOT.h"
 #include "core/utils/log.h"
@@ -414,6 +415,20 @@ namespace corryvreckan {
          */
         virtual XYVector inPixel(PositionVector3D<Cartesian3D<double>> localPosition) const = 0;
 
+        /**
+         * Transformation of a batch of local positions to in-pixel coordinates, stored as structure of arrays
+         * @param count     Number of positions in the batch
+         * @param local_x   Local x coordinates of the positions on the sensor
+         * @param local_y   Local y coordinates of the positions on the sensor
+         * @param inpixel_x Output array for the in-pixel x coordinates, given in units of length
+         * @param inpixel_y Output array for the in-pixel y coordinates, given in units of length
+         *
+         * The default implementation calls the single-position inPixel for every entry, detector models with a regular
+         * pixel grid override this with a loop the compiler can vectorize.
+         */
+        virtual void inPixelBatch(
+            size_t count, const double* local_x, const double* local_y, double* inpixel_x, double* inpixel_y) const;
+
         /**
          * @brief Transform local coordinates of this detector into global coordinates
          * @param  local Local coordinates in the reference frame of this detector
@@ -547,8 +562,9 @@ namespace corryvreckan {
         // Path of calibration file
         std::optional<std::filesystem::path> m_calibrationfile;
 
-        // List of masked channels
+        // List of masked channels, and dense lookup of the masked channels on the pixel matrix
         std::map<int, bool> m_masked;
+        ChannelMask m_channel_mask;
         std::filesystem::path m_maskfile;
     };
 } // namespace corryvreckan
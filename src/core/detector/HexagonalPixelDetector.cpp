@@ -73,15 +73,7 @@ bool HexagonalPixelDetector::hitMasked(const Track* track, int tolerance) const
     int row = pos.second;
 
     // Check if the pixels around this pixel are masked
-    bool hitmasked = false;
-    for(int r = (row - tolerance); r <= (row + tolerance); r++) {
-        for(int c = (column - tolerance); c <= (column + tolerance); c++) {
-            if(this->masked(c, r))
-                hitmasked = true;
-        }
-    }
-
-    return hitmasked;
+    return masked_within(column, row, tolerance);
 }
 
 // Functions to get row and column from local position
@@ -147,7 +139,7 @@ bool HexagonalPixelDetector::isWithinROI(const Track* track) const {
     // Check that track is within region of interest using winding number algorithm
     auto localIntercept = this->getLocalIntercept(track);
     auto coordinates = std::make_pair(this->getColumn(localIntercept), this->getRow(localIntercept));
-    if(winding_number(coordinates, m_roi) != 0) {
+    if(roi_contains(static_cast<int>(coordinates.first), static_cast<int>(coordinates.second))) {
         return true;
     }
 
@@ -165,7 +157,7 @@ bool HexagonalPixelDetector::isWithinROI(Cluster* cluster) const {
 
     // Loop over all pixels of the cluster
     for(auto& pixel : cluster->pixels()) {
-        if(winding_number(pixel->coordinates(), m_roi) == 0) {
+        if(!roi_contains(pixel->column(), pixel->row())) {
             return false;
         }
     }
@@ -177,7 +169,7 @@ bool HexagonalPixelDetector::isWithinROI(const int col, const int row) const {
         return true;
     }
 
-    return (winding_number(std::make_pair(col, row), m_roi) != 0);
+    return roi_contains(col, row);
 }
 
 XYVector HexagonalPixelDetector::getSize() const {
@@ -94,6 +94,18 @@ namespace corryvreckan {
          */
         XYVector inPixel(PositionVector3D<Cartesian3D<double>> localPosition) const override;
 
+        /**
+         * Transformation of a batch of local positions to in-pixel coordinates, falls back to the per-position hexagon
+         * lookup since the kernel of the rectangular pixel grid does not apply
+         */
+        void inPixelBatch(size_t count,
+                          const double* local_x,
+                          const double* local_y,
+                          double* inpixel_x,
+                          double* inpixel_y) const override {
+            Detector::inPixelBatch(count, local_x, local_y, inpixel_x, inpixel_y);
+        }
+
         /**
          * @brief Check whether given track is within the detector's region-of-interest
          * @param  track The track to be checked
@@ -67,6 +67,13 @@ void PixelDetector::build_axes(const Configuration& config) {
 
     // region of interest:
     m_roi = config.getMatrix<int>("roi", std::vector<std::vector<int>>());
+    build_roi_map();
+
+    // Dense mask of the pixel matrix, keeping channels which have been masked already
+    m_channel_mask.resize(m_nPixels.X(), m_nPixels.Y());
+    for(const auto& channel : m_masked) {
+        m_channel_mask.mask(channel.first);
+    }
 
     if(config.has("mask_file")) {
         auto mask_file = config.getPath("mask_file", true);
@@ -76,6 +83,33 @@ void PixelDetector::build_axes(const Configuration& config) {
     }
 }
 
+void PixelDetector::build_roi_map() {
+    m_roi_map.clear();
+    if(m_roi.empty()) {
+        return;
+    }
+
+    // Evaluate the winding number once for every pixel of the matrix
+    m_roi_map.assign(static_cast<size_t>(m_nPixels.X()) * static_cast<size_t>(m_nPixels.Y()), false);
+    if(m_roi.size() < 3) {
+        LOG(DEBUG) << "No ROI given.";
+        return;
+    }
+    for(int row = 0; row < m_nPixels.Y(); row++) {
+        for(int col = 0; col < m_nPixels.X(); col++) {
+            m_roi_map[static_cast<size_t>(col) + static_cast<size_t>(m_nPixels.X()) * static_cast<size_t>(row)] =
+                (winding_number(std::make_pair(col, row), m_roi) != 0);
+        }
+    }
+}
+
+bool PixelDetector::roi_contains(const int col, const int row) const {
+    if(!m_roi_map.empty() && col >= 0 && col < m_nPixels.X() && row >= 0 && row < m_nPixels.Y()) {
+        return m_roi_map[static_cast<size_t>(col) + static_cast<size_t>(m_nPixels.X()) * static_cast<size_t>(row)];
+    }
+    return (winding_number(std::make_pair(col, row), m_roi) != 0);
+}
+
 void PixelDetector::process_mask_file() {
     // Open the file with masked pixels
     std::ifstream inputMaskFile(m_maskfile, std::ios::in);
@@ -128,15 +162,37 @@ bool PixelDetector::isWithinMatrix(const int col, const int row) const {
 void PixelDetector::maskChannel(int chX, int chY) {
     int channelID = chX + m_nPixels.X() * chY;
     m_masked[channelID] = true;
+    m_channel_mask.mask(channelID);
 }
 
 bool PixelDetector::masked(int chX, int chY) const {
     int channelID = chX + m_nPixels.X() * chY;
+    if(m_channel_mask.covers(channelID)) {
+        return m_channel_mask.masked(channelID);
+    }
     if(m_masked.count(channelID) > 0)
         return true;
     return false;
 }
 
+bool PixelDetector::masked_within(int column, int row, int tolerance) const {
+    // Windows reaching beyond the matrix are probed pixel by pixel, the channel identifiers wrap around the matrix edges
+    if(tolerance >= 0 && column - tolerance >= 0 && column + tolerance < m_nPixels.X() && row - tolerance >= 0 &&
+       row + tolerance < m_nPixels.Y()) {
+        return m_channel_mask.distance(column, row) <= tolerance;
+    }
+
+    bool hitmasked = false;
+    for(int r = (row - tolerance); r <= (row + tolerance); r++) {
+        for(int c = (column - tolerance); c <= (column + tolerance); c++) {
+            if(this->masked(c, r)) {
+                hitmasked = true;
+            }
+        }
+    }
+    return hitmasked;
+}
+
 // Only if detector is not auxiliary
 void PixelDetector::configure_detector(Configuration& config) const {
 
@@ -211,16 +267,7 @@ bool PixelDetector::hitMasked(const Track* track, int tolerance) const {
     int column = static_cast<int>(floor(this->getColumn(localIntercept) + 0.5));
 
     // Check if the pixels around this pixel are masked
-    bool hitmasked = false;
-    for(int r = (row - tolerance); r <= (row + tolerance); r++) {
-        for(int c = (column - tolerance); c <= (column + tolerance); c++) {
-            if(this->masked(c, r)) {
-                hitmasked = true;
-            }
-        }
-    }
-
-    return hitmasked;
+    return masked_within(column, row, tolerance);
 }
 
 // Functions to get row and column from local position
@@ -256,6 +303,21 @@ ROOT::Math::XYVector PixelDetector::inPixel(const PositionVector3D<Cartesian3D<d
     return inPixel(column, row);
 }
 
+void PixelDetector::inPixelBatch(
+    size_t count, const double* local_x, const double* local_y, double* inpixel_x, double* inpixel_y) const {
+    // Same arithmetic as getColumn/getRow and inPixel(column, row), hoisted out of the loop and free of virtual calls
+    const double pitch_x = m_pitch.X();
+    const double pitch_y = m_pitch.Y();
+    const double offset_x = static_cast<double>(m_nPixels.X() - 1) / 2.;
+    const double offset_y = static_cast<double>(m_nPixels.Y() - 1) / 2.;
+    for(size_t i = 0; i < count; ++i) {
+        const double column = local_x[i] / pitch_x + offset_x;
+        const double row = local_y[i] / pitch_y + offset_y;
+        inpixel_x[i] = pitch_x * (column - floor(column + 0.5));
+        inpixel_y[i] = pitch_y * (row - floor(row + 0.5));
+    }
+}
+
 // Check if track position is within ROI:
 bool PixelDetector::isWithinROI(const Track* track) const {
 
@@ -267,7 +329,7 @@ bool PixelDetector::isWithinROI(const Track* track) const {
     // Check that track is within region of interest using winding number algorithm
     auto localIntercept = this->getLocalIntercept(track);
     auto coordinates = std::make_pair(this->getColumn(localIntercept), this->getRow(localIntercept));
-    if(winding_number(coordinates, m_roi) != 0) {
+    if(roi_contains(static_cast<int>(coordinates.first), static_cast<int>(coordinates.second))) {
         return true;
     }
 
@@ -285,7 +347,7 @@ bool PixelDetector::isWithinROI(Cluster* cluster) const {
 
     // Loop over all pixels of the cluster
     for(auto& pixel : cluster->pixels()) {
-        if(winding_number(pixel->coordinates(), m_roi) == 0) {
+        if(!roi_contains(pixel->column(), pixel->row())) {
             return false;
         }
     }
@@ -298,7 +360,7 @@ bool PixelDetector::isWithinROI(const int col, const int row) const {
         return true;
     }
 
-    return (winding_number(std::make_pair(col, row), m_roi) != 0);
+    return roi_contains(col, row);
 }
 
 XYVector PixelDetector::getSize() const { return XYVector(m_pitch.X() * m_nPixels.X(), m_pitch.Y() * m_nPixels.Y()); }
@@ -309,7 +371,7 @@ XYVector PixelDetector::getSize() const { return XYVector(m_pitch.X() * m_nPixel
  *               polygon = vector of vertex points of a polygon V[n+1] with V[n]=V[0]
  *      Return:  wn = the winding number (=0 only when P is outside)
  */
-int PixelDetector::winding_number(std::pair<int, int> probe, std::vector<std::vector<int>> polygon) {
+int PixelDetector::winding_number(std::pair<int, int> probe, const std::vector<std::vector<int>>& polygon) {
     // Two points don't make an area
     if(polygon.size() < 3) {
         LOG(DEBUG) << "No ROI given.";
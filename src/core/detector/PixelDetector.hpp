@@ -113,6 +113,17 @@ namespace corryvreckan {
          */
         XYVector inPixel(PositionVector3D<Cartesian3D<double>> localPosition) const override;
 
+        /**
+         * Transformation of a batch of local positions to in-pixel coordinates on the regular pixel grid
+         * @param count     Number of positions in the batch
+         * @param local_x   Local x coordinates of the positions on the sensor
+         * @param local_y   Local y coordinates of the positions on the sensor
+         * @param inpixel_x Output array for the in-pixel x coordinates, given in units of length
+         * @param inpixel_y Output array for the in-pixel y coordinates, given in units of length
+         */
+        void inPixelBatch(
+            size_t count, const double* local_x, const double* local_y, double* inpixel_x, double* inpixel_y) const override;
+
         /**
          * @brief Check whether given track is within the detector's region-of-interest
          * @param  track The track to be checked
@@ -203,9 +214,16 @@ namespace corryvreckan {
         // Functions to set and check channel masking
         void process_mask_file() override;
 
+        // Check for masked pixels in a square window, using the distance map of the channel mask where possible
+        bool masked_within(int column, int row, int tolerance) const;
+
+        // Evaluate the region of interest for every pixel of the matrix, and look it up
+        void build_roi_map();
+        bool roi_contains(const int col, const int row) const;
+
         // Seems to be used in other coordinate
         inline static int isLeft(std::pair<int, int> pt0, std::pair<int, int> pt1, std::pair<int, int> pt2);
-        static int winding_number(std::pair<int, int> probe, std::vector<std::vector<int>> polygon);
+        static int winding_number(std::pair<int, int> probe, const std::vector<std::vector<int>>& polygon);
 
         // For planar detector
         XYVector m_pitch{};
@@ -213,6 +231,7 @@ namespace corryvreckan {
         TMatrixD m_spatial_resolution_matrix_global{3, 3};
         ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>> m_nPixels{};
         std::vector<std::vector<int>> m_roi{};
+        std::vector<bool> m_roi_map{};
         std::string m_orientation_mode;
     };
 } // namespace corryvreckan
@@ -16,6 +16,22 @@
 using namespace ROOT::Math;
 using namespace corryvreckan;
 
+namespace {
+    // Number of leading entries of a sorted list which are not above the position
+    size_t entries_not_above(const std::vector<unsigned int>& values, double position) {
+        auto end = std::partition_point(
+            values.begin(), values.end(), [position](unsigned int value) { return value <= position; });
+        return static_cast<size_t>(end - values.begin());
+    }
+
+    // Check whether one of the entries enclosing the insertion index of a position, which are the closest ones in a sorted
+    // list, is less than half a pixel away from it
+    bool near_entry(const std::vector<unsigned int>& values, size_t index, double position) {
+        return (index > 0 && fabs(position - static_cast<double>(values[index - 1])) < 0.5) ||
+               (index < values.size() && fabs(position - static_cast<double>(values[index])) < 0.5);
+    }
+} // namespace
+
 PixelModuleDetector::PixelModuleDetector(const Configuration& config) : PixelDetector(config) {
 
     // Auxiliary devices don't have: number_of_pixels, pixel_pitch, spatial_resolution, mask_file, region-of-interest
@@ -55,6 +71,16 @@ void PixelModuleDetector::config_bigpixel(const Configuration& config) {
         transformed_big_pixel_y.push_back(big_pixel_y[i] + i);
         transformed_big_pixel_y.push_back(big_pixel_y[i] + i + 1);
     }
+
+    // first transformed pixel of every big pixel, sorted as well
+    transformed_big_pixel_start_x.clear();
+    for(unsigned int i = 0; i < transformed_big_pixel_x.size(); i = i + 2) {
+        transformed_big_pixel_start_x.push_back(transformed_big_pixel_x[i]);
+    }
+    transformed_big_pixel_start_y.clear();
+    for(unsigned int i = 0; i < transformed_big_pixel_y.size(); i = i + 2) {
+        transformed_big_pixel_start_y.push_back(transformed_big_pixel_y[i]);
+    }
     LOG(DEBUG) << "Numbers of transformed Big Rows (X) : " << transformed_big_pixel_x.size();
     LOG(DEBUG) << "Numbers of transformed Big Columns (Y) : " << transformed_big_pixel_y.size();
 
@@ -70,34 +96,29 @@ void PixelModuleDetector::config_bigpixel(const Configuration& config) {
 // Functions to get row and column from local position// FIXME: Replace with new coordinate transformation
 double PixelModuleDetector::getRow(const PositionVector3D<Cartesian3D<double>> localPosition) const {
 
-    int n_big_y_left = 0;
-    bool is_big_y_pixel = 0;
     double row = 0;
 
     double tempPosition = ((localPosition.Y() + getSize().Y() / 2.) / m_pitch.Y()) - 0.5;
 
-    for(unsigned int i = 0; i < transformed_big_pixel_y.size(); i++) {
-        if(transformed_big_pixel_y[i] <= tempPosition) {
-            n_big_y_left += 1;
-            if(fabs(tempPosition - static_cast<double>(transformed_big_pixel_y[i])) < 0.5) {
-                is_big_y_pixel = true;
-            }
-        } else {
-            if(fabs(tempPosition - static_cast<double>(transformed_big_pixel_y[i])) < 0.5) {
-                is_big_y_pixel = true;
-            }
-            break;
-        }
-    }
+    // The transformed big pixels are sorted, bisect them instead of scanning
+    auto n_big_y_left = entries_not_above(transformed_big_pixel_y, tempPosition);
+    bool is_big_y_pixel = near_entry(transformed_big_pixel_y, n_big_y_left, tempPosition);
 
     if(is_big_y_pixel == true) {
-        for(unsigned int i = 0; i < transformed_big_pixel_y.size(); i = i + 2) {
-            if(fabs(tempPosition - transformed_big_pixel_y[i]) <= 2) {
-                row = (tempPosition - transformed_big_pixel_y[i]) / 2. + big_pixel_y[i / 2] - 0.25;
+        // Last big pixel starting within two pixels of the position
+        auto start = std::partition_point(
+            transformed_big_pixel_start_y.begin(), transformed_big_pixel_start_y.end(), [tempPosition](unsigned int value) {
+                return tempPosition - value >= -2;
+            });
+        if(start != transformed_big_pixel_start_y.begin()) {
+            --start;
+            if(fabs(tempPosition - *start) <= 2) {
+                row = (tempPosition - *start) / 2. +
+                      big_pixel_y[static_cast<size_t>(start - transformed_big_pixel_start_y.begin())] - 0.25;
             }
         }
     } else {
-        row = tempPosition - n_big_y_left / 2.;
+        row = tempPosition - static_cast<int>(n_big_y_left) / 2.;
     }
 
     return row;
@@ -105,34 +126,29 @@ double PixelModuleDetector::getRow(const PositionVector3D<Cartesian3D<double>> l
 
 double PixelModuleDetector::getColumn(const PositionVector3D<Cartesian3D<double>> localPosition) const {
 
-    int n_big_x_left = 0;
-    bool is_big_x_pixel = 0;
     double column = 0;
 
     double tempPosition = ((localPosition.X() + getSize().X() / 2.) / m_pitch.X()) - 0.5;
 
-    for(unsigned int i = 0; i < transformed_big_pixel_x.size(); i++) {
-        if(transformed_big_pixel_x[i] <= tempPosition) {
-            n_big_x_left += 1;
-            if(fabs(tempPosition - static_cast<double>(transformed_big_pixel_x[i])) < 0.5) {
-                is_big_x_pixel = true;
-            }
-        } else {
-            if(fabs(tempPosition - static_cast<double>(transformed_big_pixel_x[i])) < 0.5) {
-                is_big_x_pixel = true;
-            }
-            break;
-        }
-    }
+    // The transformed big pixels are sorted, bisect them instead of scanning
+    auto n_big_x_left = entries_not_above(transformed_big_pixel_x, tempPosition);
+    bool is_big_x_pixel = near_entry(transformed_big_pixel_x, n_big_x_left, tempPosition);
 
     if(is_big_x_pixel == true) {
-        for(unsigned int i = 0; i < transformed_big_pixel_x.size(); i = i + 2) {
-            if(fabs(tempPosition - static_cast<double>(transformed_big_pixel_x[i]) - 0.5) <= 2) {
-                column = (tempPosition - transformed_big_pixel_x[i]) / 2. + big_pixel_x[i / 2] - 0.25;
+        // Last big pixel starting within two pixels of the position
+        auto start = std::partition_point(
+            transformed_big_pixel_start_x.begin(), transformed_big_pixel_start_x.end(), [tempPosition](unsigned int value) {
+                return tempPosition - static_cast<double>(value) - 0.5 >= -2;
+            });
+        if(start != transformed_big_pixel_start_x.begin()) {
+            --start;
+            if(fabs(tempPosition - static_cast<double>(*start) - 0.5) <= 2) {
+                column = (tempPosition - *start) / 2. +
+                         big_pixel_x[static_cast<size_t>(start - transformed_big_pixel_start_x.begin())] - 0.25;
             }
         }
     } else {
-        column = tempPosition - n_big_x_left / 2.;
+        column = tempPosition - static_cast<int>(n_big_x_left) / 2.;
     }
 
     return column;
@@ -141,39 +157,12 @@ double PixelModuleDetector::getColumn(const PositionVector3D<Cartesian3D<double>
 // Function to get local position from row and column
 PositionVector3D<Cartesian3D<double>> PixelModuleDetector::getLocalPosition(double column, double row) const {
 
-    int n_big_x_left = 0;
-    bool is_big_x_pixel = 0;
-    int n_big_y_left = 0;
-    bool is_big_y_pixel = 0;
     double col_integer, row_integer;
 
-    for(unsigned int i = 0; i < big_pixel_x.size(); i++) {
-        if(big_pixel_x[i] <= column - 0.5) {
-            n_big_x_left += 1;
-            if(fabs(column - big_pixel_x[i]) < 0.5) {
-                is_big_x_pixel = true;
-            }
-        } else {
-            if(fabs(column - big_pixel_x[i]) < 0.5) {
-                is_big_x_pixel = true;
-            }
-            break;
-        }
-    }
-
-    for(unsigned int i = 0; i < big_pixel_y.size(); i++) {
-        if(big_pixel_y[i] <= row - 0.5) {
-            n_big_y_left += 1;
-            if(fabs(row - big_pixel_y[i]) < 0.5) {
-                is_big_y_pixel = true;
-            }
-        } else {
-            if(fabs(row - big_pixel_y[i]) < 0.5) {
-                is_big_y_pixel = true;
-            }
-            break;
-        }
-    }
+    auto n_big_x_left = static_cast<int>(entries_not_above(big_pixel_x, column - 0.5));
+    bool is_big_x_pixel = near_entry(big_pixel_x, static_cast<size_t>(n_big_x_left), column);
+    auto n_big_y_left = static_cast<int>(entries_not_above(big_pixel_y, row - 0.5));
+    bool is_big_y_pixel = near_entry(big_pixel_y, static_cast<size_t>(n_big_y_left), row);
 
     return PositionVector3D<Cartesian3D<double>>(
         m_pitch.X() * (column + 0.5 + n_big_x_left + (is_big_x_pixel ? std::modf((column + 0.5), &col_integer) : 0)) -
@@ -195,22 +184,8 @@ double PixelModuleDetector::getPixelArea(int column, int row) const {
 }
 
 XYVector PixelModuleDetector::getSpatialResolution(double column = 0, double row = 0) const {
-    bool is_big_x_pixel = 0;
-    bool is_big_y_pixel = 0;
-
-    for(unsigned int i = 0; i < big_pixel_x.size(); i++) {
-        if(fabs(column - big_pixel_x[i]) < 0.5) {
-            is_big_x_pixel = true;
-            break;
-        }
-    }
-
-    for(unsigned int i = 0; i < big_pixel_y.size(); i++) {
-        if(fabs(row - big_pixel_y[i]) < 0.5) {
-            is_big_y_pixel = true;
-            break;
-        }
-    }
+    bool is_big_x_pixel = near_entry(big_pixel_x, entries_not_above(big_pixel_x, column), column);
+    bool is_big_y_pixel = near_entry(big_pixel_y, entries_not_above(big_pixel_y, row), row);
 
     double resolution_x = is_big_x_pixel ? m_big_pixel_spatial_resolution.x() : m_spatial_resolution.x();
     double resolution_y = is_big_y_pixel ? m_big_pixel_spatial_resolution.y() : m_spatial_resolution.y();
@@ -40,6 +40,18 @@ namespace corryvreckan {
         double getRow(const PositionVector3D<Cartesian3D<double>> localPosition) const override;
         double getColumn(const PositionVector3D<Cartesian3D<double>> localPosition) const override;
 
+        /**
+         * Transformation of a batch of local positions to in-pixel coordinates, falls back to the per-position
+         * calculation since the big pixels break the regular grid assumed by the kernel of the base class
+         */
+        void inPixelBatch(size_t count,
+                          const double* local_x,
+                          const double* local_y,
+                          double* inpixel_x,
+                          double* inpixel_y) const override {
+            Detector::inPixelBatch(count, local_x, local_y, inpixel_x, inpixel_y);
+        }
+
         // Function to get local position from column (x) and row (y) coordinates
         PositionVector3D<Cartesian3D<double>> getLocalPosition(double column, double row) const override;
 
@@ -78,6 +90,8 @@ namespace corryvreckan {
         std::vector<unsigned int> big_pixel_y{};
         std::vector<unsigned int> transformed_big_pixel_x{};
         std::vector<unsigned int> transformed_big_pixel_y{};
+        std::vector<unsigned int> transformed_big_pixel_start_x{};
+        std::vector<unsigned int> transformed_big_pixel_start_y{};
         XYVector m_big_pixel_spatial_resolution{};
     };
 
@@ -100,6 +100,15 @@ void PolarDetector::build_axes(const Configuration& config) {
 
     // region of interest:
     m_roi = config.getMatrix<int>("roi", std::vector<std::vector<int>>());
+    build_roi_map();
+
+    // Dense mask of all strip identifiers, keeping channels which have been masked already
+    if(!number_of_strips.empty()) {
+        m_channel_mask.resize(nPixels().X() + nPixels().Y() - 1, 1);
+    }
+    for(const auto& channel : m_masked) {
+        m_channel_mask.mask(channel.first);
+    }
 
     if(config.has("mask_file")) {
         auto mask_file = config.getPath("mask_file", true);
@@ -109,6 +118,37 @@ void PolarDetector::build_axes(const Configuration& config) {
     }
 }
 
+void PolarDetector::build_roi_map() {
+    m_roi_map.clear();
+    if(m_roi.empty() || number_of_strips.empty()) {
+        return;
+    }
+
+    // Evaluate the winding number once for every strip index
+    const auto strips = nPixels();
+    m_roi_map.assign(static_cast<size_t>(strips.X()) * static_cast<size_t>(strips.Y()), false);
+    if(m_roi.size() < 3) {
+        LOG(DEBUG) << "No ROI given.";
+        return;
+    }
+    for(int row = 0; row < strips.Y(); row++) {
+        for(int col = 0; col < strips.X(); col++) {
+            m_roi_map[static_cast<size_t>(col) + static_cast<size_t>(strips.X()) * static_cast<size_t>(row)] =
+                (winding_number(std::make_pair(col, row), m_roi) != 0);
+        }
+    }
+}
+
+bool PolarDetector::roi_contains(const int col, const int row) const {
+    if(!m_roi_map.empty()) {
+        const auto strips = nPixels();
+        if(col >= 0 && col < strips.X() && row >= 0 && row < strips.Y()) {
+            return m_roi_map[static_cast<size_t>(col) + static_cast<size_t>(strips.X()) * static_cast<size_t>(row)];
+        }
+    }
+    return (winding_number(std::make_pair(col, row), m_roi) != 0);
+}
+
 void PolarDetector::process_mask_file() {
     // Open the file with masked pixels
     std::ifstream inputMaskFile(m_maskfile, std::ios::in);
@@ -190,10 +230,14 @@ void PolarDetector::configure_pos_and_orientation(Configuration& config) const {
 void PolarDetector::maskChannel(int chX, int chY) {
     int channelID = chX + chY;
     m_masked[channelID] = true;
+    m_channel_mask.mask(channelID);
 }
 
 bool PolarDetector::masked(int chX, int chY) const {
     int channelID = chX + chY;
+    if(m_channel_mask.covers(channelID)) {
+        return m_channel_mask.masked(channelID);
+    }
     if(m_masked.count(channelID) > 0)
         return true;
     return false;
@@ -210,6 +254,13 @@ bool PolarDetector::hitMasked(const Track* track, int tolerance) const {
     int row = static_cast<int>(floor(this->getRow(localIntercept) + 0.5));
     int column = static_cast<int>(floor(this->getColumn(localIntercept) + 0.5));
 
+    // The strips around this strip cover the channel identifiers within twice the tolerance, look them up at once when
+    // they are all part of the dense mask
+    int channelID = column + row;
+    if(m_channel_mask.covers(channelID - 2 * tolerance) && m_channel_mask.covers(channelID + 2 * tolerance)) {
+        return m_channel_mask.distance(channelID, 0) <= 2 * tolerance;
+    }
+
     // Check if the strips around this strip are masked
     bool hitmasked = false;
     for(int r = (row - tolerance); r <= (row + tolerance); r++) {
@@ -373,7 +424,7 @@ bool PolarDetector::isWithinROI(const Track* track) const {
     // Check that track is within region of interest using winding number algorithm
     auto localIntercept = this->getLocalIntercept(track);
     auto coordinates = std::make_pair(this->getColumn(localIntercept), this->getRow(localIntercept));
-    if(winding_number(coordinates, m_roi) != 0) {
+    if(roi_contains(static_cast<int>(coordinates.first), static_cast<int>(coordinates.second))) {
         return true;
     }
 
@@ -389,7 +440,7 @@ bool PolarDetector::isWithinROI(Cluster* cluster) const {
 
     // Loop over all pixels of the cluster
     for(auto& pixel : cluster->pixels()) {
-        if(winding_number(pixel->coordinates(), m_roi) == 0) {
+        if(!roi_contains(pixel->column(), pixel->row())) {
             return false;
         }
     }
@@ -402,7 +453,7 @@ bool PolarDetector::isWithinROI(const int col, const int row) const {
         return true;
     }
 
-    return (winding_number(std::make_pair(col, row), m_roi) != 0);
+    return roi_contains(col, row);
 }
 
 XYVector PolarDetector::getSize() const {
@@ -551,7 +602,7 @@ int PolarDetector::isLeft(std::pair<int, int> pt0, std::pair<int, int> pt1, std:
  *               polygon = vector of vertex points of a polygon V[n+1] with V[n]=V[0]
  *      Return:  wn = the winding number (=0 only when P is outside)
  */
-int PolarDetector::winding_number(std::pair<int, int> probe, std::vector<std::vector<int>> polygon) {
+int PolarDetector::winding_number(std::pair<int, int> probe, const std::vector<std::vector<int>>& polygon) {
     // Two points don't make an area
     if(polygon.size() < 3) {
         LOG(DEBUG) << "No ROI given.";
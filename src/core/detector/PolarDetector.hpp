@@ -300,13 +300,18 @@ namespace corryvreckan {
         // Functions to set and check channel masking
         void process_mask_file() override;
 
+        // Evaluate the region of interest for every strip index, and look it up
+        void build_roi_map();
+        bool roi_contains(const int col, const int row) const;
+
         // Seems to be used in other coordinate
         inline static int isLeft(std::pair<int, int> pt0, std::pair<int, int> pt1, std::pair<int, int> pt2);
-        static int winding_number(std::pair<int, int> probe, std::vector<std::vector<int>> polygon);
+        static int winding_number(std::pair<int, int> probe, const std::vector<std::vector<int>>& polygon);
 
         // For planar detector
         TMatrixD m_spatial_resolution_matrix_global{3, 3};
         std::vector<std::vector<int>> m_roi{};
+        std::vector<bool> m_roi_map{};
 
         // For polar detectors
         std::vector<unsigned int> number_of_strips{};
@@ -0,0 +1,264 @@
+/**
+ * @file
+ * @brief Implementation of the live metrics of the event loop
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Metrics.hpp"
+#include "core/utils/log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace corryvreckan;
+
+namespace {
+#ifdef MSG_NOSIGNAL
+    // Do not raise SIGPIPE when a client closes the connection early
+    const int send_flags = MSG_NOSIGNAL;
+#else
+    const int send_flags = 0;
+#endif
+
+    /**
+     * @brief Resident set size of this process from the proc file system
+     * @return Resident memory in bytes, zero if not available
+     */
+    uint64_t resident_memory() {
+        std::ifstream statm("/proc/self/statm");
+        uint64_t size = 0, resident = 0;
+        if(!(statm >> size >> resident)) {
+            return 0;
+        }
+        return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    /**
+     * @brief Escape a label value of the Prometheus text format
+     */
+    std::string escape(const std::string& value) {
+        std::string escaped;
+        for(const auto character : value) {
+            if(character == '\\' || character == '"') {
+                escaped += '\\';
+            }
+            escaped += character;
+        }
+        return escaped;
+    }
+} // namespace
+
+Metrics::Metrics(std::vector<std::pair<std::string, const TimingRecord*>> modules,
+                 std::string file,
+                 uint16_t port,
+                 std::chrono::nanoseconds interval)
+    : modules_(std::move(modules)), file_(std::move(file)), port_(port), interval_(interval) {
+    if(port_ > 0) {
+        open_server();
+    }
+    if(!file_.empty()) {
+        LOG(STATUS) << "Writing metrics to " << file_;
+    }
+
+    last_update_ = std::chrono::steady_clock::now();
+    thread_ = std::thread(&Metrics::loop, this);
+}
+
+Metrics::~Metrics() {
+    stop_ = true;
+    if(thread_.joinable()) {
+        thread_.join();
+    }
+    if(server_ >= 0) {
+        close(server_);
+    }
+}
+
+void Metrics::recordEvent(uint64_t events, uint64_t pixels, uint64_t tracks) {
+    events_.store(events, std::memory_order_relaxed);
+    pixels_.store(pixels, std::memory_order_relaxed);
+    tracks_.store(tracks, std::memory_order_relaxed);
+}
+
+void Metrics::loop() {
+    auto next_update = last_update_ + interval_;
+    while(!stop_) {
+        auto now = std::chrono::steady_clock::now();
+        if(now >= next_update) {
+            update_rates(now);
+            if(!file_.empty()) {
+                write_file();
+            }
+            next_update = now + interval_;
+        }
+
+        // Wake up at least every 100ms to react to the stop request
+        auto timeout = std::clamp(std::chrono::duration_cast<std::chrono::milliseconds>(next_update - now),
+                                  std::chrono::milliseconds(1),
+                                  std::chrono::milliseconds(100));
+        if(server_ >= 0) {
+            serve(timeout);
+        } else {
+            std::this_thread::sleep_for(timeout);
+        }
+    }
+
+    // Final state of the run
+    update_rates(std::chrono::steady_clock::now());
+    if(!file_.empty()) {
+        write_file();
+    }
+}
+
+void Metrics::update_rates(std::chrono::steady_clock::time_point now) {
+    auto elapsed = std::chrono::duration<double>(now - last_update_).count();
+    if(elapsed <= 0.) {
+        return;
+    }
+
+    auto events = events_.load(std::memory_order_relaxed);
+    auto pixels = pixels_.load(std::memory_order_relaxed);
+    auto tracks = tracks_.load(std::memory_order_relaxed);
+    events_rate_ = static_cast<double>(events - last_events_) / elapsed;
+    pixels_rate_ = static_cast<double>(pixels - last_pixels_) / elapsed;
+    tracks_rate_ = static_cast<double>(tracks - last_tracks_) / elapsed;
+
+    last_update_ = now;
+    last_events_ = events;
+    last_pixels_ = pixels;
+    last_tracks_ = tracks;
+}
+
+std::string Metrics::render() const {
+    std::ostringstream out;
+    out.precision(9);
+
+    auto metric = [&out](const std::string& name, const std::string& type, const std::string& help) {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+    };
+
+    metric("corry_events_total", "counter", "Number of processed events");
+    out << "corry_events_total " << events_.load(std::memory_order_relaxed) << "\n";
+    metric("corry_pixels_total", "counter", "Number of processed pixels");
+    out << "corry_pixels_total " << pixels_.load(std::memory_order_relaxed) << "\n";
+    metric("corry_tracks_total", "counter", "Number of reconstructed tracks");
+    out << "corry_tracks_total " << tracks_.load(std::memory_order_relaxed) << "\n";
+
+    metric("corry_events_per_second", "gauge", "Processed events per second during the last interval");
+    out << "corry_events_per_second " << events_rate_ << "\n";
+    metric("corry_pixels_per_second", "gauge", "Processed pixels per second during the last interval");
+    out << "corry_pixels_per_second " << pixels_rate_ << "\n";
+    metric("corry_tracks_per_second", "gauge", "Reconstructed tracks per second during the last interval");
+    out << "corry_tracks_per_second " << tracks_rate_ << "\n";
+
+    metric("corry_module_latency_seconds", "summary", "Wall-clock time spent per event in each module");
+    for(const auto& [name, record] : modules_) {
+        auto label = "module=\"" + escape(name) + "\"";
+        for(const auto& [probability, text] : {std::make_pair(0.5, "0.5"), std::make_pair(0.99, "0.99")}) {
+            auto value = record->quantile(probability);
+            out << "corry_module_latency_seconds{" << label << ",quantile=\"" << text << "\"} ";
+            if(std::isnan(value)) {
+                out << "NaN\n";
+            } else {
+                out << value << "\n";
+            }
+        }
+        out << "corry_module_latency_seconds_sum{" << label << "} " << record->total() << "\n";
+        out << "corry_module_latency_seconds_count{" << label << "} " << record->count() << "\n";
+    }
+
+    auto rss = resident_memory();
+    if(rss > 0) {
+        metric("corry_resident_memory_bytes", "gauge", "Resident set size of the process");
+        out << "corry_resident_memory_bytes " << rss << "\n";
+    }
+
+    return out.str();
+}
+
+void Metrics::write_file() const {
+    // Write to a temporary file first and rename it, readers never see a partially written file
+    auto temporary = file_ + ".tmp";
+    std::ofstream file(temporary, std::ios::trunc);
+    file << render();
+    file.close();
+    if(!file) {
+        LOG(WARNING) << "Could not write metrics to " << temporary;
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, file_, error);
+    if(error) {
+        LOG(WARNING) << "Could not write metrics to " << file_ << ": " << error.message();
+    }
+}
+
+void Metrics::open_server() {
+    server_ = socket(AF_INET, SOCK_STREAM, 0);
+    if(server_ < 0) {
+        LOG(ERROR) << "Could not create socket for the metrics endpoint";
+        return;
+    }
+
+    int reuse = 1;
+    setsockopt(server_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Only listen on the loopback interface
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port_);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(server_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(server_, 8) < 0) {
+        LOG(ERROR) << "Could not serve metrics on port " << port_ << ", endpoint disabled";
+        close(server_);
+        server_ = -1;
+        return;
+    }
+    LOG(STATUS) << "Serving metrics on http://localhost:" << port_ << "/metrics";
+}
+
+void Metrics::serve(std::chrono::milliseconds timeout) const {
+    pollfd descriptor{server_, POLLIN, 0};
+    if(poll(&descriptor, 1, static_cast<int>(timeout.count())) <= 0) {
+        return;
+    }
+    int client = accept(server_, nullptr, nullptr);
+    if(client < 0) {
+        return;
+    }
+
+    // The request itself is not evaluated, every path returns the metrics. Do not wait forever for silent clients.
+    timeval receive_timeout{1, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+    char request[1024];
+    recv(client, request, sizeof(request), 0);
+
+    auto body = render();
+    auto response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                    std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while(sent < response.size()) {
+        auto bytes = send(client, response.data() + sent, response.size() - sent, send_flags);
+        if(bytes <= 0) {
+            break;
+        }
+        sent += static_cast<size_t>(bytes);
+    }
+    close(client);
+}
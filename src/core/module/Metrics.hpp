@@ -0,0 +1,132 @@
+/**
+ * @file
+ * @brief Definition of the live metrics of the event loop
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CORRYVRECKAN_METRICS_H
+#define CORRYVRECKAN_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Timing.hpp"
+
+namespace corryvreckan {
+    /**
+     * @ingroup Managers
+     * @brief Live metrics of a running reconstruction, exported in the Prometheus text format
+     *
+     * The event loop records the number of processed events, pixels and tracks, which only consists of relaxed atomic
+     * updates. The wall-clock time spent in every module per event is read from the timing records of the module manager.
+     * All other work is done by a background thread: every interval it derives the processing rates and, if configured,
+     * rewrites the metrics file. It also answers HTTP requests on a local port with the current metrics, such that the
+     * process can be scraped directly.
+     */
+    class Metrics {
+    public:
+        /**
+         * @brief Start exporting the metrics
+         * @param modules Unique names and timing records of all modules, in the order of execution
+         * @param file File the metrics are periodically written to, disabled if empty
+         * @param port Local TCP port serving the metrics via HTTP, disabled if zero
+         * @param interval Interval between two updates of the rates and the metrics file
+         */
+        Metrics(std::vector<std::pair<std::string, const TimingRecord*>> modules,
+                std::string file,
+                uint16_t port,
+                std::chrono::nanoseconds interval);
+
+        /**
+         * @brief Stop the background thread and write the metrics file a last time
+         */
+        ~Metrics();
+
+        /// @{
+        /**
+         * @brief Copying or moving the metrics is not allowed
+         */
+        Metrics(const Metrics&) = delete;
+        Metrics& operator=(const Metrics&) = delete;
+        Metrics(Metrics&&) = delete;
+        Metrics& operator=(Metrics&&) = delete;
+        /// @}
+
+        /**
+         * @brief Record the totals after an event has been processed
+         * @param events Number of events processed so far
+         * @param pixels Number of pixels processed so far
+         * @param tracks Number of tracks reconstructed so far
+         */
+        void recordEvent(uint64_t events, uint64_t pixels, uint64_t tracks);
+
+    private:
+        /**
+         * @brief Background thread updating the rates, writing the file and serving HTTP requests
+         */
+        void loop();
+
+        /**
+         * @brief Derive the processing rates since the last update
+         * @param now Time of this update
+         */
+        void update_rates(std::chrono::steady_clock::time_point now);
+
+        /**
+         * @brief Render all metrics in the Prometheus text exposition format
+         * @return Text of all metrics
+         */
+        std::string render() const;
+
+        /**
+         * @brief Replace the metrics file by the current metrics
+         */
+        void write_file() const;
+
+        /**
+         * @brief Open the listening socket of the HTTP endpoint on the loopback interface
+         */
+        void open_server();
+
+        /**
+         * @brief Wait for and answer a single HTTP request
+         * @param timeout Maximum time to wait for an incoming connection
+         */
+        void serve(std::chrono::milliseconds timeout) const;
+
+        std::vector<std::pair<std::string, const TimingRecord*>> modules_;
+        std::atomic<uint64_t> events_{0};
+        std::atomic<uint64_t> pixels_{0};
+        std::atomic<uint64_t> tracks_{0};
+
+        // Only accessed by the background thread
+        std::chrono::steady_clock::time_point last_update_;
+        uint64_t last_events_{0};
+        uint64_t last_pixels_{0};
+        uint64_t last_tracks_{0};
+        double events_rate_{0.};
+        double pixels_rate_{0.};
+        double tracks_rate_{0.};
+
+        std::string file_;
+        uint16_t port_;
+        std::chrono::nanoseconds interval_;
+        int server_{-1};
+
+        std::atomic<bool> stop_{false};
+        std::thread thread_;
+    };
+} // namespace corryvreckan
+
+#endif // CORRYVRECKAN_METRICS_H
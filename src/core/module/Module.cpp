@@ -129,6 +129,25 @@ TDirectory* Module::getROOTDirectory() const {
 }
 void Module::set_ROOT_directory(TDirectory* directory) { directory_ = directory; }
 
+void Module::merge_histograms() {
+    for(auto& histogram : histograms_) {
+        histogram->merge();
+    }
+}
+
+ScopedTimer Module::scoped_timer(const std::string& name) {
+    TimingRecord* record = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(sub_timers_mutex_);
+        auto& entry = sub_timers_[name];
+        if(!entry) {
+            entry = std::make_unique<TimingRecord>();
+        }
+        record = entry.get();
+    }
+    return ScopedTimer(*record);
+}
+
 std::shared_ptr<Detector> Module::get_detector(const std::string& name) const {
     auto it = find_if(
         m_detectors.begin(), m_detectors.end(), [&name](std::shared_ptr<Detector> obj) { return obj->getName() == name; });
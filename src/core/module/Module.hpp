@@ -12,9 +12,15 @@
 #ifndef CORRYVRECKAN_MODULE_H
 #define CORRYVRECKAN_MODULE_H
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "ModuleIdentifier.hpp"
+#include "ThreadedHistogram.hpp"
+#include "Timing.hpp"
 #include "core/clipboard/Clipboard.hpp"
 #include "core/config/ConfigManager.hpp"
 #include "core/detector/Detector.hpp"
@@ -200,6 +206,31 @@ namespace corryvreckan {
          */
         bool has_detector(const std::string& name) const;
 
+        /**
+         * @brief Book a histogram which can safely be filled from several threads concurrently
+         * @param args Arguments forwarded to the constructor of the ROOT histogram
+         * @return Pointer to the booked histogram, owned by the module
+         *
+         * The histogram is created in the ROOT directory of the module. Worker threads fill their own clones, which are
+         * merged into it by the framework before the module is finalized.
+         */
+        template <typename T, typename... Args> ThreadedHistogram<T>* book_histogram(Args&&... args) {
+            auto histogram = std::make_unique<ThreadedHistogram<T>>(std::forward<Args>(args)...);
+            auto* pointer = histogram.get();
+            histograms_.push_back(std::move(histogram));
+            return pointer;
+        }
+
+        /**
+         * @brief Start a named sub-timer measuring the wall-clock time until the end of the current scope
+         * @param name Name of the timed section, unique within the module
+         * @return Timer recording the elapsed time when it goes out of scope
+         *
+         * The time of all sections with the same name is accumulated over the run and listed below the total time of the
+         * module in the timing summary of the framework. Sub-timers can be used concurrently from several threads.
+         */
+        ScopedTimer scoped_timer(const std::string& name);
+
     private:
         /**
          * @brief Set the module identifier for internal use
@@ -227,6 +258,16 @@ namespace corryvreckan {
         void set_ROOT_directory(TDirectory* directory);
         TDirectory* directory_{nullptr};
 
+        /**
+         * @brief Merge the per-thread clones of all histograms booked through \ref book_histogram
+         */
+        void merge_histograms();
+        std::vector<std::unique_ptr<ThreadedHistogramBase>> histograms_;
+
+        // Named sub-timers in the order of their names
+        std::map<std::string, std::unique_ptr<TimingRecord>> sub_timers_;
+        std::mutex sub_timers_mutex_;
+
         // Configure the reference detector:
         void setReference(std::shared_ptr<Detector> reference) { m_reference = std::move(reference); };
         std::shared_ptr<Detector> m_reference;
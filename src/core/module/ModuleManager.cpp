@@ -14,18 +14,23 @@
 #include <Math/Vector2D.h>
 #include <Math/Vector3D.h>
 #include <TFile.h>
+#include <TH1D.h>
 #include <TSystem.h>
 
 // Local include files
+#include "Metrics.hpp"
 #include "ModuleManager.hpp"
 #include "core/utils/log.h"
 #include "exceptions.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <dlfcn.h>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
+#include <limits>
 
 #define CORRYVRECKAN_MODULE_PREFIX "libCorryvreckanModule"
 #define CORRYVRECKAN_GENERATOR_FUNCTION "corryvreckan_module_generator"
@@ -280,6 +285,8 @@ void ModuleManager::load_modules() {
                     conf_manager_->dropInstanceConfiguration(iter->first);
 
                     module_execution_time_.erase(iter->second->get());
+                    module_latency_.erase(iter->second->get());
+                    slowest_events_.erase(iter->second->get());
                     iter->second = m_modules.erase(iter->second);
                     iter = id_to_module_.erase(iter);
                 } else {
@@ -290,6 +297,8 @@ void ModuleManager::load_modules() {
                     // Priority is lower, do not add this module to the run list, drop config
                     conf_manager_->dropInstanceConfiguration(identifier);
                     module_execution_time_.erase(id_mod.second);
+                    module_latency_.erase(id_mod.second);
+                    slowest_events_.erase(id_mod.second);
                     continue;
                 }
             }
@@ -566,6 +575,31 @@ void ModuleManager::run() {
 
     auto run_time = global_config.get<double>("run_time", static_cast<double>(Units::convert(-1.0, "s")));
 
+    // Number of slowest events kept per module for the timing summary
+    auto slowest_events = global_config.get<int>("timing_slowest_events", 10);
+    if(slowest_events < 0) {
+        throw InvalidValueError(global_config, "timing_slowest_events", "number of events cannot be negative");
+    }
+    slowest_events_count_ = static_cast<size_t>(slowest_events);
+
+    // Export live metrics of the event loop if requested
+    std::unique_ptr<Metrics> metrics;
+    auto metrics_port = global_config.get<int>("metrics_port", 0);
+    if(metrics_port < 0 || metrics_port > 65535) {
+        throw InvalidValueError(global_config, "metrics_port", "port has to be between 0 and 65535");
+    }
+    if(global_config.has("metrics_file") || metrics_port > 0) {
+        std::vector<std::pair<std::string, const TimingRecord*>> module_records;
+        for(auto& module : m_modules) {
+            module_records.emplace_back(module->getUniqueName(), &module_latency_[module.get()]);
+        }
+        auto metrics_interval = global_config.get<double>("metrics_interval", Units::get<double>(1, "s"));
+        metrics = std::make_unique<Metrics>(std::move(module_records),
+                                            global_config.has("metrics_file") ? global_config.getPath("metrics_file") : "",
+                                            static_cast<uint16_t>(metrics_port),
+                                            std::chrono::nanoseconds(static_cast<int64_t>(metrics_interval)));
+    }
+
     // Loop over all events, running each module on each "event"
     LOG(STATUS) << "========================| Event loop |========================";
     m_events = 0;
@@ -575,11 +609,17 @@ void ModuleManager::run() {
     while(1) {
         bool run = true;
         bool detectors_updated = false;
+        bool beyond_run_time = false;
 
         // Run all modules
         for(auto& module : m_modules) {
             // Check if we should already update the detectors:
             if(m_clipboard->isEventDefined() && !detectors_updated) {
+                // Events starting at or after the run time limit belong to the next time slice and are not processed
+                if(run_time > 0.0 && m_clipboard->getEvent()->start() >= run_time) {
+                    beyond_run_time = true;
+                    break;
+                }
                 for(auto& det : m_detectors) {
                     det->update(m_clipboard->getEvent()->start());
                 }
@@ -608,6 +648,23 @@ void ModuleManager::run() {
             // Update execution time
             auto end = std::chrono::steady_clock::now();
             module_execution_time_[module.get()] += static_cast<std::chrono::duration<long double>>(end - start).count();
+            auto seconds = std::chrono::duration<double>(end - start).count();
+            module_latency_[module.get()].record(seconds);
+
+            // Keep the slowest events of the module in a min-heap
+            auto& slowest = slowest_events_[module.get()];
+            auto faster = [](const SlowEvent& a, const SlowEvent& b) { return a.seconds > b.seconds; };
+            if(slowest.size() < slowest_events_count_ || (!slowest.empty() && seconds > slowest.front().seconds)) {
+                if(slowest.size() == slowest_events_count_) {
+                    std::pop_heap(slowest.begin(), slowest.end(), faster);
+                    slowest.pop_back();
+                }
+                slowest.push_back({seconds,
+                                   m_events,
+                                   m_clipboard->isEventDefined() ? m_clipboard->getEvent()->start()
+                                                                 : std::numeric_limits<double>::quiet_NaN()});
+                std::push_heap(slowest.begin(), slowest.end(), faster);
+            }
 
             if(check == StatusCode::DeadTime) {
                 // If status code indicates dead time, just silently continue with next event:
@@ -622,12 +679,22 @@ void ModuleManager::run() {
             }
         }
 
+        if(beyond_run_time) {
+            LOG(STATUS) << "Reached run time limit of " << Units::display(run_time, {"us", "ms", "s"})
+                        << ", stopping event loop";
+            break;
+        }
+
         // Increment event number
         m_events++;
 
         // Print statistics:
         m_tracks += static_cast<int>(m_clipboard->countObjects<Track>());
         m_pixels += static_cast<int>(m_clipboard->countObjects<Pixel>());
+        if(metrics) {
+            metrics->recordEvent(
+                static_cast<uint64_t>(m_events), static_cast<uint64_t>(m_pixels), static_cast<uint64_t>(m_tracks));
+        }
 
         if(m_events % eventloop_print_freq == 0) {
 
@@ -757,6 +824,8 @@ void ModuleManager::finalizeAll() {
     // Create read-only version of permanent storage element from event clipboard:
     auto readonly_clipboard = std::static_pointer_cast<ReadonlyClipboard>(m_clipboard);
 
+    auto timing_histograms = global_config.get<bool>("timing_histograms", false);
+
     // Loop over all modules and finalize them
     LOG(STATUS) << "===================| Finalising modules |===================";
     for(auto& module : m_modules) {
@@ -770,10 +839,15 @@ void ModuleManager::finalizeAll() {
         // Change to our ROOT directory
         module->getROOTDirectory()->cd();
 
-        // Finalise the module
+        // Merge histograms filled concurrently and finalise the module
+        module->merge_histograms();
         module->finalize(readonly_clipboard);
 
-        // Store all ROOT objects:
+        // Store all ROOT objects, including clones filled during finalizing:
+        module->merge_histograms();
+        if(timing_histograms) {
+            write_timing_histograms(module.get());
+        }
         module->getROOTDirectory()->Write();
 
         // Remove the pointer to the ROOT directory after finalizing
@@ -845,6 +919,9 @@ void ModuleManager::finalizeAll() {
 
     // Check the timing for all events
     timing();
+    if(global_config.has("timing_report")) {
+        write_timing_report(global_config.getPath("timing_report"));
+    }
 }
 
 // Display timing statistics for each module, over all events and per event
@@ -852,14 +929,133 @@ void ModuleManager::timing() {
     LOG(STATUS) << "===============| Wall-clock timing (seconds) |================";
     for(auto& module : m_modules) {
         auto identifier = module->get_identifier().getIdentifier();
+        const auto& latency = module_latency_[module.get()];
         LOG(STATUS) << std::setw(20) << module->get_configuration().getName() << (identifier.empty() ? "   " : " : ")
                     << std::setw(10) << identifier << "  --  " << std::fixed << std::setprecision(5)
                     << module_execution_time_[module.get()] << "s = " << std::setprecision(6)
-                    << 1000 * module_execution_time_[module.get()] / m_events << "ms/evt";
+                    << 1000 * module_execution_time_[module.get()] / m_events << "ms/evt (p50 " << std::setprecision(3)
+                    << 1000 * latency.quantile(0.5) << "ms, p99 " << 1000 * latency.quantile(0.99) << "ms, max "
+                    << 1000 * latency.maximum() << "ms)";
+
+        // Break the module time down into its sub-timers, sections can be nested and do not need to add up
+        for(const auto& [name, record] : module->sub_timers_) {
+            auto fraction = module_execution_time_[module.get()] > 0
+                                ? 100 * record->total() / static_cast<double>(module_execution_time_[module.get()])
+                                : 0.;
+            LOG(STATUS) << std::setw(37) << "" << "|- " << name << ": " << std::setprecision(5) << record->total()
+                        << "s = " << std::setprecision(1) << fraction << "%, " << std::setprecision(6)
+                        << 1000 * record->total() / static_cast<double>(record->count()) << "ms/call";
+        }
+
+        // List the slowest events, slowest first
+        auto slowest = slowest_events_[module.get()];
+        std::sort_heap(slowest.begin(), slowest.end(), [](const SlowEvent& a, const SlowEvent& b) {
+            return a.seconds > b.seconds;
+        });
+        for(const auto& event : slowest) {
+            LOG(INFO) << std::setw(37) << "" << "slow event " << event.event << ": " << std::setprecision(3)
+                      << 1000 * event.seconds << "ms"
+                      << (std::isnan(event.time) ? "" : " at t = " + Units::display(event.time, {"ns", "us", "ms", "s"}));
+        }
     }
     LOG(STATUS) << "==============================================================";
 }
 
+void ModuleManager::write_timing_histograms(Module* module) {
+    auto* directory = module->getROOTDirectory()->mkdir("timing");
+    if(directory == nullptr) {
+        LOG(WARNING) << "Could not create directory for the timing histograms of " << module->getUniqueName();
+        return;
+    }
+    directory->cd();
+
+    // Histograms are attached to the current directory and written with the module directory
+    const auto* title = ";log_{10}(t / s);events";
+    module_latency_[module].distribution().toROOT<TH1D>("latency", std::string("Time spent per event") + title);
+    for(const auto& [name, record] : module->sub_timers_) {
+        record->distribution().toROOT<TH1D>("latency_" + name, "Time spent in " + name + title);
+    }
+
+    module->getROOTDirectory()->cd();
+}
+
+void ModuleManager::write_timing_report(const std::string& path) {
+    std::ofstream file(path);
+    if(!file) {
+        throw RuntimeError("Cannot create timing report " + path);
+    }
+
+    // Minimal JSON output, undefined values are written as null
+    auto number = [](double value) {
+        std::ostringstream out;
+        out.precision(9);
+        if(std::isnan(value) || std::isinf(value)) {
+            out << "null";
+        } else {
+            out << value;
+        }
+        return out.str();
+    };
+    auto quoted = [](const std::string& value) {
+        std::string escaped = "\"";
+        for(const auto character : value) {
+            if(character == '\\' || character == '"') {
+                escaped += '\\';
+            }
+            escaped += character;
+        }
+        return escaped + "\"";
+    };
+    auto distribution = [&](const TimingRecord& record) {
+        const auto& histogram = record.distribution();
+        std::ostringstream out;
+        out << "{\"log10_low\": " << histogram.axis().low() << ", \"log10_high\": " << histogram.axis().high()
+            << ", \"counts\": [";
+        for(size_t bin = 0; bin <= histogram.axis().bins() + 1; ++bin) {
+            out << (bin > 0 ? ", " : "") << histogram.content(bin);
+        }
+        out << "]}";
+        return out.str();
+    };
+    auto statistics = [&](const TimingRecord& record) {
+        std::ostringstream out;
+        out << "\"calls\": " << record.count() << ", \"total\": " << number(record.total())
+            << ", \"mean\": " << number(record.total() / static_cast<double>(record.count()))
+            << ", \"p50\": " << number(record.quantile(0.5)) << ", \"p99\": " << number(record.quantile(0.99))
+            << ", \"max\": " << number(record.maximum()) << ", \"histogram\": " << distribution(record);
+        return out.str();
+    };
+
+    file << "{\n  \"events\": " << m_events << ",\n  \"unit\": \"s\",\n  \"modules\": [";
+    bool first_module = true;
+    for(auto& module : m_modules) {
+        file << (first_module ? "" : ",") << "\n    {\"name\": " << quoted(module->getUniqueName()) << ", "
+             << statistics(module_latency_[module.get()]);
+        first_module = false;
+
+        auto slowest = slowest_events_[module.get()];
+        std::sort_heap(slowest.begin(), slowest.end(), [](const SlowEvent& a, const SlowEvent& b) {
+            return a.seconds > b.seconds;
+        });
+        file << ",\n     \"slowest_events\": [";
+        for(size_t i = 0; i < slowest.size(); ++i) {
+            file << (i > 0 ? ", " : "") << "{\"event\": " << slowest[i].event
+                 << ", \"seconds\": " << number(slowest[i].seconds) << ", \"time_ns\": " << number(slowest[i].time) << "}";
+        }
+        file << "],\n     \"timers\": [";
+        bool first_timer = true;
+        for(const auto& [name, record] : module->sub_timers_) {
+            file << (first_timer ? "" : ",") << "\n       {\"name\": " << quoted(name) << ", " << statistics(*record)
+                 << "}";
+            first_timer = false;
+        }
+        file << "]}";
+    }
+    file << "\n  ]\n}\n";
+
+    LOG(STATUS) << "Wrote timing report to " << path;
+}
+
 // Helper functions to set the module specific log settings if necessary
 std::tuple<LogLevel, LogFormat> ModuleManager::set_module_before(const std::string&, const Configuration& config) {
     // Set new log level if necessary
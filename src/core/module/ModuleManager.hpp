@@ -21,6 +21,7 @@
 #include <TFile.h>
 
 #include "Module.hpp"
+#include "Timing.hpp"
 #include "core/clipboard/Clipboard.hpp"
 #include "core/config/ConfigManager.hpp"
 #include "core/detector/Detector.hpp"
@@ -84,6 +85,18 @@ namespace corryvreckan {
     private:
         void timing();
 
+        /**
+         * @brief Write the timing of all modules to a JSON report
+         * @param path Path of the report file
+         */
+        void write_timing_report(const std::string& path);
+
+        /**
+         * @brief Store the timing distributions of a module in a subdirectory of its ROOT directory
+         * @param module Module to store the timing distributions for
+         */
+        void write_timing_histograms(Module* module);
+
         void load_detectors();
         void load_modules();
 
@@ -145,6 +158,20 @@ namespace corryvreckan {
         void set_module_after(std::tuple<LogLevel, LogFormat> prev);
 
         std::map<Module*, long double> module_execution_time_;
+
+        /**
+         * @brief Event on which a module spent a long time
+         */
+        struct SlowEvent {
+            double seconds;
+            int event;
+            double time;
+        };
+
+        // Distribution of the time spent per event and slowest events of each module
+        std::map<Module*, TimingRecord> module_latency_;
+        std::map<Module*, std::vector<SlowEvent>> slowest_events_;
+        size_t slowest_events_count_{10};
     };
 } // namespace corryvreckan
 
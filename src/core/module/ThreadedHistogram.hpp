@@ -0,0 +1,96 @@
+/**
+ * @file
+ * @brief Definition of histograms with per-thread clones for modules processing data concurrently
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CORRYVRECKAN_THREADED_HISTOGRAM_H
+#define CORRYVRECKAN_THREADED_HISTOGRAM_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <TEfficiency.h>
+#include <TH1.h>
+
+namespace corryvreckan {
+    /**
+     * @brief Interface of histograms booked through a module, allowing the framework to merge them
+     */
+    class ThreadedHistogramBase {
+    public:
+        /**
+         * @brief Essential virtual destructor
+         */
+        virtual ~ThreadedHistogramBase() = default;
+
+        /**
+         * @brief Add the contents of all per-thread clones to the histogram in the module directory and release them
+         * @warning Must not be called while other threads are still filling the histogram
+         */
+        virtual void merge() = 0;
+    };
+
+    /**
+     * @brief Histogram handing out an independent clone to every thread filling it
+     *
+     * The histogram itself is created in the current ROOT directory, i.e. in the directory of the module booking it, and is
+     * filled directly from the thread which created it. Every other thread, whether a worker of a \ref ThreadPool or not,
+     * obtains its own empty clone on first access, which is detached from any directory and kept until the next merge. The
+     * clones are added to the histogram by the framework before and after the module is finalized, such that modules only
+     * ever see and store the merged result. Any ROOT class deriving from TH1, including profiles, as well as TEfficiency is
+     * supported.
+     */
+    template <typename T> class ThreadedHistogram : public ThreadedHistogramBase {
+    public:
+        /**
+         * @brief Create the histogram in the current ROOT directory
+         * @param args Arguments forwarded to the constructor of the ROOT histogram
+         */
+        template <typename... Args> explicit ThreadedHistogram(Args&&... args);
+
+        /**
+         * @brief Get the histogram to be filled by the calling thread
+         * @return Histogram in the module directory for the creating thread, the clone of the calling thread otherwise
+         * @note Other threads acquire a lock, in hot loops the returned pointer should therefore be fetched once per task
+         */
+        T* get();
+
+        /**
+         * @brief Access the histogram of the calling thread
+         * @return Histogram to be filled by the calling thread
+         */
+        T* operator->() { return get(); }
+
+        /**
+         * @brief Get the histogram stored in the module directory, which holds the merged result after \ref merge
+         * @return Histogram in the module directory
+         */
+        T* getMerged() const { return histogram_; }
+
+        void merge() override;
+
+    private:
+        // Histogram owned by the ROOT directory of the module
+        T* histogram_;
+        std::thread::id owner_;
+
+        // Empty copy all clones are created from, since the histogram itself may already be filled at that time
+        std::unique_ptr<T> model_;
+
+        std::mutex mutex_;
+        std::map<std::thread::id, std::unique_ptr<T>> clones_;
+    };
+} // namespace corryvreckan
+
+// Include template members
+#include "ThreadedHistogram.tpp"
+
+#endif // CORRYVRECKAN_THREADED_HISTOGRAM_H
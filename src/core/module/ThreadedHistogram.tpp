@@ -0,0 +1,56 @@
+/**
+ * @file
+ * @brief Template implementation of histograms with per-thread clones
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+namespace corryvreckan {
+    namespace threaded_histogram {
+        inline void add(TH1* target, const TH1* source) { target->Add(source); }
+        inline void add(TEfficiency* target, const TEfficiency* source) { target->Add(*source); }
+    } // namespace threaded_histogram
+
+    template <typename T>
+    template <typename... Args>
+    ThreadedHistogram<T>::ThreadedHistogram(Args&&... args)
+        : histogram_(new T(std::forward<Args>(args)...)), owner_(std::this_thread::get_id()) {
+        model_.reset(static_cast<T*>(histogram_->Clone()));
+        model_->SetDirectory(nullptr);
+    }
+
+    /*
+     * Histograms are booked during initialization, so the creating thread is the main thread. It fills the histogram in the
+     * module directory directly, such that modules processing data sequentially produce exactly the same output as with
+     * plain ROOT histograms. Clones are identified by the thread ID rather than the thread number of the ThreadPool, which
+     * is only defined for its workers.
+     */
+    template <typename T> T* ThreadedHistogram<T>::get() {
+        auto thread = std::this_thread::get_id();
+        if(thread == owner_) {
+            return histogram_;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto& clone = clones_[thread];
+        if(!clone) {
+            clone.reset(static_cast<T*>(model_->Clone()));
+            clone->SetDirectory(nullptr);
+        }
+        return clone.get();
+    }
+
+    template <typename T> void ThreadedHistogram<T>::merge() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        for(auto& clone : clones_) {
+            if(clone.second) {
+                threaded_histogram::add(histogram_, clone.second.get());
+            }
+        }
+        clones_.clear();
+    }
+} // namespace corryvreckan
@@ -0,0 +1,64 @@
+/**
+ * @file
+ * @brief Implementation of wall-clock time distributions
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Timing.hpp"
+
+#include <cmath>
+#include <limits>
+
+using namespace corryvreckan;
+
+void TimingRecord::record(double seconds) {
+    distribution_.fill(seconds > 0. ? std::log10(seconds) : -std::numeric_limits<double>::infinity());
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    // No atomic floating point addition before C++20
+    auto total = total_.load(std::memory_order_relaxed);
+    while(!total_.compare_exchange_weak(total, total + seconds, std::memory_order_relaxed)) {
+    }
+    auto maximum = maximum_.load(std::memory_order_relaxed);
+    while(seconds > maximum && !maximum_.compare_exchange_weak(maximum, seconds, std::memory_order_relaxed)) {
+    }
+}
+
+double TimingRecord::quantile(double probability) const {
+    const auto& axis = distribution_.axis();
+    const auto bins = axis.bins();
+
+    // Sum the bins instead of using the count, the record might be filled concurrently
+    uint64_t entries = 0;
+    for(size_t bin = 0; bin <= bins + 1; ++bin) {
+        entries += distribution_.content(bin);
+    }
+    if(entries == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // Walk the cumulative distribution, bin 0 and bins+1 are underflow and overflow
+    const auto target = probability * static_cast<double>(entries);
+    const auto width = (axis.high() - axis.low()) / static_cast<double>(bins);
+    double cumulative = 0.;
+    for(size_t bin = 0; bin <= bins + 1; ++bin) {
+        auto content = static_cast<double>(distribution_.content(bin));
+        if(content > 0. && cumulative + content >= target) {
+            if(bin == 0) {
+                return std::pow(10., axis.low());
+            }
+            if(bin == bins + 1) {
+                return std::pow(10., axis.high());
+            }
+            auto fraction = (target - cumulative) / content;
+            return std::pow(10., axis.low() + (static_cast<double>(bin - 1) + fraction) * width);
+        }
+        cumulative += content;
+    }
+    return std::pow(10., axis.high());
+}
@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @brief Definition of wall-clock time distributions and scoped timers
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CORRYVRECKAN_TIMING_H
+#define CORRYVRECKAN_TIMING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "core/utils/FlatHistogram.hpp"
+
+namespace corryvreckan {
+    /**
+     * @brief Distribution of measured wall-clock times
+     *
+     * Times are binned logarithmically, with 40 bins per decade between 100ns and 1000s, such that quantiles can be
+     * estimated with a relative precision of about 6% over the full range. Number of measurements, total and maximum time
+     * are kept exactly. All measurements are atomic updates, a record can be filled from several threads and read while
+     * being filled.
+     */
+    class TimingRecord {
+    public:
+        /**
+         * @brief Record a single measurement
+         * @param seconds Measured time in seconds
+         */
+        void record(double seconds);
+
+        /**
+         * @brief Number of measurements
+         */
+        uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Sum of all measured times in seconds
+         */
+        double total() const { return total_.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Longest measured time in seconds
+         */
+        double maximum() const { return maximum_.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Estimate a quantile of the distribution
+         * @param probability Probability of the quantile to estimate, between zero and one
+         * @return Estimated quantile in seconds, interpolated within the bin, or NaN without measurements
+         */
+        double quantile(double probability) const;
+
+        /**
+         * @brief Distribution of the measured times, binned in log10 of the time in seconds
+         */
+        const FlatHistogram1D<true>& distribution() const { return distribution_; }
+
+    private:
+        FlatHistogram1D<true> distribution_{400, -7., 3.};
+        std::atomic<uint64_t> count_{0};
+        std::atomic<double> total_{0.};
+        std::atomic<double> maximum_{0.};
+    };
+
+    /**
+     * @brief Timer recording the wall-clock time spent in its scope into a \ref TimingRecord when it is destroyed
+     */
+    class ScopedTimer {
+    public:
+        /**
+         * @brief Start the timer
+         * @param record Record the elapsed time is added to
+         */
+        explicit ScopedTimer(TimingRecord& record) : record_(record), start_(std::chrono::steady_clock::now()) {}
+
+        /**
+         * @brief Stop the timer and record the elapsed time
+         */
+        ~ScopedTimer() { record_.record(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count()); }
+
+        /// @{
+        /**
+         * @brief Copying or moving a timer is not allowed
+         */
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+        ScopedTimer(ScopedTimer&&) = delete;
+        ScopedTimer& operator=(ScopedTimer&&) = delete;
+        /// @}
+
+    private:
+        TimingRecord& record_;
+        std::chrono::steady_clock::time_point start_;
+    };
+} // namespace corryvreckan
+
+#endif // CORRYVRECKAN_TIMING_H
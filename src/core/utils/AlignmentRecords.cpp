@@ -0,0 +1,199 @@
+/**
+ * @file
+ * @brief Implementation of compact track records for alignment
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "AlignmentRecords.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Dense>
+
+#include "core/detector/Detector.hpp"
+#include "exceptions.h"
+#include "objects/Cluster.hpp"
+
+using namespace corryvreckan;
+
+namespace {
+    // Number of tracks read back from the temporary file at once
+    const size_t block_size = 65536;
+} // namespace
+
+ROOT::Math::XYZPoint AlignmentRecords::Line::globalIntercept(const Detector& detector) const {
+    auto normal = detector.normal();
+    double path = (detector.origin() - state).Dot(normal) / direction.Dot(normal);
+    return state + path * direction;
+}
+
+ROOT::Math::XYZPoint AlignmentRecords::Line::localIntercept(const Detector& detector) const {
+    return detector.globalToLocal(globalIntercept(detector));
+}
+
+AlignmentRecords::AlignmentRecords(AlignmentStorage storage) {
+    if(storage == AlignmentStorage::FILE) {
+        file_ = std::tmpfile();
+        if(file_ == nullptr) {
+            throw RuntimeError("Could not create temporary file for alignment records");
+        }
+    }
+}
+
+AlignmentRecords::~AlignmentRecords() {
+    if(file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+uint32_t AlignmentRecords::plane(const std::string& name) {
+    auto it = std::find(planes_.begin(), planes_.end(), name);
+    if(it != planes_.end()) {
+        return static_cast<uint32_t>(std::distance(planes_.begin(), it));
+    }
+    planes_.push_back(name);
+    return static_cast<uint32_t>(planes_.size() - 1);
+}
+
+AlignmentRecords::Measurement AlignmentRecords::measurement(const Cluster* cluster, uint32_t flags) {
+    return Measurement{plane(cluster->detectorID()),
+                       flags,
+                       cluster->local().x(),
+                       cluster->local().y(),
+                       cluster->errorX(),
+                       cluster->errorY(),
+                       cluster->column(),
+                       cluster->row(),
+                       cluster->timestamp()};
+}
+
+void AlignmentRecords::add(const std::vector<Measurement>& track) { append(track, nullptr); }
+
+void AlignmentRecords::add(const std::vector<Measurement>& track, const Line& reference) { append(track, &reference); }
+
+void AlignmentRecords::append(const std::vector<Measurement>& track, const Line* reference) {
+    if(tracks_ == 0) {
+        with_references_ = (reference != nullptr);
+    } else if(with_references_ != (reference != nullptr)) {
+        throw RuntimeError("Alignment records have to be stored either all with or all without reference line");
+    }
+
+    tracks_++;
+    if(file_ == nullptr) {
+        data_.insert(data_.end(), track.begin(), track.end());
+        offsets_.push_back(data_.size());
+        if(reference != nullptr) {
+            references_.push_back(*reference);
+        }
+        return;
+    }
+
+    auto count = static_cast<uint32_t>(track.size());
+    if(std::fwrite(&count, sizeof(count), 1, file_) != 1 ||
+       std::fwrite(track.data(), sizeof(Measurement), track.size(), file_) != track.size() ||
+       (reference != nullptr && std::fwrite(reference, sizeof(Line), 1, file_) != 1)) {
+        throw RuntimeError("Could not write alignment records to temporary file");
+    }
+}
+
+void AlignmentRecords::forEachBlock(const std::function<void(const std::vector<Measurement>&,
+                                                             const std::vector<uint64_t>&,
+                                                             const std::vector<Line>&)>& callback) const {
+    if(file_ == nullptr) {
+        callback(data_, offsets_, references_);
+        return;
+    }
+
+    std::fflush(file_);
+    std::rewind(file_);
+
+    std::vector<Measurement> data;
+    std::vector<uint64_t> offsets;
+    std::vector<Line> references;
+    size_t remaining = tracks_;
+    while(remaining > 0) {
+        data.clear();
+        offsets.assign(1, 0);
+        references.clear();
+        for(size_t i = 0; i < std::min(remaining, block_size); i++) {
+            uint32_t count = 0;
+            if(std::fread(&count, sizeof(count), 1, file_) != 1) {
+                throw RuntimeError("Could not read alignment records from temporary file");
+            }
+            data.resize(data.size() + count);
+            if(count > 0 && std::fread(&data[offsets.back()], sizeof(Measurement), count, file_) != count) {
+                throw RuntimeError("Could not read alignment records from temporary file");
+            }
+            offsets.push_back(data.size());
+            if(with_references_) {
+                references.emplace_back();
+                if(std::fread(&references.back(), sizeof(Line), 1, file_) != 1) {
+                    throw RuntimeError("Could not read alignment records from temporary file");
+                }
+            }
+        }
+        remaining -= offsets.size() - 1;
+        callback(data, offsets, references);
+    }
+
+    // Continue appending at the end of the file
+    std::fseek(file_, 0, SEEK_END);
+}
+
+AlignmentRecords::Line AlignmentRecords::fit(const Measurement* begin,
+                                             size_t count,
+                                             const std::vector<std::shared_ptr<Detector>>& detectors) {
+    Line line;
+
+    Eigen::Matrix4d mat(Eigen::Matrix4d::Zero());
+    Eigen::Vector4d vec(Eigen::Vector4d::Zero());
+    size_t planes = 0;
+    for(const auto* m = begin; m != begin + count; m++) {
+        if(m->flags & ASSOCIATED) {
+            continue;
+        }
+
+        const auto& detector = detectors[m->plane];
+        auto global = detector->localToGlobal(ROOT::Math::XYZPoint(m->x, m->y, 0));
+        auto errorMatrix = detector->getSpatialResolutionMatrixGlobal(m->column, m->row);
+
+        Eigen::Vector2d pos(global.x(), global.y());
+        Eigen::Matrix2d V;
+        V << errorMatrix(0, 0), errorMatrix(0, 1), errorMatrix(1, 0), errorMatrix(1, 1);
+        Eigen::Matrix<double, 2, 4> C;
+        C << 1., global.z(), 0., 0., 0., 0., 1., global.z();
+        if(fabs(V.determinant()) < std::numeric_limits<double>::epsilon()) {
+            return line;
+        }
+        vec += C.transpose() * V.inverse() * pos;
+        mat += C.transpose() * V.inverse() * C;
+        planes++;
+    }
+
+    if(planes < 2 || fabs(mat.determinant()) < std::numeric_limits<double>::epsilon()) {
+        return line;
+    }
+    Eigen::Vector4d res = mat.inverse() * vec;
+    line.state = ROOT::Math::XYZPoint(res(0), res(2), 0.);
+    line.direction = ROOT::Math::XYZVector(res(1), res(3), 1.);
+
+    // Calculate the chi2 from the local residuals on all planes
+    for(const auto* m = begin; m != begin + count; m++) {
+        if(m->flags & ASSOCIATED) {
+            continue;
+        }
+        auto intercept = line.localIntercept(*detectors[m->plane]);
+        double dx = m->x - intercept.x();
+        double dy = m->y - intercept.y();
+        line.chi2 += dx * dx / (m->error_x * m->error_x) + dy * dy / (m->error_y * m->error_y);
+    }
+    line.fitted = true;
+    return line;
+}
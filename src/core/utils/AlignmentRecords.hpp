@@ -0,0 +1,182 @@
+/**
+ * @file
+ * @brief Definition of compact track records for alignment
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CORRYVRECKAN_ALIGNMENT_RECORDS_H
+#define CORRYVRECKAN_ALIGNMENT_RECORDS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Math/Point3D.h>
+#include <Math/Vector3D.h>
+
+namespace corryvreckan {
+    class Cluster;
+    class Detector;
+
+    /**
+     * @brief Storage of the track sample collected by alignment modules
+     */
+    enum class AlignmentStorage {
+        TRACKS,  ///< Full track and cluster objects on the persistent clipboard storage
+        RECORDS, ///< Compact records in a contiguous array in memory
+        FILE,    ///< Compact records spooled to a temporary file
+    };
+
+    /**
+     * @brief Compact per-track records of cluster measurements for alignment
+     *
+     * Instead of keeping the full track and cluster objects alive until the end of the run, only the local cluster
+     * positions, their uncertainties and the plane they belong to are stored for every track. The global positions are
+     * recalculated from the current detector geometry whenever they are needed, and tracks are refitted as straight lines
+     * directly from the records.
+     *
+     * Optionally, a reference line can be stored with every track, e.g. the track state and direction at a device under
+     * test which does not take part in the track fit and therefore does not require a refit of the track when it is moved.
+     *
+     * Records are stored in one contiguous array, or optionally appended to a temporary file and read back in blocks. The
+     * latter only bounds the memory consumption if the caller processes every block without copying its contents.
+     */
+    class AlignmentRecords {
+    public:
+        /**
+         * @brief Single cluster measurement of a track
+         */
+        struct Measurement {
+            uint32_t plane;
+            uint32_t flags;
+            double x;
+            double y;
+            double error_x;
+            double error_y;
+            double column;
+            double row;
+            double timestamp;
+        };
+
+        /// Flag for clusters associated to the track which do not take part in the track fit
+        static constexpr uint32_t ASSOCIATED = 1;
+
+        /**
+         * @brief Straight line through a track record
+         */
+        struct Line {
+            ROOT::Math::XYZPoint state;
+            ROOT::Math::XYZVector direction;
+            double chi2{};
+            bool fitted{false};
+
+            /**
+             * @brief Intercept of the line with the plane of a detector in global coordinates
+             * @param detector Detector to intersect with
+             * @return Global intercept position
+             */
+            ROOT::Math::XYZPoint globalIntercept(const Detector& detector) const;
+
+            /**
+             * @brief Intercept of the line with the plane of a detector in local coordinates
+             * @param detector Detector to intersect with
+             * @return Local intercept position
+             */
+            ROOT::Math::XYZPoint localIntercept(const Detector& detector) const;
+        };
+
+        /**
+         * @brief Construct an empty record storage
+         * @param storage Storage backend, either in memory or in a temporary file
+         */
+        explicit AlignmentRecords(AlignmentStorage storage = AlignmentStorage::RECORDS);
+        ~AlignmentRecords();
+
+        AlignmentRecords(const AlignmentRecords&) = delete;
+        AlignmentRecords& operator=(const AlignmentRecords&) = delete;
+
+        /**
+         * @brief Get the index of a plane, registering it if it is not known yet
+         * @param name Name of the detector
+         * @return Index of the plane used in the measurements
+         */
+        uint32_t plane(const std::string& name);
+
+        /**
+         * @brief Get the names of all registered planes, indexed by plane index
+         */
+        const std::vector<std::string>& planes() const { return planes_; }
+
+        /**
+         * @brief Create a measurement from a cluster
+         * @param cluster Cluster to store
+         * @param flags Additional flags of the measurement
+         * @return Measurement with local position, uncertainties and timestamp of the cluster
+         */
+        Measurement measurement(const Cluster* cluster, uint32_t flags = 0);
+
+        /**
+         * @brief Append the measurements of one track
+         * @param track Measurements of the track
+         */
+        void add(const std::vector<Measurement>& track);
+
+        /**
+         * @brief Append the measurements of one track together with a reference line
+         * @param track Measurements of the track
+         * @param reference Reference line of the track
+         * @warning Either all or no tracks of a record storage have to be added with a reference line
+         */
+        void add(const std::vector<Measurement>& track, const Line& reference);
+
+        /**
+         * @brief Number of stored tracks
+         */
+        size_t size() const { return tracks_; }
+
+        /**
+         * @brief Loop over all tracks in blocks
+         * @param callback Called with the measurements of a block of tracks, the offsets of the tracks in it and their
+         *                 reference lines. The offsets hold one additional entry with the total number of measurements of
+         *                 the block, the reference lines are empty if the tracks were added without
+         */
+        void forEachBlock(const std::function<void(const std::vector<Measurement>&,
+                                                   const std::vector<uint64_t>&,
+                                                   const std::vector<Line>&)>& callback) const;
+
+        /**
+         * @brief Fit a straight line through all measurements of a track which are not flagged as associated
+         * @param begin First measurement of the track
+         * @param count Number of measurements of the track
+         * @param detectors Detectors indexed by plane index
+         * @return Fitted line, not marked as fitted if the fit failed
+         *
+         * The fit is identical to the one of StraightLineTrack, using the current geometry of the detectors to obtain
+         * the global cluster positions and uncertainties.
+         */
+        static Line fit(const Measurement* begin, size_t count, const std::vector<std::shared_ptr<Detector>>& detectors);
+
+    private:
+        void append(const std::vector<Measurement>& track, const Line* reference);
+
+        std::vector<std::string> planes_;
+
+        size_t tracks_{};
+        bool with_references_{};
+        std::vector<Measurement> data_;
+        std::vector<uint64_t> offsets_{0};
+        std::vector<Line> references_;
+
+        std::FILE* file_{nullptr};
+    };
+} // namespace corryvreckan
+
+#endif /* CORRYVRECKAN_ALIGNMENT_RECORDS_H */
@@ -0,0 +1,223 @@
+/**
+ * @file
+ * @brief Definition of lightweight fixed-binning histograms for hot-path filling
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CORRYVRECKAN_FLAT_HISTOGRAM_H
+#define CORRYVRECKAN_FLAT_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace corryvreckan {
+    /**
+     * @brief Fixed binning of a single histogram axis
+     *
+     * Bins are numbered as in ROOT: bin zero is the underflow, bins one to the number of bins cover the axis range, and the
+     * last bin is the overflow.
+     */
+    class FlatAxis {
+    public:
+        /**
+         * @brief Construct axis with equidistant bins
+         * @param bins Number of bins in the axis range
+         * @param low Lower edge of the first bin
+         * @param high Upper edge of the last bin
+         */
+        FlatAxis(size_t bins, double low, double high);
+
+        /**
+         * @brief Find the bin of a value
+         * @param value Value to look up
+         * @return Bin number including under- and overflow
+         */
+        size_t find(double value) const;
+
+        size_t bins() const { return bins_; }
+        double low() const { return low_; }
+        double high() const { return high_; }
+
+    private:
+        size_t bins_;
+        double low_;
+        double high_;
+        double inverse_width_;
+    };
+
+    /**
+     * @brief Lightweight one-dimensional histogram counting entries in a flat array
+     *
+     * Filling only looks up the bin with the precomputed inverse bin width and increments a counter, without virtual
+     * dispatch or statistics updates. The histogram is converted to a ROOT histogram with identical binning and bin contents
+     * when it should be stored. Statistics such as the mean are then computed by ROOT from the bin contents.
+     *
+     * @tparam Atomic If true, counters are incremented atomically and the histogram can be filled from several threads
+     */
+    template <bool Atomic = false> class FlatHistogram1D {
+    public:
+        /**
+         * @brief Construct histogram with equidistant bins
+         * @param bins Number of bins in the axis range
+         * @param low Lower edge of the first bin
+         * @param high Upper edge of the last bin
+         */
+        FlatHistogram1D(size_t bins, double low, double high);
+
+        /**
+         * @brief Fill a single value
+         * @param value Value to fill
+         */
+        void fill(double value) { increment(axis_.find(value)); }
+
+        /**
+         * @brief Fill a contiguous range of values
+         * @param values Pointer to the first value
+         * @param count Number of values to fill
+         */
+        void fill(const double* values, size_t count);
+
+        /**
+         * @brief Add the contents of another histogram with identical binning
+         * @param other Histogram to add
+         */
+        template <bool OtherAtomic> void add(const FlatHistogram1D<OtherAtomic>& other);
+
+        /**
+         * @brief Get the content of a bin
+         * @param bin Bin number including under- and overflow
+         * @return Number of entries in the bin
+         */
+        uint64_t content(size_t bin) const { return counters_[bin].load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Get the total number of entries, including under- and overflow
+         * @return Number of entries
+         */
+        uint64_t entries() const;
+
+        const FlatAxis& axis() const { return axis_; }
+
+        /**
+         * @brief Reset all bin contents to zero
+         */
+        void reset();
+
+        /**
+         * @brief Create the equivalent ROOT histogram in the current ROOT directory
+         * @param name Name of the histogram
+         * @param title Title of the histogram, including the axis titles
+         * @return Pointer to the ROOT histogram, owned by the current directory
+         */
+        template <typename H> H* toROOT(const std::string& name, const std::string& title) const;
+
+    private:
+        void increment(size_t bin);
+
+        FlatAxis axis_;
+        std::unique_ptr<std::atomic<uint64_t>[]> counters_;
+    };
+
+    /**
+     * @brief Lightweight two-dimensional histogram counting entries in a flat array
+     * @tparam Atomic If true, counters are incremented atomically and the histogram can be filled from several threads
+     * @see FlatHistogram1D
+     */
+    template <bool Atomic = false> class FlatHistogram2D {
+    public:
+        /**
+         * @brief Construct histogram with equidistant bins along both axes
+         * @param bins_x Number of bins in the range of the x axis
+         * @param low_x Lower edge of the first bin of the x axis
+         * @param high_x Upper edge of the last bin of the x axis
+         * @param bins_y Number of bins in the range of the y axis
+         * @param low_y Lower edge of the first bin of the y axis
+         * @param high_y Upper edge of the last bin of the y axis
+         */
+        FlatHistogram2D(size_t bins_x, double low_x, double high_x, size_t bins_y, double low_y, double high_y);
+
+        /**
+         * @brief Fill a single pair of values
+         * @param x Value along the x axis
+         * @param y Value along the y axis
+         */
+        void fill(double x, double y) { increment(global_bin(axis_x_.find(x), axis_y_.find(y))); }
+
+        /**
+         * @brief Fill a contiguous range of value pairs
+         * @param x Pointer to the first value along the x axis
+         * @param y Pointer to the first value along the y axis
+         * @param count Number of value pairs to fill
+         */
+        void fill(const double* x, const double* y, size_t count);
+
+        /**
+         * @brief Fill the same x value with a contiguous range of y values
+         * @param x Value along the x axis
+         * @param y Pointer to the first value along the y axis
+         * @param count Number of values to fill
+         */
+        void fill(double x, const double* y, size_t count);
+
+        /**
+         * @brief Add the contents of another histogram with identical binning
+         * @param other Histogram to add
+         */
+        template <bool OtherAtomic> void add(const FlatHistogram2D<OtherAtomic>& other);
+
+        /**
+         * @brief Get the content of a bin
+         * @param bin_x Bin number along the x axis including under- and overflow
+         * @param bin_y Bin number along the y axis including under- and overflow
+         * @return Number of entries in the bin
+         */
+        uint64_t content(size_t bin_x, size_t bin_y) const {
+            return counters_[global_bin(bin_x, bin_y)].load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the total number of entries, including under- and overflow
+         * @return Number of entries
+         */
+        uint64_t entries() const;
+
+        const FlatAxis& axisX() const { return axis_x_; }
+        const FlatAxis& axisY() const { return axis_y_; }
+
+        /**
+         * @brief Reset all bin contents to zero
+         */
+        void reset();
+
+        /**
+         * @brief Create the equivalent ROOT histogram in the current ROOT directory
+         * @param name Name of the histogram
+         * @param title Title of the histogram, including the axis titles
+         * @return Pointer to the ROOT histogram, owned by the current directory
+         */
+        template <typename H> H* toROOT(const std::string& name, const std::string& title) const;
+
+    private:
+        // Same global bin numbering as ROOT
+        size_t global_bin(size_t bin_x, size_t bin_y) const { return bin_x + (axis_x_.bins() + 2) * bin_y; }
+        size_t size() const { return (axis_x_.bins() + 2) * (axis_y_.bins() + 2); }
+        void increment(size_t bin);
+
+        FlatAxis axis_x_;
+        FlatAxis axis_y_;
+        std::unique_ptr<std::atomic<uint64_t>[]> counters_;
+    };
+} // namespace corryvreckan
+
+// Include template members
+#include "FlatHistogram.tpp"
+
+#endif // CORRYVRECKAN_FLAT_HISTOGRAM_H
@@ -0,0 +1,177 @@
+/**
+ * @file
+ * @brief Template implementation of lightweight fixed-binning histograms
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace corryvreckan {
+    inline FlatAxis::FlatAxis(size_t bins, double low, double high)
+        : bins_(bins), low_(low), high_(high), inverse_width_(static_cast<double>(bins) / (high - low)) {
+        if(bins_ == 0 || !(high_ > low_)) {
+            throw std::invalid_argument("histogram axis requires at least one bin and an upper edge above the lower edge");
+        }
+    }
+
+    /*
+     * Values below the range, including negative infinity, end up in the underflow, values at or above the upper edge as
+     * well as NaN in the overflow bin, following the convention of ROOT.
+     */
+    inline size_t FlatAxis::find(double value) const {
+        if(value < low_) {
+            return 0;
+        }
+        if(!(value < high_)) {
+            return bins_ + 1;
+        }
+        // Values just below the upper edge may be rounded up to it
+        return std::min(static_cast<size_t>((value - low_) * inverse_width_), bins_ - 1) + 1;
+    }
+
+    template <bool Atomic>
+    FlatHistogram1D<Atomic>::FlatHistogram1D(size_t bins, double low, double high)
+        : axis_(bins, low, high), counters_(new std::atomic<uint64_t>[bins + 2]) {
+        reset();
+    }
+
+    template <bool Atomic> void FlatHistogram1D<Atomic>::increment(size_t bin) {
+        if constexpr(Atomic) {
+            counters_[bin].fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // Only accessed from one thread, no read-modify-write operation required
+            counters_[bin].store(counters_[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    template <bool Atomic> void FlatHistogram1D<Atomic>::fill(const double* values, size_t count) {
+        for(size_t i = 0; i < count; ++i) {
+            increment(axis_.find(values[i]));
+        }
+    }
+
+    template <bool Atomic>
+    template <bool OtherAtomic>
+    void FlatHistogram1D<Atomic>::add(const FlatHistogram1D<OtherAtomic>& other) {
+        const auto& axis = other.axis();
+        if(axis.bins() != axis_.bins() || axis.low() != axis_.low() || axis.high() != axis_.high()) {
+            throw std::invalid_argument("cannot add histograms with different binning");
+        }
+        for(size_t bin = 0; bin < axis_.bins() + 2; ++bin) {
+            counters_[bin].fetch_add(other.content(bin), std::memory_order_relaxed);
+        }
+    }
+
+    template <bool Atomic> uint64_t FlatHistogram1D<Atomic>::entries() const {
+        uint64_t entries = 0;
+        for(size_t bin = 0; bin < axis_.bins() + 2; ++bin) {
+            entries += content(bin);
+        }
+        return entries;
+    }
+
+    template <bool Atomic> void FlatHistogram1D<Atomic>::reset() {
+        for(size_t bin = 0; bin < axis_.bins() + 2; ++bin) {
+            counters_[bin].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    template <bool Atomic>
+    template <typename H>
+    H* FlatHistogram1D<Atomic>::toROOT(const std::string& name, const std::string& title) const {
+        auto* histogram = new H(name.c_str(), title.c_str(), static_cast<int>(axis_.bins()), axis_.low(), axis_.high());
+        for(size_t bin = 0; bin < axis_.bins() + 2; ++bin) {
+            histogram->SetBinContent(static_cast<int>(bin), static_cast<double>(content(bin)));
+        }
+        histogram->SetEntries(static_cast<double>(entries()));
+        return histogram;
+    }
+
+    template <bool Atomic>
+    FlatHistogram2D<Atomic>::FlatHistogram2D(
+        size_t bins_x, double low_x, double high_x, size_t bins_y, double low_y, double high_y)
+        : axis_x_(bins_x, low_x, high_x), axis_y_(bins_y, low_y, high_y),
+          counters_(new std::atomic<uint64_t>[(bins_x + 2) * (bins_y + 2)]) {
+        reset();
+    }
+
+    template <bool Atomic> void FlatHistogram2D<Atomic>::increment(size_t bin) {
+        if constexpr(Atomic) {
+            counters_[bin].fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // Only accessed from one thread, no read-modify-write operation required
+            counters_[bin].store(counters_[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    template <bool Atomic> void FlatHistogram2D<Atomic>::fill(const double* x, const double* y, size_t count) {
+        for(size_t i = 0; i < count; ++i) {
+            increment(global_bin(axis_x_.find(x[i]), axis_y_.find(y[i])));
+        }
+    }
+
+    template <bool Atomic> void FlatHistogram2D<Atomic>::fill(double x, const double* y, size_t count) {
+        // The x bin only needs to be looked up once
+        const auto bin_x = axis_x_.find(x);
+        for(size_t i = 0; i < count; ++i) {
+            increment(global_bin(bin_x, axis_y_.find(y[i])));
+        }
+    }
+
+    template <bool Atomic>
+    template <bool OtherAtomic>
+    void FlatHistogram2D<Atomic>::add(const FlatHistogram2D<OtherAtomic>& other) {
+        const auto& axis_x = other.axisX();
+        const auto& axis_y = other.axisY();
+        if(axis_x.bins() != axis_x_.bins() || axis_x.low() != axis_x_.low() || axis_x.high() != axis_x_.high() ||
+           axis_y.bins() != axis_y_.bins() || axis_y.low() != axis_y_.low() || axis_y.high() != axis_y_.high()) {
+            throw std::invalid_argument("cannot add histograms with different binning");
+        }
+        for(size_t bin_y = 0; bin_y < axis_y_.bins() + 2; ++bin_y) {
+            for(size_t bin_x = 0; bin_x < axis_x_.bins() + 2; ++bin_x) {
+                counters_[global_bin(bin_x, bin_y)].fetch_add(other.content(bin_x, bin_y), std::memory_order_relaxed);
+            }
+        }
+    }
+
+    template <bool Atomic> uint64_t FlatHistogram2D<Atomic>::entries() const {
+        uint64_t entries = 0;
+        for(size_t bin = 0; bin < size(); ++bin) {
+            entries += counters_[bin].load(std::memory_order_relaxed);
+        }
+        return entries;
+    }
+
+    template <bool Atomic> void FlatHistogram2D<Atomic>::reset() {
+        for(size_t bin = 0; bin < size(); ++bin) {
+            counters_[bin].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    template <bool Atomic>
+    template <typename H>
+    H* FlatHistogram2D<Atomic>::toROOT(const std::string& name, const std::string& title) const {
+        auto* histogram = new H(name.c_str(),
+                                title.c_str(),
+                                static_cast<int>(axis_x_.bins()),
+                                axis_x_.low(),
+                                axis_x_.high(),
+                                static_cast<int>(axis_y_.bins()),
+                                axis_y_.low(),
+                                axis_y_.high());
+        for(size_t bin = 0; bin < size(); ++bin) {
+            const auto value = counters_[bin].load(std::memory_order_relaxed);
+            if(value > 0) {
+                histogram->SetBinContent(static_cast<int>(bin), static_cast<double>(value));
+            }
+        }
+        histogram->SetEntries(static_cast<double>(entries()));
+        return histogram;
+    }
+} // namespace corryvreckan
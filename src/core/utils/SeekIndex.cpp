@@ -0,0 +1,251 @@
+/**
+ * @file
+ * @brief Implementation of the time-to-offset index for sequentially read raw data files
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "SeekIndex.hpp"
+#include "log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+using namespace corryvreckan;
+
+namespace {
+    // Identifier and version of the sidecar file layout
+    const char sidecar_magic[8] = {'C', 'O', 'R', 'R', 'Y', 'I', 'D', 'X'};
+    const uint32_t sidecar_version = 1;
+
+    template <typename T> void write_value(std::ofstream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    template <typename T> bool read_value(std::ifstream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+} // namespace
+
+SeekIndex::SeekIndex(std::string data_file, std::string format, size_t state_size)
+    : data_file_(std::move(data_file)), format_(std::move(format)), state_size_(state_size) {}
+
+bool SeekIndex::file_signature(uint64_t& size, int64_t& mtime) const {
+    struct stat file_stat;
+    if(stat(data_file_.c_str(), &file_stat) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(file_stat.st_size);
+    mtime = file_stat.st_mtime;
+    return true;
+}
+
+bool SeekIndex::load() {
+    checkpoints_.clear();
+
+    std::ifstream in(sidecar(), std::ios::binary);
+    if(!in.is_open()) {
+        LOG(DEBUG) << "No index file found at " << sidecar();
+        return false;
+    }
+
+    uint64_t size = 0, stored_size = 0;
+    int64_t mtime = 0, stored_mtime = 0;
+    if(!file_signature(size, mtime)) {
+        return false;
+    }
+
+    char magic[sizeof(sidecar_magic)];
+    uint32_t version = 0, format_length = 0, state_size = 0;
+    uint64_t entries = 0;
+    if(!in.read(magic, sizeof(magic)) || std::memcmp(magic, sidecar_magic, sizeof(magic)) != 0 ||
+       !read_value(in, version) || version != sidecar_version || !read_value(in, format_length)) {
+        LOG(WARNING) << "Ignoring invalid index file " << sidecar();
+        return false;
+    }
+
+    std::string format(format_length, '\0');
+    if(!in.read(&format[0], format_length) || !read_value(in, stored_size) || !read_value(in, stored_mtime) ||
+       !read_value(in, state_size) || !read_value(in, entries)) {
+        LOG(WARNING) << "Ignoring invalid index file " << sidecar();
+        return false;
+    }
+
+    if(format != format_ || state_size != state_size_ || stored_size != size || stored_mtime != mtime) {
+        LOG(INFO) << "Index file " << sidecar() << " is outdated";
+        return false;
+    }
+
+    checkpoints_.reserve(entries);
+    for(uint64_t i = 0; i < entries; i++) {
+        Checkpoint checkpoint{0., 0, std::vector<uint64_t>(state_size_)};
+        if(!read_value(in, checkpoint.time) || !read_value(in, checkpoint.offset) ||
+           !in.read(reinterpret_cast<char*>(checkpoint.state.data()),
+                    static_cast<std::streamsize>(state_size_ * sizeof(uint64_t)))) {
+            LOG(WARNING) << "Index file " << sidecar() << " is truncated";
+            checkpoints_.clear();
+            return false;
+        }
+        checkpoints_.push_back(std::move(checkpoint));
+    }
+
+    LOG(DEBUG) << "Loaded " << checkpoints_.size() << " checkpoints from index file " << sidecar();
+    return true;
+}
+
+bool SeekIndex::write() const {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    if(!file_signature(size, mtime)) {
+        return false;
+    }
+
+    // Write to a temporary file first to never leave a partially written index behind
+    auto tmp_name = sidecar() + ".tmp";
+    std::ofstream out(tmp_name, std::ios::binary | std::ios::trunc);
+    if(!out.is_open()) {
+        LOG(WARNING) << "Cannot write index file " << sidecar() << ", index will not be cached";
+        return false;
+    }
+
+    out.write(sidecar_magic, sizeof(sidecar_magic));
+    write_value(out, sidecar_version);
+    write_value(out, static_cast<uint32_t>(format_.size()));
+    out.write(format_.data(), static_cast<std::streamsize>(format_.size()));
+    write_value(out, size);
+    write_value(out, mtime);
+    write_value(out, static_cast<uint32_t>(state_size_));
+    uint64_t entries = checkpoints_.size();
+    write_value(out, entries);
+    for(const auto& checkpoint : checkpoints_) {
+        write_value(out, checkpoint.time);
+        write_value(out, checkpoint.offset);
+        out.write(reinterpret_cast<const char*>(checkpoint.state.data()),
+                  static_cast<std::streamsize>(state_size_ * sizeof(uint64_t)));
+    }
+    out.close();
+
+    if(!out || std::rename(tmp_name.c_str(), sidecar().c_str()) != 0) {
+        std::remove(tmp_name.c_str());
+        LOG(WARNING) << "Cannot write index file " << sidecar() << ", index will not be cached";
+        return false;
+    }
+
+    LOG(DEBUG) << "Wrote " << checkpoints_.size() << " checkpoints to index file " << sidecar();
+    return true;
+}
+
+bool SeekIndex::add(double time, uint64_t offset, std::vector<uint64_t> state) {
+    if(state.size() != state_size_) {
+        throw std::invalid_argument("checkpoint state has " + std::to_string(state.size()) + " words, expected " +
+                                    std::to_string(state_size_));
+    }
+    if(!checkpoints_.empty() && (time < checkpoints_.back().time || offset <= checkpoints_.back().offset)) {
+        return false;
+    }
+    checkpoints_.push_back({time, offset, std::move(state)});
+    return true;
+}
+
+const SeekIndex::Checkpoint* SeekIndex::find(double time) const {
+    auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), time, [](double t, const Checkpoint& checkpoint) {
+        return t < checkpoint.time;
+    });
+    if(it == checkpoints_.begin()) {
+        return nullptr;
+    }
+    return &(*std::prev(it));
+}
+
+SeekIndexSet::SeekIndexSet(std::vector<std::string> files,
+                           std::vector<uint64_t> data_offsets,
+                           const std::string& format,
+                           size_t state_size,
+                           Decoder decoder)
+    : files_(std::move(files)), data_offsets_(std::move(data_offsets)), decoder_(std::move(decoder)) {
+    if(data_offsets_.size() != files_.size()) {
+        throw std::invalid_argument("number of data offsets does not match the number of files");
+    }
+    for(const auto& file : files_) {
+        indices_.emplace_back(file, format, state_size);
+    }
+}
+
+void SeekIndexSet::build(size_t spacing) {
+    // The decoder state carries over from one file to the next, all files have to be indexed together
+    if(std::all_of(indices_.begin(), indices_.end(), [](auto& index) { return index.load(); })) {
+        LOG(INFO) << "Using cached index for " << indices_.size() << " data files";
+        return;
+    }
+
+    LOG(INFO) << "Building index of data files with one checkpoint every " << spacing << " words";
+    auto initial_state = decoder_.pack();
+    std::vector<uint64_t> block(65536);
+
+    for(size_t i = 0; i < files_.size(); i++) {
+        auto& index = indices_.at(i);
+        index.clear();
+
+        std::ifstream file(files_.at(i), std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(data_offsets_.at(i)));
+        uint64_t offset = data_offsets_.at(i);
+        size_t words_since_checkpoint = spacing;
+
+        while(file) {
+            file.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(uint64_t)));
+            auto words = static_cast<size_t>(file.gcount()) / sizeof(uint64_t);
+
+            for(size_t w = 0; w < words; w++, offset += sizeof(uint64_t), words_since_checkpoint++) {
+                double time = 0.;
+                if(decoder_.scan(block[w], time) && words_since_checkpoint >= spacing &&
+                   index.add(time, offset + sizeof(uint64_t), decoder_.pack())) {
+                    words_since_checkpoint = 0;
+                }
+            }
+        }
+
+        LOG(DEBUG) << "Index for " << files_.at(i) << " contains " << index.size() << " checkpoints";
+        index.write();
+    }
+
+    // Reset the decoder to start reading from the beginning
+    decoder_.unpack(initial_state);
+}
+
+bool SeekIndexSet::seek(std::vector<std::unique_ptr<std::ifstream>>& streams,
+                        std::vector<std::unique_ptr<std::ifstream>>::iterator& current,
+                        double time) {
+    // Find the last file containing a checkpoint before the target time
+    auto current_file = static_cast<size_t>(std::distance(streams.begin(), current));
+    for(size_t i = indices_.size(); i-- > current_file;) {
+        auto checkpoint = indices_.at(i).find(time);
+        if(checkpoint == nullptr) {
+            continue;
+        }
+
+        // Only ever jump forward, all skipped data is before the requested time
+        if(i == current_file) {
+            auto position = streams.at(i)->tellg();
+            if(position < 0 || checkpoint->offset <= static_cast<uint64_t>(position)) {
+                return false;
+            }
+        }
+
+        LOG(DEBUG) << "Jumping to checkpoint at byte " << checkpoint->offset << " of file " << files_.at(i);
+        current = streams.begin() + static_cast<std::ptrdiff_t>(i);
+        (*current)->clear();
+        (*current)->seekg(static_cast<std::streamoff>(checkpoint->offset));
+        decoder_.unpack(checkpoint->state);
+        return true;
+    }
+    return false;
+}
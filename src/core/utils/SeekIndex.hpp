@@ -0,0 +1,182 @@
+/**
+ * @file
+ * @brief Definition of the time-to-offset index for sequentially read raw data files
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CORRYVRECKAN_SEEK_INDEX_H
+#define CORRYVRECKAN_SEEK_INDEX_H
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace corryvreckan {
+    /**
+     * @brief Sparse index of checkpoints in a time-sorted raw data file
+     *
+     * Every checkpoint stores a time, the byte offset in the file at which decoding can be resumed, and the state of the
+     * decoder (e.g. the last seen long timestamp or overflow counters) required to correctly decode the data following the
+     * offset. The content of the state words is defined by the event loader using the index.
+     *
+     * Times are stored in the raw units of the data format, without any configurable offsets applied, such that the index
+     * remains valid when the configuration of the event loader changes.
+     *
+     * The index can be cached in a sidecar file next to the data file, which is reused as long as the size and
+     * modification time of the data file and the format identifier match.
+     */
+    class SeekIndex {
+    public:
+        /**
+         * @brief Single checkpoint of the index
+         */
+        struct Checkpoint {
+            double time;
+            uint64_t offset;
+            std::vector<uint64_t> state;
+        };
+
+        /**
+         * @brief Construct an empty index for a data file
+         * @param data_file Path to the data file this index describes
+         * @param format Identifier of the data format and decoder version, used to invalidate cached indices
+         * @param state_size Number of decoder state words stored with every checkpoint
+         */
+        SeekIndex(std::string data_file, std::string format, size_t state_size);
+
+        /**
+         * @brief Get the path of the sidecar file used to cache the index
+         * @return Path of the sidecar file
+         */
+        std::string sidecar() const { return data_file_ + ".corryidx"; }
+
+        /**
+         * @brief Load the index from its sidecar file
+         * @return True if the sidecar exists and matches the data file and format, false otherwise
+         */
+        bool load();
+
+        /**
+         * @brief Write the index to its sidecar file
+         * @return True if the sidecar could be written, false otherwise
+         */
+        bool write() const;
+
+        /**
+         * @brief Append a checkpoint to the index
+         * @param time Time of the checkpoint in raw units of the data format
+         * @param offset Byte offset in the data file
+         * @param state Decoder state words, must have the size given at construction
+         * @return True if the checkpoint was added, false if it would break the time ordering of the index
+         */
+        bool add(double time, uint64_t offset, std::vector<uint64_t> state);
+
+        /**
+         * @brief Find the last checkpoint at or before a given time
+         * @param time Time in raw units of the data format
+         * @return Pointer to the checkpoint or nullptr if all checkpoints are later than the given time
+         */
+        const Checkpoint* find(double time) const;
+
+        /**
+         * @brief Get all checkpoints of the index
+         * @return Checkpoints, sorted by time
+         */
+        const std::vector<Checkpoint>& checkpoints() const { return checkpoints_; }
+
+        /**
+         * @brief Remove all checkpoints from the index
+         */
+        void clear() { checkpoints_.clear(); }
+
+        bool empty() const { return checkpoints_.empty(); }
+        size_t size() const { return checkpoints_.size(); }
+
+    private:
+        /**
+         * @brief Read size and modification time of the data file
+         * @param size Size of the data file in bytes
+         * @param mtime Modification time of the data file
+         * @return True if the file could be accessed
+         */
+        bool file_signature(uint64_t& size, int64_t& mtime) const;
+
+        std::string data_file_;
+        std::string format_;
+        size_t state_size_;
+        std::vector<Checkpoint> checkpoints_;
+    };
+
+    /**
+     * @brief Indices of a sequence of data files which are decoded as one continuous stream of 64-bit words
+     *
+     * Building the indices and seeking to a checkpoint are independent of the data format. The event loader only provides
+     * a \ref Decoder to save and restore its state and to decode single words while the files are scanned. Since the
+     * decoder state carries over from one file to the next, the indices of all files are built and cached together.
+     */
+    class SeekIndexSet {
+    public:
+        /**
+         * @brief Format-specific part of the indexing, provided by the event loader
+         */
+        struct Decoder {
+            // Get the current decoder state words
+            std::function<std::vector<uint64_t>()> pack;
+            // Restore a decoder state
+            std::function<void(const std::vector<uint64_t>&)> unpack;
+            // Decode a data word during indexing, return true and the raw time if a checkpoint may follow the word
+            std::function<bool(uint64_t word, double& time)> scan;
+        };
+
+        /**
+         * @brief Construct empty indices for a sequence of data files
+         * @param files Paths of the data files in the order they are decoded
+         * @param data_offsets Byte offset of the first data word in every file, i.e. the size of its header
+         * @param format Identifier of the data format and decoder version, used to invalidate cached indices
+         * @param state_size Number of decoder state words stored with every checkpoint
+         * @param decoder Format-specific decoding functions
+         */
+        SeekIndexSet(std::vector<std::string> files,
+                     std::vector<uint64_t> data_offsets,
+                     const std::string& format,
+                     size_t state_size,
+                     Decoder decoder);
+
+        /**
+         * @brief Load the indices from their sidecar files, or scan all data files and cache the indices
+         * @param spacing Minimum number of data words between two checkpoints
+         *
+         * The decoder state is reset to the state before scanning once the indices are built.
+         */
+        void build(size_t spacing);
+
+        /**
+         * @brief Jump forward to the last checkpoint before a given time
+         * @param streams Open streams of all data files
+         * @param current Stream currently read from, moved to the stream of the selected checkpoint
+         * @param time Time in raw units of the data format
+         * @return True if a checkpoint was found and the stream and decoder state have been changed
+         *
+         * Data is never skipped backwards, checkpoints before the current read position are ignored.
+         */
+        bool seek(std::vector<std::unique_ptr<std::ifstream>>& streams,
+                  std::vector<std::unique_ptr<std::ifstream>>::iterator& current,
+                  double time);
+
+    private:
+        std::vector<std::string> files_;
+        std::vector<uint64_t> data_offsets_;
+        std::vector<SeekIndex> indices_;
+        Decoder decoder_;
+    };
+} // namespace corryvreckan
+
+#endif // CORRYVRECKAN_SEEK_INDEX_H
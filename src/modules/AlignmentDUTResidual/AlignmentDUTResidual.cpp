@@ -22,6 +22,11 @@ using namespace corryvreckan;
 TrackVector AlignmentDUTResidual::globalTracks;
 std::shared_ptr<Detector> AlignmentDUTResidual::globalDetector;
 ThreadPool* AlignmentDUTResidual::thread_pool;
+std::vector<std::pair<AlignmentRecords::Line, AlignmentRecords::Measurement>> AlignmentDUTResidual::globalMeasurements;
+std::vector<std::vector<Cluster*>> AlignmentDUTResidual::globalAssociatedClusters;
+size_t AlignmentDUTResidual::batches;
+std::vector<double> AlignmentDUTResidual::batch_results;
+std::vector<std::shared_future<void>> AlignmentDUTResidual::batch_futures;
 std::shared_ptr<TFormula> AlignmentDUTResidual::formula_residual_x;
 std::shared_ptr<TFormula> AlignmentDUTResidual::formula_residual_y;
 
@@ -39,12 +44,18 @@ AlignmentDUTResidual::AlignmentDUTResidual(Configuration& config, std::shared_pt
     config_.setDefault<double>("spatial_cut_sensoredge", 0.);
     config_.setDefault<unsigned int>("workers", std::max(std::thread::hardware_concurrency() - 1, 1u));
     config_.setDefaultArray<std::string>("residuals", {"x - y", "x - y"});
+    config_.setDefault<AlignmentStorage>("storage", AlignmentStorage::TRACKS);
 
     m_workers = config.get<unsigned int>("workers");
     nIterations = config_.get<size_t>("iterations");
     m_pruneTracks = config_.get<bool>("prune_tracks");
     m_spatial_cut_sensoredge = config_.get<double>("spatial_cut_sensoredge");
 
+    m_storage = config_.get<AlignmentStorage>("storage");
+    if(m_storage != AlignmentStorage::TRACKS) {
+        m_records = std::make_unique<AlignmentRecords>(m_storage);
+    }
+
     m_alignPosition = config_.get<bool>("align_position");
     m_alignOrientation = config_.get<bool>("align_orientation");
     m_alignPosition_axes = config_.get<std::string>("align_position_axes");
@@ -149,11 +160,26 @@ StatusCode AlignmentDUTResidual::run(const std::shared_ptr<Clipboard>& clipboard
         }
         LOG(TRACE) << "Cloning track with track model \"" << track->getType() << "\" for alignment";
 
-        // Keep this track on persistent storage for alignment:
-        alignmenttracks.push_back(track);
-        // Append associated clusters to the list we want to keep:
-        for(const auto& cluster : associated_clusters) {
-            alignmentclusters[m_detector->getName()].push_back(cluster);
+        if(m_records != nullptr) {
+            // Only keep the associated clusters and the track state at the DUT. The DUT does not take part in the track
+            // fit, so moving it only changes the intersection of this line with its plane
+            std::vector<AlignmentRecords::Measurement> record;
+            for(const auto& cluster : associated_clusters) {
+                record.push_back(m_records->measurement(cluster, AlignmentRecords::ASSOCIATED));
+            }
+            AlignmentRecords::Line line;
+            line.state = track->getState(m_detector->getName());
+            line.direction = track->getDirection(m_detector->getName());
+            line.chi2 = track->getChi2();
+            line.fitted = track->isFitted();
+            m_records->add(record, line);
+        } else {
+            // Keep this track on persistent storage for alignment:
+            alignmenttracks.push_back(track);
+            // Append associated clusters to the list we want to keep:
+            for(const auto& cluster : associated_clusters) {
+                alignmentclusters[m_detector->getName()].push_back(cluster);
+            }
         }
 
         // Find the cluster that needs to have its position recalculated
@@ -197,11 +223,17 @@ StatusCode AlignmentDUTResidual::run(const std::shared_ptr<Clipboard>& clipboard
         }
 
         // Since we need to refit the full track, also store the track clusters:
-        for(const auto& cluster : track->getClusters()) {
-            alignmentclusters[cluster->detectorID()].push_back(cluster);
+        if(m_records == nullptr) {
+            for(const auto& cluster : track->getClusters()) {
+                alignmentclusters[cluster->detectorID()].push_back(cluster);
+            }
         }
     }
 
+    if(m_records != nullptr) {
+        return StatusCode::Success;
+    }
+
     // Store all tracks we want for alignment on the permanent storage:
     clipboard->putPersistentData(alignmenttracks, m_detector->getName());
 
@@ -229,10 +261,58 @@ void AlignmentDUTResidual::MinimiseResiduals(Int_t&, Double_t*, Double_t& result
     // The chi2 value to be returned
     result = 0.;
 
+    // Evaluate contiguous batches of tracks, one task per batch. The contributions are stored per track and summed up in
+    // order afterwards such that the result does not depend on the number of workers
+    auto evaluate = [](size_t size, auto&& contribution) {
+        AlignmentDUTResidual::batch_results.resize(size);
+        AlignmentDUTResidual::batch_futures.clear();
+
+        const size_t range = size / AlignmentDUTResidual::batches + 1;
+        for(size_t begin = 0; begin < size; begin += range) {
+            const size_t end = std::min(begin + range, size);
+            AlignmentDUTResidual::batch_futures.push_back(
+                AlignmentDUTResidual::thread_pool->submit([&contribution, begin, end]() {
+                    for(size_t i = begin; i < end; i++) {
+                        AlignmentDUTResidual::batch_results[i] = contribution(i);
+                    }
+                }));
+        }
+        for(auto& batch_future : AlignmentDUTResidual::batch_futures) {
+            batch_future.get();
+        }
+        AlignmentDUTResidual::thread_pool->wait();
+
+        double sum = 0.;
+        for(const auto& batch_result : AlignmentDUTResidual::batch_results) {
+            sum += batch_result;
+        }
+        return sum;
+    };
+
+    // Compact records: the telescope tracks do not depend on the DUT alignment and are kept fixed
+    if(!AlignmentDUTResidual::globalMeasurements.empty()) {
+        const auto& measurements = AlignmentDUTResidual::globalMeasurements;
+        result = evaluate(measurements.size(), [&measurements](size_t i) {
+            const auto& line = measurements[i].first;
+            const auto& cluster = measurements[i].second;
+            return residualChi2(line.localIntercept(*AlignmentDUTResidual::globalDetector),
+                                XYZPoint(cluster.x, cluster.y, 0),
+                                cluster.column,
+                                cluster.row,
+                                cluster.error_x,
+                                cluster.error_y);
+        });
+
+        LOG_PROGRESS(INFO, "t") << "Evaluated " << measurements.size() << " residuals, MINUIT iteration "
+                                << fitIterations;
+        fitIterations++;
+        return;
+    }
+
     LOG(DEBUG) << "Looping over " << AlignmentDUTResidual::globalTracks.size() << " tracks";
 
-    std::vector<std::shared_future<double>> result_futures;
-    auto track_refit = [&](auto& track) {
+    auto track_refit = [](size_t i) {
+        auto& track = AlignmentDUTResidual::globalTracks[i];
         LOG(TRACE) << "track has chi2 " << track->getChi2();
         // Update geometry of plane with new detector geometry and refit to obtain new track state, need to check if the fit
         // has failed in previous iteration
@@ -254,58 +334,59 @@ void AlignmentDUTResidual::MinimiseResiduals(Int_t&, Double_t*, Double_t& result
             return 0.0;
         }
 
-        double track_result = 0.;
-
-        // Find the cluster that needs to have its position recalculated
-        for(auto& associatedCluster : track->getAssociatedClusters(AlignmentDUTResidual::globalDetector->getName())) {
-
-            // Get the track intercept with the detector
-            auto position = associatedCluster->local();
-            auto intercept = AlignmentDUTResidual::globalDetector->getLocalIntercept(track.get());
-
-            // Calculate the residuals in local coordinates
-            double residualX = formula_residual_x->Eval(intercept.X(), position.X());
-            double residualY = formula_residual_y->Eval(intercept.Y(), position.Y());
-
-            double errorX = associatedCluster->errorX();
-            double errorY = associatedCluster->errorY();
+        // Get the track intercept with the detector
+        auto intercept = AlignmentDUTResidual::globalDetector->getLocalIntercept(track.get());
 
-            // Recalculate for polar detectors
-            if(AlignmentDUTResidual::globalDetector->is<PolarDetector>()) {
-                auto polar_det = std::dynamic_pointer_cast<PolarDetector>(AlignmentDUTResidual::globalDetector);
-                // Convert cluster and intercept positions to polar coordinates
-                auto cluster_polar = polar_det->getPolarPosition(associatedCluster->column(), associatedCluster->row());
-                auto intercept_polar = polar_det->getPolarPosition(intercept);
-
-                // Interpreting (Phi,R) as (X,Y)
-                residualX = intercept_polar.phi() - cluster_polar.phi();
-                residualY = intercept_polar.r() - cluster_polar.r();
-            }
-
-            LOG(TRACE) << "- track has intercept (" << intercept.X() << "," << intercept.Y() << ")";
-            LOG(DEBUG) << "- cluster has position (" << position.X() << "," << position.Y() << ")";
-
-            double deltachi2 = (residualX * residualX) / (errorX * errorX) + (residualY * residualY) / (errorY * errorY);
-            LOG(TRACE) << "- delta chi2 = " << deltachi2;
-            // Add the new residual2
-            track_result += deltachi2;
-            LOG(TRACE) << "- result is now " << result;
+        // Add the new residual2 of all associated clusters
+        double track_result = 0.;
+        for(auto& associatedCluster : AlignmentDUTResidual::globalAssociatedClusters[i]) {
+            track_result += residualChi2(intercept,
+                                         associatedCluster->local(),
+                                         associatedCluster->column(),
+                                         associatedCluster->row(),
+                                         associatedCluster->errorX(),
+                                         associatedCluster->errorY());
         }
         return track_result;
     };
 
-    // Loop over all tracks
-    for(auto& track : AlignmentDUTResidual::globalTracks) {
-        result_futures.push_back(AlignmentDUTResidual::thread_pool->submit(track_refit, track));
-    }
+    result = evaluate(AlignmentDUTResidual::globalTracks.size(), track_refit);
+
+    LOG_PROGRESS(INFO, "t") << "Refit of " << AlignmentDUTResidual::globalTracks.size() << " track, MINUIT iteration "
+                            << fitIterations;
+    fitIterations++;
+}
 
-    for(auto& result_future : result_futures) {
-        result += result_future.get();
+// Chi2 contribution of one associated cluster given the local track intercept
+double AlignmentDUTResidual::residualChi2(const XYZPoint& intercept,
+                                          const XYZPoint& position,
+                                          double column,
+                                          double row,
+                                          double errorX,
+                                          double errorY) {
+
+    // Calculate the residuals in local coordinates
+    double residualX = formula_residual_x->Eval(intercept.X(), position.X());
+    double residualY = formula_residual_y->Eval(intercept.Y(), position.Y());
+
+    // Recalculate for polar detectors
+    if(AlignmentDUTResidual::globalDetector->is<PolarDetector>()) {
+        auto polar_det = std::dynamic_pointer_cast<PolarDetector>(AlignmentDUTResidual::globalDetector);
+        // Convert cluster and intercept positions to polar coordinates
+        auto cluster_polar = polar_det->getPolarPosition(column, row);
+        auto intercept_polar = polar_det->getPolarPosition(intercept);
+
+        // Interpreting (Phi,R) as (X,Y)
+        residualX = intercept_polar.phi() - cluster_polar.phi();
+        residualY = intercept_polar.r() - cluster_polar.r();
     }
 
-    LOG_PROGRESS(INFO, "t") << "Refit of " << result_futures.size() << " track, MINUIT iteration " << fitIterations;
-    fitIterations++;
-    AlignmentDUTResidual::thread_pool->wait();
+    LOG(TRACE) << "- track has intercept (" << intercept.X() << "," << intercept.Y() << ")";
+    LOG(DEBUG) << "- cluster has position (" << position.X() << "," << position.Y() << ")";
+
+    double deltachi2 = (residualX * residualX) / (errorX * errorX) + (residualY * residualY) / (errorY * errorY);
+    LOG(TRACE) << "- delta chi2 = " << deltachi2;
+    return deltachi2;
 }
 
 void AlignmentDUTResidual::SetResidualsFunctions() {
@@ -363,7 +444,28 @@ void AlignmentDUTResidual::finalize(const std::shared_ptr<ReadonlyClipboard>& cl
     residualFitter->SetFCN(MinimiseResiduals);
 
     // Set the global parameters
-    AlignmentDUTResidual::globalTracks = clipboard->getPersistentData<Track>(m_detector->getName());
+    if(m_records != nullptr) {
+        // Pair every associated cluster with the stored track line
+        m_records->forEachBlock([&](const auto& data, const auto& offsets, const auto& lines) {
+            for(size_t i = 0; i + 1 < offsets.size(); i++) {
+                if(!lines[i].fitted) {
+                    continue;
+                }
+                for(auto j = offsets[i]; j < offsets[i + 1]; j++) {
+                    AlignmentDUTResidual::globalMeasurements.emplace_back(lines[i], data[j]);
+                }
+            }
+        });
+        LOG(INFO) << "Aligning with " << AlignmentDUTResidual::globalMeasurements.size() << " associated clusters from "
+                  << m_records->size() << " track records";
+    } else {
+        AlignmentDUTResidual::globalTracks = clipboard->getPersistentData<Track>(m_detector->getName());
+
+        // Cache the associated clusters of every track, they do not change during the minimisation
+        for(auto& track : AlignmentDUTResidual::globalTracks) {
+            AlignmentDUTResidual::globalAssociatedClusters.push_back(track->getAssociatedClusters(m_detector->getName()));
+        }
+    }
 
     // Create thread pool:
     ThreadPool::registerThreadCount(m_workers);
@@ -377,6 +479,9 @@ void AlignmentDUTResidual::finalize(const std::shared_ptr<ReadonlyClipboard>& cl
                            corryvreckan::Log::setFormat(log_format);
                        });
 
+    // Split the tracks into a few batches per worker to balance the load of tracks with different refit times
+    AlignmentDUTResidual::batches = 4 * static_cast<size_t>(m_workers);
+
     // Set the printout arguments of the fitter
     Double_t arglist[10];
     arglist[0] = -1;
@@ -397,27 +502,24 @@ void AlignmentDUTResidual::finalize(const std::shared_ptr<ReadonlyClipboard>& cl
     auto name = m_detector->getName();
 
     size_t n_getAssociatedClusters = 0;
-    // count associated clusters:
-    for(auto& track : AlignmentDUTResidual::globalTracks) {
-        auto associatedClusters = track->getAssociatedClusters(name);
-        for(auto& associatedCluster : associatedClusters) {
-            std::string detectorID = associatedCluster->detectorID();
-            if(detectorID != name) {
-                continue;
-            }
+    // count tracks with associated clusters:
+    for(const auto& associatedClusters : AlignmentDUTResidual::globalAssociatedClusters) {
+        if(!associatedClusters.empty()) {
             n_getAssociatedClusters++;
-            break;
         }
     }
-    if(n_getAssociatedClusters < AlignmentDUTResidual::globalTracks.size() / 2) {
-        LOG(WARNING) << "Only "
-                     << 100 * static_cast<double>(n_getAssociatedClusters) /
-                            static_cast<double>(AlignmentDUTResidual::globalTracks.size())
-                     << "% of all tracks have associated clusters on detector " << name;
-    } else {
-        LOG(INFO) << 100 * static_cast<double>(n_getAssociatedClusters) /
-                         static_cast<double>(AlignmentDUTResidual::globalTracks.size())
-                  << "% of all tracks have associated clusters on detector " << name;
+    // Compact records only contain tracks with associated clusters
+    if(!AlignmentDUTResidual::globalTracks.empty()) {
+        if(n_getAssociatedClusters < AlignmentDUTResidual::globalTracks.size() / 2) {
+            LOG(WARNING) << "Only "
+                         << 100 * static_cast<double>(n_getAssociatedClusters) /
+                                static_cast<double>(AlignmentDUTResidual::globalTracks.size())
+                         << "% of all tracks have associated clusters on detector " << name;
+        } else {
+            LOG(INFO) << 100 * static_cast<double>(n_getAssociatedClusters) /
+                             static_cast<double>(AlignmentDUTResidual::globalTracks.size())
+                      << "% of all tracks have associated clusters on detector " << name;
+        }
     }
 
     LOG(STATUS) << name << " initial alignment: " << std::endl
@@ -519,5 +621,8 @@ void AlignmentDUTResidual::finalize(const std::shared_ptr<ReadonlyClipboard>& cl
 
     // Clean up local track storage
     AlignmentDUTResidual::globalTracks.clear();
+    AlignmentDUTResidual::globalMeasurements.clear();
+    AlignmentDUTResidual::globalAssociatedClusters.clear();
+    AlignmentDUTResidual::batch_results.clear();
     AlignmentDUTResidual::globalDetector.reset();
 }
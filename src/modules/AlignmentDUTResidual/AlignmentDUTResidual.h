@@ -17,6 +17,7 @@
 #include <iostream>
 
 #include "core/module/Module.hpp"
+#include "core/utils/AlignmentRecords.hpp"
 #include "core/utils/ThreadPool.hpp"
 #include "objects/Cluster.hpp"
 #include "objects/Pixel.hpp"
@@ -65,6 +66,12 @@ namespace corryvreckan {
 
     private:
         static void MinimiseResiduals(Int_t& npar, Double_t* grad, Double_t& result, Double_t* par, Int_t flag);
+        static double residualChi2(const ROOT::Math::XYZPoint& intercept,
+                                   const ROOT::Math::XYZPoint& position,
+                                   double column,
+                                   double row,
+                                   double errorX,
+                                   double errorY);
         void SetResidualsFunctions();
 
         std::shared_ptr<Detector> m_detector;
@@ -74,6 +81,18 @@ namespace corryvreckan {
         static TrackVector globalTracks;
         static std::shared_ptr<Detector> globalDetector;
         static ThreadPool* thread_pool;
+        static std::vector<std::pair<AlignmentRecords::Line, AlignmentRecords::Measurement>> globalMeasurements;
+
+        // Associated clusters of every track on the DUT, collected once before the minimisation
+        static std::vector<std::vector<Cluster*>> globalAssociatedClusters;
+
+        // Number of batches the tracks are split into for every evaluation, and buffers reused between evaluations
+        static size_t batches;
+        static std::vector<double> batch_results;
+        static std::vector<std::shared_future<void>> batch_futures;
+
+        AlignmentStorage m_storage;
+        std::unique_ptr<AlignmentRecords> m_records;
 
         unsigned int m_workers;
         size_t nIterations;
@@ -0,0 +1,280 @@
+/**
+ * @file
+ * @brief Implementation of module AlignmentDrift
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "AlignmentDrift.h"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include "core/config/ConfigReader.hpp"
+
+using namespace corryvreckan;
+
+namespace {
+    // Time unit of the polynomial coefficients, the formulae are evaluated with the time in framework units
+    const double polynomial_time_unit = 1e9;
+
+    std::string format_number(double value) {
+        std::ostringstream out;
+        out << std::setprecision(12) << value;
+        return out.str();
+    }
+} // namespace
+
+AlignmentDrift::AlignmentDrift(Configuration& config, std::shared_ptr<Detector> detector)
+    : Module(config, detector), m_detector(detector) {
+
+    config_.setDefault<double>("time_slice", Units::get<double>(1, "s"));
+    config_.setDefault<size_t>("min_tracks", 100);
+    config_.setDefault<double>("max_track_chi2ndof", 10.);
+    config_.setDefault<bool>("align_rotation", true);
+    config_.setDefault<OutputFormat>("output_format", OutputFormat::PIECEWISE);
+    config_.setDefault<size_t>("polynomial_order", 1);
+    config_.setDefault<std::string>("output_file", "alignment_" + m_detector->getName());
+
+    time_slice_ = config_.get<double>("time_slice");
+    if(time_slice_ <= 0) {
+        throw InvalidValueError(config_, "time_slice", "Time slices need to have a positive length");
+    }
+    min_tracks_ = config_.get<size_t>("min_tracks");
+    max_track_chi2ndof_ = config_.get<double>("max_track_chi2ndof");
+    align_rotation_ = config_.get<bool>("align_rotation");
+    output_format_ = config_.get<OutputFormat>("output_format");
+    polynomial_order_ = config_.get<size_t>("polynomial_order");
+    output_file_ = config_.get<std::string>("output_file");
+
+    // The residuals are linearized around the fixed geometry of the detector
+    if(m_detector->hasVariableAlignment()) {
+        throw ModuleError("Cannot measure the alignment drift with variable alignment of detector \"" +
+                          m_detector->getName() + "\"");
+    }
+}
+
+StatusCode AlignmentDrift::run(const std::shared_ptr<Clipboard>& clipboard) {
+
+    const auto& name = m_detector->getName();
+    const auto normal = m_detector->normal();
+    const auto toLocal = m_detector->toLocal();
+
+    for(auto& track : clipboard->getData<Track>()) {
+        if(!track->isFitted() || track->getChi2ndof() > max_track_chi2ndof_) {
+            continue;
+        }
+
+        // Associated cluster for DUTs, cluster on the track for telescope planes
+        Cluster* cluster = nullptr;
+        if(m_detector->isDUT()) {
+            cluster = track->getClosestCluster(name);
+        } else {
+            for(auto* track_cluster : track->getClusters()) {
+                if(track_cluster->detectorID() == name) {
+                    cluster = track_cluster;
+                    break;
+                }
+            }
+        }
+        if(cluster == nullptr) {
+            continue;
+        }
+
+        auto intercept = m_detector->getLocalIntercept(track.get());
+        auto direction = track->getDirection(name);
+
+        // Change of the local intercept when moving the detector by a global displacement d, keeping the track fixed:
+        // the plane is crossed at a path length (d.n)/(t.n) further along the track direction t
+        Eigen::Matrix<double, 2, 3> jacobian;
+        for(int axis = 0; axis < 2; axis++) {
+            XYZVector displacement(axis == 0 ? 1. : 0., axis == 1 ? 1. : 0., 0.);
+            auto shift = toLocal * (direction * (displacement.Dot(normal) / direction.Dot(normal)) - displacement);
+            jacobian.col(axis) << shift.x(), shift.y();
+        }
+        // Rotating the detector by a small angle around its normal rotates the local intercept in the opposite direction
+        jacobian.col(2) << intercept.y(), -intercept.x();
+
+        Eigen::Vector2d residual(cluster->local().x() - intercept.x(), cluster->local().y() - intercept.y());
+        Eigen::Vector2d weight(1. / (cluster->errorX() * cluster->errorX()), 1. / (cluster->errorY() * cluster->errorY()));
+
+        auto& slice = slices_[static_cast<int64_t>(std::floor(track->timestamp() / time_slice_))];
+        slice.matrix += jacobian.transpose() * weight.asDiagonal() * jacobian;
+        slice.vector += jacobian.transpose() * weight.asDiagonal() * residual;
+        slice.tracks++;
+    }
+
+    return StatusCode::Success;
+}
+
+std::string AlignmentDrift::build_formula(const std::vector<Result>& results,
+                                          int component,
+                                          std::vector<double>& parameters) const {
+    const double nominal = (component == 0 ? m_detector->displacement().X() : m_detector->displacement().Y());
+    std::string formula;
+
+    if(output_format_ == OutputFormat::PIECEWISE) {
+        // Constant position within every slice, gaps between slices are attributed to the following slice
+        for(size_t i = 0; i < results.size(); i++) {
+            std::string condition;
+            if(i > 0) {
+                condition += "x>=" + format_number(results[i].start);
+            }
+            if(i + 1 < results.size()) {
+                condition += (condition.empty() ? "" : "&&") + std::string("x<") + format_number(results[i + 1].start);
+            }
+            formula += (i > 0 ? "+" : "") + std::string("[") + std::to_string(i) + "]";
+            if(!condition.empty()) {
+                formula += "*(" + condition + ")";
+            }
+            parameters.push_back(nominal + results[i].correction(component));
+        }
+        return formula;
+    }
+
+    // Weighted least-squares fit of a polynomial to the positions of all slices
+    auto order = std::min(polynomial_order_, results.size() - 1);
+    if(order < polynomial_order_) {
+        LOG(WARNING) << "Only " << results.size() << " time slices available, reducing polynomial order to " << order;
+    }
+    const auto rows = static_cast<Eigen::Index>(results.size());
+    const auto cols = static_cast<Eigen::Index>(order + 1);
+    Eigen::MatrixXd design(rows, cols);
+    Eigen::VectorXd values(rows);
+    for(Eigen::Index i = 0; i < rows; i++) {
+        const auto& result = results[static_cast<size_t>(i)];
+        const double time = 0.5 * (result.start + result.end) / polynomial_time_unit;
+        const double weight = 1. / result.error(component);
+        for(Eigen::Index k = 0; k < cols; k++) {
+            design(i, k) = weight * std::pow(time, static_cast<double>(k));
+        }
+        values(i) = weight * (nominal + result.correction(component));
+    }
+    Eigen::VectorXd coefficients = design.colPivHouseholderQr().solve(values);
+
+    const auto time = "(x/" + format_number(polynomial_time_unit) + ")";
+    for(Eigen::Index k = 0; k < cols; k++) {
+        formula += (k > 0 ? "+" : "") + std::string("[") + std::to_string(k) + "]";
+        if(k > 0) {
+            formula += "*" + time + (k > 1 ? "^" + std::to_string(k) : "");
+        }
+        parameters.push_back(coefficients(k));
+    }
+    return formula;
+}
+
+void AlignmentDrift::finalize(const std::shared_ptr<ReadonlyClipboard>&) {
+
+    // Solve the alignment of all slices with sufficient statistics
+    std::vector<Result> results;
+    const auto n = (align_rotation_ ? 3 : 2);
+    for(const auto& [index, slice] : slices_) {
+        if(slice.tracks < min_tracks_) {
+            LOG(DEBUG) << "Skipping time slice " << index << " with only " << slice.tracks << " tracks";
+            continue;
+        }
+
+        Eigen::MatrixXd matrix = slice.matrix.topLeftCorner(n, n);
+        Eigen::LDLT<Eigen::MatrixXd> decomposition(matrix);
+        if(decomposition.info() != Eigen::Success || !decomposition.isPositive() ||
+           std::fabs(matrix.determinant()) < std::numeric_limits<double>::epsilon()) {
+            LOG(WARNING) << "Normal equations of time slice " << index << " are singular, skipping";
+            continue;
+        }
+
+        Result result{static_cast<double>(index) * time_slice_,
+                      static_cast<double>(index + 1) * time_slice_,
+                      Eigen::Vector3d::Zero(),
+                      Eigen::Vector3d::Zero()};
+        result.correction.head(n) = decomposition.solve(slice.vector.head(n));
+        result.error.head(n) = decomposition.solve(Eigen::MatrixXd::Identity(n, n)).diagonal().cwiseSqrt();
+        results.push_back(result);
+    }
+
+    LOG(INFO) << "Solved alignment of " << results.size() << " out of " << slices_.size() << " time slices";
+    if(results.empty()) {
+        LOG(ERROR) << "No time slice with at least " << min_tracks_ << " tracks, cannot determine alignment drift of "
+                   << m_detector->getName();
+        return;
+    }
+
+    // Plots of the alignment as function of time
+    const auto first = slices_.begin()->first;
+    const auto last = slices_.rbegin()->first;
+    tracks_vs_time_ = new TH1D("tracks_vs_time",
+                               "Tracks per time slice;time [s];tracks",
+                               static_cast<int>(last - first + 1),
+                               static_cast<double>(Units::convert(static_cast<double>(first) * time_slice_, "s")),
+                               static_cast<double>(Units::convert(static_cast<double>(last + 1) * time_slice_, "s")));
+    for(const auto& [index, slice] : slices_) {
+        tracks_vs_time_->SetBinContent(static_cast<int>(index - first) + 1, static_cast<double>(slice.tracks));
+    }
+
+    displacement_x_vs_time_ = new TGraphErrors();
+    displacement_y_vs_time_ = new TGraphErrors();
+    rotation_vs_time_ = new TGraphErrors();
+    for(const auto& result : results) {
+        const auto point = displacement_x_vs_time_->GetN();
+        const auto time = static_cast<double>(Units::convert(0.5 * (result.start + result.end), "s"));
+        const auto width = static_cast<double>(Units::convert(0.5 * (result.end - result.start), "s"));
+        displacement_x_vs_time_->SetPoint(point,
+                                          time,
+                                          static_cast<double>(Units::convert(
+                                              m_detector->displacement().X() + result.correction(0), "mm")));
+        displacement_x_vs_time_->SetPointError(point, width, static_cast<double>(Units::convert(result.error(0), "mm")));
+        displacement_y_vs_time_->SetPoint(point,
+                                          time,
+                                          static_cast<double>(Units::convert(
+                                              m_detector->displacement().Y() + result.correction(1), "mm")));
+        displacement_y_vs_time_->SetPointError(point, width, static_cast<double>(Units::convert(result.error(1), "mm")));
+        rotation_vs_time_->SetPoint(point, time, static_cast<double>(Units::convert(result.correction(2), "mrad")));
+        rotation_vs_time_->SetPointError(point, width, static_cast<double>(Units::convert(result.error(2), "mrad")));
+    }
+    displacement_x_vs_time_->SetTitle("Displacement X vs. time;time [s];displacement X [mm]");
+    displacement_x_vs_time_->Write("displacementX_vs_time");
+    displacement_y_vs_time_->SetTitle("Displacement Y vs. time;time [s];displacement Y [mm]");
+    displacement_y_vs_time_->Write("displacementY_vs_time");
+    if(align_rotation_) {
+        rotation_vs_time_->SetTitle("In-plane rotation correction vs. time;time [s];rotation [mrad]");
+        rotation_vs_time_->Write("rotation_vs_time");
+    }
+
+    // Time-dependent position in the format read by the detector geometry, the z position is kept fixed
+    std::vector<double> parameters;
+    auto formula_x = build_formula(results, 0, parameters);
+    auto formula_y = build_formula(results, 1, parameters);
+    auto formula_z = format_number(m_detector->displacement().Z());
+
+    std::string parameter_list;
+    for(const auto& parameter : parameters) {
+        parameter_list += (parameter_list.empty() ? "" : ", ") + format_number(parameter);
+    }
+
+    auto detector_config = m_detector->getConfiguration();
+    detector_config.setText("position", "\"" + formula_x + "\", \"" + formula_y + "\", \"" + formula_z + "\"");
+    detector_config.setText("position_parameters", parameter_list);
+    if(output_format_ == OutputFormat::PIECEWISE) {
+        // Update often enough to switch to the position of the next slice in time
+        detector_config.set("alignment_update_granularity", time_slice_ / 100, {"ns", "us", "ms", "s"});
+    } else {
+        detector_config.set("alignment_update_granularity", time_slice_, {"ns", "us", "ms", "s"});
+    }
+
+    auto path = createOutputFile(output_file_, "geo");
+    std::ofstream file(path);
+    if(!file) {
+        throw ModuleError("Cannot create geometry file " + path);
+    }
+    ConfigReader geometry;
+    geometry.addConfiguration(detector_config);
+    geometry.write(file);
+    LOG(STATUS) << "Wrote time-dependent alignment of " << m_detector->getName() << " with " << results.size()
+                << " time slices to " << path;
+}
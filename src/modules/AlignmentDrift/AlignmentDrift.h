@@ -0,0 +1,114 @@
+/**
+ * @file
+ * @brief Definition of module AlignmentDrift
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef AlignmentDrift_H
+#define AlignmentDrift_H 1
+
+#include <TGraphErrors.h>
+#include <TH1D.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "core/module/Module.hpp"
+#include "objects/Cluster.hpp"
+#include "objects/Track.hpp"
+
+namespace corryvreckan {
+
+    /** @ingroup Modules
+     * @brief Module to measure a time-dependent alignment of a detector from the drift of its track residuals
+     *
+     * The residuals of all tracks are linearized with respect to the position and in-plane rotation of the detector and
+     * accumulated in time slices. At the end of the run, the alignment of every slice is solved for and the positions are
+     * written as time-dependent formulae in the geometry file format.
+     */
+    class AlignmentDrift : public Module {
+
+        /**
+         * @brief Representation of the time-dependent position written to the geometry file
+         */
+        enum class OutputFormat {
+            PIECEWISE,  ///< Constant position per time slice
+            POLYNOMIAL, ///< Polynomial in time fitted to the positions of all slices
+        };
+
+        /**
+         * @brief Normal equations of the alignment corrections accumulated for one time slice
+         */
+        struct Slice {
+            Eigen::Matrix3d matrix{Eigen::Matrix3d::Zero()};
+            Eigen::Vector3d vector{Eigen::Vector3d::Zero()};
+            size_t tracks{};
+        };
+
+        /**
+         * @brief Alignment solved for one time slice
+         */
+        struct Result {
+            double start;
+            double end;
+            Eigen::Vector3d correction;
+            Eigen::Vector3d error;
+        };
+
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param detector Pointer to the detector for this module instance
+         */
+        AlignmentDrift(Configuration& config, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Accumulate the linearized residuals of all tracks in their time slice
+         */
+        StatusCode run(const std::shared_ptr<Clipboard>& clipboard) override;
+
+        /**
+         * @brief Solve the alignment of all time slices and write the time-dependent geometry
+         */
+        void finalize(const std::shared_ptr<ReadonlyClipboard>& clipboard) override;
+
+    private:
+        /**
+         * @brief Build the formulae and parameters of one position component
+         * @param results Alignment of all time slices
+         * @param component Index of the position component
+         * @param parameters Parameters of the formula are appended to this vector
+         * @return Formula of the position component as function of time
+         */
+        std::string build_formula(const std::vector<Result>& results, int component, std::vector<double>& parameters) const;
+
+        std::shared_ptr<Detector> m_detector;
+
+        // Streaming accumulation of the normal equations, one entry per time slice
+        std::map<int64_t, Slice> slices_;
+
+        double time_slice_;
+        size_t min_tracks_;
+        double max_track_chi2ndof_;
+        bool align_rotation_;
+        OutputFormat output_format_;
+        size_t polynomial_order_;
+        std::string output_file_;
+
+        TH1D* tracks_vs_time_{};
+        TGraphErrors* displacement_x_vs_time_{};
+        TGraphErrors* displacement_y_vs_time_{};
+        TGraphErrors* rotation_vs_time_{};
+    };
+} // namespace corryvreckan
+#endif // AlignmentDrift_H
@@ -0,0 +1,404 @@
+/**
+ * @file
+ * @brief Implementation of module AlignmentIterative
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "AlignmentIterative.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+
+#include <Eigen/Dense>
+
+#include "tools/cuts.h"
+
+using namespace corryvreckan;
+
+AlignmentIterative::AlignmentIterative(Configuration& config, std::vector<std::shared_ptr<Detector>> detectors)
+    : Module(config, std::move(detectors)) {
+
+    config_.setDefault<AlignmentStorage>("storage", AlignmentStorage::RECORDS);
+    config_.setDefault<size_t>("min_hits_on_track", 6);
+    config_.setDefault<double>("max_track_chi2ndof", 10.);
+    config_.setDefault<size_t>("max_iterations", 20);
+    config_.setDefault<size_t>("min_tracks", 100);
+    config_.setDefault<double>("tolerance_position", Units::get<double>(0.1, "um"));
+    config_.setDefault<double>("tolerance_orientation", Units::get<double>(0.01, "mrad"));
+    config_.setDefault<bool>("align_position", true);
+    config_.setDefault<bool>("align_orientation", true);
+
+    if(config_.count({"time_cut_rel", "time_cut_abs"}) == 0) {
+        config_.setDefault("time_cut_rel", 3.0);
+    }
+    if(config_.count({"spatial_cut_rel", "spatial_cut_abs"}) == 0) {
+        config_.setDefault("spatial_cut_rel", 3.0);
+    }
+
+    // timing cut, relative (x * time_resolution) or absolute:
+    time_cuts_ = corryvreckan::calculate_cut<double>("time_cut", config_, get_regular_detectors(false));
+    // spatial cut, relative (x * spatial_resolution) or absolute:
+    spatial_cuts_ = corryvreckan::calculate_cut<XYVector>("spatial_cut", config_, get_regular_detectors(false));
+
+    auto storage = config_.get<AlignmentStorage>("storage");
+    if(storage == AlignmentStorage::TRACKS) {
+        throw InvalidValueError(config_, "storage", "Clusters can only be cached as records in memory or in a file");
+    }
+    events_ = std::make_unique<AlignmentRecords>(storage);
+
+    min_hits_on_track_ = config_.get<size_t>("min_hits_on_track");
+    if(min_hits_on_track_ < 3) {
+        throw InvalidValueError(config_, "min_hits_on_track", "At least three clusters are required for unbiased residuals");
+    }
+    max_track_chi2ndof_ = config_.get<double>("max_track_chi2ndof");
+    max_iterations_ = config_.get<size_t>("max_iterations");
+    min_tracks_ = config_.get<size_t>("min_tracks");
+    tolerance_position_ = config_.get<double>("tolerance_position");
+    tolerance_orientation_ = config_.get<double>("tolerance_orientation");
+    align_position_ = config_.get<bool>("align_position");
+    align_orientation_ = config_.get<bool>("align_orientation");
+
+    // Check that we're not in a variable-alignment situation:
+    for(auto& detector : get_regular_detectors(false)) {
+        if(detector->hasVariableAlignment()) {
+            throw ModuleError("Cannot perform alignment procedure with variable alignment of detector \"" +
+                              detector->getName() + "\"");
+        }
+    }
+}
+
+void AlignmentIterative::initialize() {
+
+    auto fixed_planes = config_.getArray<std::string>("fixed_planes", {});
+    for(auto& detector : get_regular_detectors(false)) {
+        // Register planes in order such that the plane index of the records matches the detector index
+        events_->plane(detector->getName());
+        planes_.push_back(detector);
+        fixed_.push_back(detector->isReference() || std::find(fixed_planes.begin(), fixed_planes.end(),
+                                                              detector->getName()) != fixed_planes.end());
+        LOG(DEBUG) << "Caching clusters of detector " << detector->getName() << (fixed_.back() ? " (fixed)" : "");
+    }
+
+    tracks_per_iteration_ = new TH1F("tracks_per_iteration",
+                                     "Tracks per iteration;iteration;tracks",
+                                     static_cast<int>(max_iterations_),
+                                     -0.5,
+                                     static_cast<double>(max_iterations_) - 0.5);
+}
+
+StatusCode AlignmentIterative::run(const std::shared_ptr<Clipboard>& clipboard) {
+
+    std::vector<AlignmentRecords::Measurement> event;
+    size_t planes_with_clusters = 0;
+    for(const auto& detector : planes_) {
+        auto clusters = clipboard->getData<Cluster>(detector->getName());
+        if(!clusters.empty()) {
+            planes_with_clusters++;
+        }
+        for(const auto& cluster : clusters) {
+            event.push_back(events_->measurement(cluster.get()));
+        }
+    }
+
+    // Events without enough planes with clusters can never provide a track
+    if(planes_with_clusters >= min_hits_on_track_) {
+        events_->add(event);
+    }
+
+    return StatusCode::Success;
+}
+
+void AlignmentIterative::find_tracks(AlignmentRecords& tracks) const {
+
+    // Order of the planes along the beam with the current geometry
+    std::vector<uint32_t> order(planes_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](auto a, auto b) {
+        return planes_[a]->displacement().z() < planes_[b]->displacement().z();
+    });
+
+    std::vector<std::vector<std::pair<size_t, XYZPoint>>> clusters(planes_.size());
+    std::vector<uint32_t> hit_planes;
+    std::vector<AlignmentRecords::Measurement> track;
+
+    events_->forEachBlock([&](const auto& data, const auto& offsets, const auto&) {
+        for(size_t i = 0; i + 1 < offsets.size(); i++) {
+            // Global cluster positions with the current alignment
+            for(auto& plane_clusters : clusters) {
+                plane_clusters.clear();
+            }
+            for(auto j = offsets[i]; j < offsets[i + 1]; j++) {
+                const auto& measurement = data[j];
+                clusters[measurement.plane].emplace_back(
+                    j, planes_[measurement.plane]->localToGlobal(XYZPoint(measurement.x, measurement.y, 0)));
+            }
+
+            hit_planes.clear();
+            std::copy_if(order.begin(), order.end(), std::back_inserter(hit_planes), [&](auto plane) {
+                return !clusters[plane].empty();
+            });
+            if(hit_planes.size() < min_hits_on_track_) {
+                continue;
+            }
+
+            // Seed tracks with all cluster pairs of the first and last plane, as done by Tracking4D
+            const auto& first = planes_[hit_planes.front()];
+            const auto& last = planes_[hit_planes.back()];
+            auto time_cut_ref = std::max(time_cuts_.at(first), time_cuts_.at(last));
+            auto time_cut_ref_track = std::min(time_cuts_.at(first), time_cuts_.at(last));
+            for(const auto& [index_first, global_first] : clusters[hit_planes.front()]) {
+                for(const auto& [index_last, global_last] : clusters[hit_planes.back()]) {
+                    const auto timestamp = data[index_first].timestamp;
+                    if(std::fabs(timestamp - data[index_last].timestamp) > time_cut_ref) {
+                        continue;
+                    }
+
+                    AlignmentRecords::Line seed;
+                    seed.state = global_first;
+                    seed.direction = global_last - global_first;
+
+                    // Add the closest cluster within the cuts on every other plane
+                    track.assign({data[index_first], data[index_last]});
+                    for(size_t k = 1; k + 1 < hit_planes.size(); k++) {
+                        const auto& detector = planes_[hit_planes[k]];
+                        auto intercept = seed.globalIntercept(*detector);
+                        const auto& spatial_cut = spatial_cuts_.at(detector);
+                        const auto time_cut = std::max(time_cut_ref_track, time_cuts_.at(detector));
+
+                        double closest_distance = 1.;
+                        const AlignmentRecords::Measurement* closest = nullptr;
+                        for(const auto& [index, global] : clusters[hit_planes[k]]) {
+                            if(std::fabs(data[index].timestamp - timestamp) > time_cut) {
+                                continue;
+                            }
+                            double dx = (global.x() - intercept.x()) / spatial_cut.x();
+                            double dy = (global.y() - intercept.y()) / spatial_cut.y();
+                            double distance = dx * dx + dy * dy;
+                            if(distance <= closest_distance) {
+                                closest_distance = distance;
+                                closest = &data[index];
+                            }
+                        }
+                        if(closest != nullptr) {
+                            track.push_back(*closest);
+                        }
+                    }
+
+                    if(track.size() < min_hits_on_track_) {
+                        continue;
+                    }
+
+                    auto line = AlignmentRecords::fit(track.data(), track.size(), planes_);
+                    auto ndof = 2. * static_cast<double>(track.size()) - 4.;
+                    if(!line.fitted || line.chi2 / ndof > max_track_chi2ndof_) {
+                        continue;
+                    }
+                    tracks.add(track);
+                }
+            }
+        }
+    });
+}
+
+// Determine the alignment correction of one plane from the linearized unbiased residuals of all tracks with a cluster on
+// it. Every track is refitted without the cluster on this plane, the residuals r = m - p(a) between the cluster positions
+// m and the track intercepts p are expanded around the current alignment parameters a and the correction follows from
+// the normal equations (J^T W J) da = J^T W r, weighted with the cluster uncertainties.
+bool AlignmentIterative::align_plane(uint32_t plane, const AlignmentRecords& tracks) const {
+    const auto& detector = planes_[plane];
+
+    // Alignment parameters solved for, the z displacement is never aligned
+    std::vector<size_t> active;
+    if(align_position_) {
+        active.insert(active.end(), {0, 1});
+    }
+    if(align_orientation_) {
+        active.insert(active.end(), {3, 4, 5});
+    }
+    if(active.empty()) {
+        return true;
+    }
+
+    // Unbiased track lines and the clusters on this plane
+    std::vector<std::pair<AlignmentRecords::Line, AlignmentRecords::Measurement>> residuals;
+    std::vector<AlignmentRecords::Measurement> track;
+    tracks.forEachBlock([&](const auto& data, const auto& offsets, const auto&) {
+        for(size_t i = 0; i + 1 < offsets.size(); i++) {
+            track.assign(data.begin() + static_cast<std::ptrdiff_t>(offsets[i]),
+                         data.begin() + static_cast<std::ptrdiff_t>(offsets[i + 1]));
+            auto measurement = std::find_if(track.begin(), track.end(), [plane](const auto& m) { return m.plane == plane; });
+            if(measurement == track.end()) {
+                continue;
+            }
+            measurement->flags |= AlignmentRecords::ASSOCIATED;
+            auto line = AlignmentRecords::fit(track.data(), track.size(), planes_);
+            if(line.fitted) {
+                residuals.emplace_back(line, *measurement);
+            }
+        }
+    });
+    if(residuals.size() < active.size()) {
+        LOG(WARNING) << "Not enough clusters on tracks to align detector " << detector->getName();
+        return false;
+    }
+
+    auto displacement = detector->displacement();
+    auto rotation = detector->rotation();
+    std::array<double, 6> par{
+        displacement.X(), displacement.Y(), displacement.Z(), rotation.X(), rotation.Y(), rotation.Z()};
+    auto apply = [&detector](const std::array<double, 6>& p) {
+        detector->update(XYZPoint(p[0], p[1], p[2]), XYZVector(p[3], p[4], p[5]));
+    };
+    auto intercepts = [&residuals, &detector]() {
+        std::vector<XYZPoint> points;
+        points.reserve(residuals.size());
+        for(const auto& residual : residuals) {
+            points.push_back(residual.first.localIntercept(*detector));
+        }
+        return points;
+    };
+
+    // Numerical derivatives of the local track intercepts with respect to all active alignment parameters
+    const std::array<double, 6> epsilon{Units::get<double>(1, "um"),
+                                        Units::get<double>(1, "um"),
+                                        Units::get<double>(1, "um"),
+                                        Units::get<double>(1, "urad"),
+                                        Units::get<double>(1, "urad"),
+                                        Units::get<double>(1, "urad")};
+    auto nominal = intercepts();
+    std::vector<std::vector<XYZPoint>> varied;
+    for(auto index : active) {
+        auto shifted = par;
+        shifted[index] += epsilon[index];
+        apply(shifted);
+        varied.push_back(intercepts());
+    }
+    apply(par);
+
+    const auto n = static_cast<Eigen::Index>(active.size());
+    Eigen::MatrixXd matrix = Eigen::MatrixXd::Zero(n, n);
+    Eigen::VectorXd vector = Eigen::VectorXd::Zero(n);
+    Eigen::Matrix2Xd jacobian(2, n);
+    for(size_t i = 0; i < residuals.size(); i++) {
+        const auto& cluster = residuals[i].second;
+        Eigen::Vector2d residual(cluster.x - nominal[i].x(), cluster.y - nominal[i].y());
+        Eigen::Vector2d weight(1. / (cluster.error_x * cluster.error_x), 1. / (cluster.error_y * cluster.error_y));
+        for(size_t k = 0; k < active.size(); k++) {
+            jacobian.col(static_cast<Eigen::Index>(k)) << (varied[k][i].x() - nominal[i].x()) / epsilon[active[k]],
+                (varied[k][i].y() - nominal[i].y()) / epsilon[active[k]];
+        }
+        matrix += jacobian.transpose() * weight.asDiagonal() * jacobian;
+        vector += jacobian.transpose() * weight.asDiagonal() * residual;
+    }
+
+    Eigen::LDLT<Eigen::MatrixXd> decomposition(matrix);
+    if(decomposition.info() != Eigen::Success || !decomposition.isPositive()) {
+        LOG(WARNING) << "Normal equations for detector " << detector->getName()
+                     << " are singular, alignment parameters not updated";
+        return false;
+    }
+    Eigen::VectorXd correction = decomposition.solve(vector);
+    for(size_t k = 0; k < active.size(); k++) {
+        par[active[k]] += correction(static_cast<Eigen::Index>(k));
+    }
+    apply(par);
+
+    return true;
+}
+
+void AlignmentIterative::finalize(const std::shared_ptr<ReadonlyClipboard>&) {
+
+    LOG(STATUS) << "Cached clusters of " << events_->size() << " events with clusters on at least " << min_hits_on_track_
+                << " planes";
+
+    bool converged = false;
+    size_t iteration = 0;
+    while(!converged && iteration < max_iterations_) {
+
+        // Track finding with the current geometry
+        AlignmentRecords tracks;
+        find_tracks(tracks);
+        tracks_per_iteration_->SetBinContent(static_cast<int>(iteration) + 1, static_cast<double>(tracks.size()));
+        LOG(INFO) << "Iteration " << iteration << ": found " << tracks.size() << " tracks";
+        if(tracks.size() < min_tracks_) {
+            LOG(ERROR) << "Found only " << tracks.size() << " tracks, at least " << min_tracks_
+                       << " are required for the alignment. Check the prealignment and the track finding cuts";
+            break;
+        }
+
+        // Alignment step of all planes which are not fixed, the iteration converged if none of them moved significantly
+        converged = true;
+        for(uint32_t plane = 0; plane < planes_.size(); plane++) {
+            if(fixed_[plane]) {
+                continue;
+            }
+
+            const auto& detector = planes_[plane];
+            auto old_position = detector->displacement();
+            auto old_orientation = detector->rotation();
+            if(!align_plane(plane, tracks)) {
+                converged = false;
+                continue;
+            }
+
+            auto shift = detector->displacement() - old_position;
+            auto rotation = detector->rotation() - old_orientation;
+            converged &= (std::fabs(shift.X()) < tolerance_position_ && std::fabs(shift.Y()) < tolerance_position_ &&
+                          std::fabs(rotation.X()) < tolerance_orientation_ &&
+                          std::fabs(rotation.Y()) < tolerance_orientation_ &&
+                          std::fabs(rotation.Z()) < tolerance_orientation_);
+
+            const auto& name = detector->getName();
+            correction_shift_x_[name].push_back(static_cast<double>(Units::convert(shift.X(), "um")));
+            correction_shift_y_[name].push_back(static_cast<double>(Units::convert(shift.Y(), "um")));
+            correction_rot0_[name].push_back(static_cast<double>(Units::convert(rotation.X(), "deg")));
+            correction_rot1_[name].push_back(static_cast<double>(Units::convert(rotation.Y(), "deg")));
+            correction_rot2_[name].push_back(static_cast<double>(Units::convert(rotation.Z(), "deg")));
+
+            LOG(INFO) << name << "/" << iteration << " dT" << Units::display(shift, {"mm", "um"}) << " dR"
+                      << Units::display(rotation, {"deg"});
+        }
+        iteration++;
+    }
+
+    if(converged) {
+        LOG(STATUS) << "Alignment converged after " << iteration << " iterations";
+    } else {
+        LOG(WARNING) << "Alignment did not converge within " << iteration << " iterations";
+    }
+
+    for(const auto& detector : planes_) {
+        LOG(STATUS) << detector->getName() << " new alignment: " << std::endl
+                    << "T" << Units::display(detector->displacement(), {"mm", "um"}) << " R"
+                    << Units::display(detector->rotation(), {"deg"});
+    }
+
+    // Corrections per iteration for every aligned plane
+    auto write_graph = [](const std::string& name, const std::vector<double>& corrections, const std::string& unit) {
+        std::vector<double> iterations(corrections.size());
+        std::iota(iterations.begin(), iterations.end(), 0);
+        auto* graph = new TGraph(static_cast<int>(corrections.size()), iterations.data(), corrections.data());
+        graph->GetXaxis()->SetTitle("# iteration");
+        graph->GetYaxis()->SetTitle(("correction [" + unit + "]").c_str());
+        graph->Write(name.c_str());
+    };
+    for(const auto& detector : planes_) {
+        const auto& name = detector->getName();
+        if(correction_shift_x_.count(name) == 0) {
+            continue;
+        }
+        write_graph("alignment_correction_displacementX_" + name, correction_shift_x_[name], "#mum");
+        write_graph("alignment_correction_displacementY_" + name, correction_shift_y_[name], "#mum");
+        write_graph("alignment_correction_rotation0_" + name, correction_rot0_[name], "deg");
+        write_graph("alignment_correction_rotation1_" + name, correction_rot1_[name], "deg");
+        write_graph("alignment_correction_rotation2_" + name, correction_rot2_[name], "deg");
+    }
+}
@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @brief Definition of module AlignmentIterative
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef AlignmentIterative_H
+#define AlignmentIterative_H 1
+
+#include <TGraph.h>
+#include <TH1F.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/module/Module.hpp"
+#include "core/utils/AlignmentRecords.hpp"
+#include "objects/Cluster.hpp"
+
+namespace corryvreckan {
+
+    /** @ingroup Modules
+     * @brief Module to iterate track finding and telescope alignment in-process until the alignment converges
+     *
+     * The clusters of all telescope planes are cached during the event loop. At the end of the run, tracks are searched
+     * for in the cached clusters with the current geometry, all planes are aligned with the unbiased residuals of these
+     * tracks, and both steps are repeated until the corrections drop below the configured tolerances.
+     */
+    class AlignmentIterative : public Module {
+
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param detectors Vector of pointers to the detectors
+         */
+        AlignmentIterative(Configuration& config, std::vector<std::shared_ptr<Detector>> detectors);
+
+        /**
+         * @brief Register the telescope planes for the cluster cache
+         */
+        void initialize() override;
+
+        /**
+         * @brief Cache the clusters of all telescope planes of the event
+         */
+        StatusCode run(const std::shared_ptr<Clipboard>& clipboard) override;
+
+        /**
+         * @brief Iterate track finding and alignment on the cached clusters
+         */
+        void finalize(const std::shared_ptr<ReadonlyClipboard>& clipboard) override;
+
+    private:
+        /**
+         * @brief Find straight line tracks in the cached clusters with the current geometry
+         * @param tracks Record storage the measurements of all accepted tracks are appended to
+         */
+        void find_tracks(AlignmentRecords& tracks) const;
+
+        /**
+         * @brief Linearized alignment step of one plane from the unbiased residuals of all tracks with a cluster on it
+         * @param plane Index of the plane in the records
+         * @param tracks Tracks found with the current geometry
+         * @return False if the correction could not be determined
+         */
+        bool align_plane(uint32_t plane, const AlignmentRecords& tracks) const;
+
+        // Cached clusters, one record per event
+        std::unique_ptr<AlignmentRecords> events_;
+        std::vector<std::shared_ptr<Detector>> planes_;
+        std::vector<bool> fixed_;
+
+        // Track finding
+        std::map<std::shared_ptr<Detector>, double> time_cuts_;
+        std::map<std::shared_ptr<Detector>, XYVector> spatial_cuts_;
+        size_t min_hits_on_track_;
+        double max_track_chi2ndof_;
+
+        // Alignment
+        size_t max_iterations_;
+        size_t min_tracks_;
+        double tolerance_position_;
+        double tolerance_orientation_;
+        bool align_position_;
+        bool align_orientation_;
+
+        // Plots
+        TH1F* tracks_per_iteration_{};
+        std::map<std::string, std::vector<double>> correction_shift_x_;
+        std::map<std::string, std::vector<double>> correction_shift_y_;
+        std::map<std::string, std::vector<double>> correction_rot0_;
+        std::map<std::string, std::vector<double>> correction_rot1_;
+        std::map<std::string, std::vector<double>> correction_rot2_;
+    };
+} // namespace corryvreckan
+#endif // AlignmentIterative_H
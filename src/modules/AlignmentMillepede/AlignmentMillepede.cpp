@@ -11,7 +11,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <iomanip>
+#include <thread>
 
 // Local
 #include "AlignmentMillepede.h"
@@ -34,6 +36,9 @@ AlignmentMillepede::AlignmentMillepede(Configuration& config, std::vector<std::s
     config_.setDefault<int>("number_of_stddev", 0);
     config_.setDefault<double>("convergence", 0.00001);
     config_.setDefaultArray<double>("sigmas", {0.05, 0.05, 0.5, 0.005, 0.005, 0.005});
+    config_.setDefault<AlignmentStorage>("storage", AlignmentStorage::TRACKS);
+    config_.setDefault<SolverMethod>("solver", SolverMethod::INVERSION);
+    config_.setDefault<unsigned int>("workers", std::max(std::thread::hardware_concurrency() - 1, 1u));
 
     m_excludeDUT = config_.get<bool>("exclude_dut");
     m_dofs = config_.getArray<bool>("dofs");
@@ -44,6 +49,20 @@ AlignmentMillepede::AlignmentMillepede(Configuration& config, std::vector<std::s
     m_convergence = config_.get<double>("convergence");
     m_sigmas = config_.getArray<double>("sigmas");
 
+    m_storage = config_.get<AlignmentStorage>("storage");
+    if(m_storage != AlignmentStorage::TRACKS) {
+        m_records = std::make_unique<AlignmentRecords>(m_storage);
+    }
+
+    m_solver = config_.get<SolverMethod>("solver");
+    m_workers = config_.get<unsigned int>("workers");
+    if(m_workers == 0) {
+        throw InvalidValueError(config_, "workers", "number of workers should be strictly positive");
+    }
+    if(config_.has("binary_file")) {
+        m_binaryFile = config_.get<std::string>("binary_file");
+    }
+
     if(m_dofs.size() != 6) {
         throw InvalidValueError(config_, "dofs", "Invalid number of degrees of freedom.");
     }
@@ -92,6 +111,18 @@ StatusCode AlignmentMillepede::run(const std::shared_ptr<Clipboard>& clipboard)
     TrackVector alignmenttracks;
     std::map<std::string, std::vector<Cluster*>> alignmentclusters;
 
+    // Only keep the compact cluster measurements of the tracks
+    if(m_records != nullptr) {
+        for(auto& track : tracks) {
+            std::vector<AlignmentRecords::Measurement> record;
+            for(auto& cluster : track->getClusters()) {
+                record.push_back(m_records->measurement(cluster));
+            }
+            m_records->add(record);
+        }
+        return StatusCode::Success;
+    }
+
     // Make a local copy and store it
     for(auto& track : tracks) {
         alignmenttracks.push_back(track);
@@ -117,21 +148,39 @@ StatusCode AlignmentMillepede::run(const std::shared_ptr<Clipboard>& clipboard)
 void AlignmentMillepede::finalize(const std::shared_ptr<ReadonlyClipboard>& clipboard) {
 
     LOG(INFO) << "Millepede alignment";
-    auto alignmenttracks = clipboard->getPersistentData<Track>();
+    TrackVector alignmenttracks;
+    if(m_records == nullptr) {
+        alignmenttracks = clipboard->getPersistentData<Track>();
+    }
+    const size_t nTracks = (m_records != nullptr ? m_records->size() : alignmenttracks.size());
 
     size_t nPlanes = num_regular_detectors(!m_excludeDUT);
     LOG(INFO) << "Aligning " << nPlanes << " planes";
     const size_t nParameters = 6 * nPlanes;
+
+    // Create thread pool for the track refits of the global fit
+    ThreadPool::registerThreadCount(m_workers);
+    m_threadPool = std::make_unique<ThreadPool>(
+        m_workers,
+        m_workers * 1024,
+        [log_level = corryvreckan::Log::getReportingLevel(), log_format = corryvreckan::Log::getFormat()]() {
+            // Initialize the threads to the same log level and format as the master setting
+            corryvreckan::Log::setReportingLevel(log_level);
+            corryvreckan::Log::setFormat(log_format);
+        });
     for(unsigned int iteration = 0; iteration < m_nIterations; ++iteration) {
         // Define the constraint equations.
         setConstraints(nPlanes);
         const double startfact = 100.;
         // Initialise all matrices and vectors.
         reset(nPlanes, startfact);
-        LOG(INFO) << "Feeding Millepede with " << alignmenttracks.size() << " tracks...";
+        LOG(INFO) << "Feeding Millepede with " << nTracks << " tracks...";
         // Feed Millepede with tracks.
         unsigned int nSkipped = 0;
         unsigned int nOutliers = 0;
+        if(m_records != nullptr) {
+            putRecords(nPlanes, nSkipped, nOutliers);
+        }
         for(auto& track : alignmenttracks) {
             if(track->getNClusters() != nPlanes) {
                 ++nSkipped;
@@ -147,6 +196,10 @@ void AlignmentMillepede::finalize(const std::shared_ptr<ReadonlyClipboard>& clip
         if(nOutliers > 0) {
             LOG(INFO) << "Rejected " << nOutliers << " outlier tracks.";
         }
+        // Store the equations of the initial geometry for an external fit with pede.
+        if(iteration == 0 && !m_binaryFile.empty()) {
+            writeBinary(createOutputFile(m_binaryFile, "bin"), createOutputFile(m_binaryFile + "_steering", "txt"));
+        }
         // Do the global fit.
         LOG(INFO) << "Determining global parameters...";
         if(!fitGlobal()) {
@@ -164,7 +217,8 @@ void AlignmentMillepede::finalize(const std::shared_ptr<ReadonlyClipboard>& clip
         LOG(INFO) << "Updating geometry...";
         updateGeometry();
 
-        // Update the cluster coordinates based on the new geometry.
+        // Update the cluster coordinates based on the new geometry. Records are transformed with the current geometry
+        // whenever they are used.
         for(auto& track : alignmenttracks) {
             for(auto& cluster : track->getClusters()) {
                 auto detectorID = cluster->detectorID();
@@ -177,6 +231,8 @@ void AlignmentMillepede::finalize(const std::shared_ptr<ReadonlyClipboard>& clip
         if(converg < m_convergence)
             break;
     }
+
+    m_threadPool.reset();
 }
 
 //=============================================================================
@@ -268,6 +324,68 @@ void AlignmentMillepede::addConstraint(const std::vector<double>& dercs, const d
 //=============================================================================
 bool AlignmentMillepede::putTrack(Track* track, const size_t nPlanes) {
 
+    /// Refit the track for the reference states.
+    track->fit();
+    const double tx = track->getState(track->getClusters().front()->detectorID()).X();
+    const double ty = track->getState(track->getClusters().front()->detectorID()).Y();
+
+    std::vector<Measurement> measurements;
+    for(auto& cluster : track->getClusters()) {
+        if(!has_detector(cluster->detectorID())) {
+            continue;
+        }
+        measurements.push_back(
+            {get_detector(cluster->detectorID()), cluster->global(), cluster->errorX(), cluster->errorY()});
+    }
+    return putTrack(measurements, tx, ty, nPlanes);
+}
+
+//=============================================================================
+// Add the equations for all track records, using the current geometry
+//=============================================================================
+void AlignmentMillepede::putRecords(const size_t nPlanes, unsigned int& nSkipped, unsigned int& nOutliers) {
+
+    std::vector<std::shared_ptr<Detector>> planes;
+    for(const auto& name : m_records->planes()) {
+        planes.push_back(has_detector(name) ? get_detector(name) : nullptr);
+    }
+
+    std::vector<Measurement> measurements;
+    m_records->forEachBlock([&](const auto& data, const auto& offsets, const auto&) {
+        for(size_t i = 0; i + 1 < offsets.size(); i++) {
+            const auto* begin = &data[offsets[i]];
+            const auto count = offsets[i + 1] - offsets[i];
+            if(count != nPlanes || std::any_of(begin, begin + count, [&](const auto& m) { return !planes[m.plane]; })) {
+                ++nSkipped;
+                continue;
+            }
+
+            // Refit the track for the reference states.
+            auto line = AlignmentRecords::fit(begin, count, planes);
+            if(!line.fitted) {
+                ++nOutliers;
+                continue;
+            }
+            const auto reference = line.globalIntercept(*planes[begin->plane]);
+
+            measurements.clear();
+            for(const auto* m = begin; m != begin + count; m++) {
+                const auto& detector = planes[m->plane];
+                measurements.push_back(
+                    {detector, detector->localToGlobal(ROOT::Math::XYZPoint(m->x, m->y, 0.)), m->error_x, m->error_y});
+            }
+            if(!putTrack(measurements, reference.X(), reference.Y(), nPlanes)) {
+                ++nOutliers;
+            }
+        }
+    });
+}
+
+//=============================================================================
+// Add the equations for the measurements of one track to the matrix
+//=============================================================================
+bool AlignmentMillepede::putTrack(const std::vector<Measurement>& measurements, double tx, double ty, const size_t nPlanes) {
+
     std::vector<Equation> equations;
     const size_t nParameters = 6 * nPlanes;
     // Global derivatives
@@ -279,23 +397,15 @@ bool AlignmentMillepede::putTrack(Track* track, const size_t nPlanes) {
     // Track slopes
     std::vector<double> dernls(nParameters, 0.);
 
-    /// Refit the track for the reference states.
-    track->fit();
-    const double tx = track->getState(track->getClusters().front()->detectorID()).X();
-    const double ty = track->getState(track->getClusters().front()->detectorID()).Y();
-
     // Iterate over each cluster on the track.
-    for(auto& cluster : track->getClusters()) {
-        if(!has_detector(cluster->detectorID())) {
-            continue;
-        }
-        auto detector = get_detector(cluster->detectorID());
+    for(const auto& measurement : measurements) {
+        const auto& detector = measurement.detector;
         const auto normal = detector->normal();
         double nx = normal.x() / normal.z();
         double ny = normal.y() / normal.z();
-        const double xg = cluster->global().x();
-        const double yg = cluster->global().y();
-        const double zg = cluster->global().z();
+        const double xg = measurement.global.x();
+        const double yg = measurement.global.y();
+        const double zg = measurement.global.z();
         // Calculate quasi-local coordinates.
         const double zl = zg - detector->displacement().Z();
         const double xl = xg - detector->displacement().X();
@@ -306,8 +416,8 @@ bool AlignmentMillepede::putTrack(Track* track, const size_t nPlanes) {
         for(auto& a : nonlinear)
             a /= den;
         // Get the errors on the measured x and y coordinates.
-        const double errx = cluster->errorX();
-        const double erry = cluster->errorY();
+        const double errx = measurement.errorX;
+        const double erry = measurement.errorY;
         // Get the internal plane index in Millepede.
         const unsigned int plane = m_millePlanes[detector->getName()];
         // Set the local derivatives for the X equation.
@@ -361,7 +471,7 @@ bool AlignmentMillepede::putTrack(Track* track, const size_t nPlanes) {
     std::vector<double> trackParams(2 * m_nalc + 2, 0.);
     // Fit the track.
     const unsigned int iteration = 1;
-    const bool ok = fitTrack(equations, trackParams, false, iteration);
+    const bool ok = fitTrack(equations, trackParams, false, iteration, m_global);
     if(ok)
         m_equations.push_back(equations);
     return ok;
@@ -421,7 +531,8 @@ void AlignmentMillepede::addEquation(std::vector<Equation>& equations,
 bool AlignmentMillepede::fitTrack(const std::vector<Equation>& equations,
                                   std::vector<double>& trackParams,
                                   const bool singlefit,
-                                  const unsigned int iteration) {
+                                  const unsigned int iteration,
+                                  GlobalSums& sums) const {
 
     std::vector<double> blvec(m_nalc, 0.);
     std::vector<std::vector<double>> clmat(m_nalc, std::vector<double>(m_nalc, 0.));
@@ -520,7 +631,7 @@ bool AlignmentMillepede::fitTrack(const std::vector<Equation>& equations,
 
     // Local operations are finished. Track is accepted.
     // Third loop: update the global parameters (other matrices).
-    m_clcmat.assign(m_nagb, std::vector<double>(m_nalc, 0.));
+    Eigen::MatrixXd clcmat = Eigen::MatrixXd::Zero(m_nagb, m_nalc);
     unsigned int nagbn = 0;
     std::vector<int> indnz(m_nagb, -1);
     std::vector<int> indbk(m_nagb, 0);
@@ -536,12 +647,13 @@ bool AlignmentMillepede::fitTrack(const std::vector<Equation>& equations,
         // First of all, the global/global terms.
         for(size_t i = 0; i < nG; ++i) {
             const size_t j = static_cast<size_t>(equation.indG[i]);
-            m_bgvec[j] += w * rmeas * equation.derG[i];
-            LOG(DEBUG) << "bgvec[" << j << "] = " << m_bgvec[j];
+            sums.vector(static_cast<Eigen::Index>(j)) += w * rmeas * equation.derG[i];
+            LOG(DEBUG) << "bgvec[" << j << "] = " << sums.vector(static_cast<Eigen::Index>(j));
             for(size_t k = 0; k < nG; ++k) {
                 const size_t n = static_cast<size_t>(equation.indG[k]);
-                m_cgmat[j][n] += w * equation.derG[i] * equation.derG[k];
-                LOG(DEBUG) << "cgmat[" << j << "][" << n << "] = " << m_cgmat[j][n];
+                auto& element = sums.matrix(static_cast<Eigen::Index>(j), static_cast<Eigen::Index>(n));
+                element += w * equation.derG[i] * equation.derG[k];
+                LOG(DEBUG) << "cgmat[" << j << "][" << n << "] = " << element;
             }
         }
         // Now we have also rectangular matrices containing global/local terms.
@@ -560,21 +672,29 @@ bool AlignmentMillepede::fitTrack(const std::vector<Equation>& equations,
             // Now fill the rectangular matrix.
             for(size_t k = 0; k < nL; ++k) {
                 const size_t ij = static_cast<size_t>(equation.indL[k]);
-                m_clcmat[static_cast<size_t>(ik)][ij] += w * equation.derG[i] * equation.derL[k];
-                LOG(DEBUG) << "clcmat[" << ik << "][" << ij << "] = " << m_clcmat[static_cast<size_t>(ik)][ij];
+                clcmat(ik, static_cast<Eigen::Index>(ij)) += w * equation.derG[i] * equation.derL[k];
+                LOG(DEBUG) << "clcmat[" << ik << "][" << ij << "] = " << clcmat(ik, static_cast<Eigen::Index>(ij));
             }
         }
     }
 
     // Third loop is finished, now we update the correction matrices.
-    multiplyAVAt(clmat, m_clcmat, m_corrm, m_nalc, nagbn);
-    multiplyAX(m_clcmat, blvec, m_corrv, m_nalc, nagbn);
-    for(size_t i = 0; i < nagbn; ++i) {
-        const size_t j = static_cast<size_t>(indbk[i]);
-        m_bgvec[j] -= m_corrv[i];
-        for(size_t k = 0; k < nagbn; ++k) {
-            const size_t ik = static_cast<size_t>(indbk[k]);
-            m_cgmat[j][ik] -= m_corrm[i][k];
+    Eigen::MatrixXd clinv(m_nalc, m_nalc);
+    Eigen::VectorXd blv(m_nalc);
+    for(unsigned int i = 0; i < m_nalc; ++i) {
+        blv(i) = blvec[i];
+        for(unsigned int j = 0; j < m_nalc; ++j) {
+            clinv(i, j) = clmat[i][j];
+        }
+    }
+    const auto clc = clcmat.topRows(nagbn);
+    const Eigen::MatrixXd corrm = clc * clinv * clc.transpose();
+    const Eigen::VectorXd corrv = clc * blv;
+    for(unsigned int i = 0; i < nagbn; ++i) {
+        const auto j = indbk[i];
+        sums.vector(j) -= corrv(i);
+        for(unsigned int k = 0; k < nagbn; ++k) {
+            sums.matrix(j, indbk[k]) -= corrm(i, k);
         }
     }
     return true;
@@ -624,10 +744,8 @@ bool AlignmentMillepede::reset(const size_t nPlanes, const double startfact) {
     m_nagb = static_cast<unsigned int>(6 * nPlanes);
     // Reset matrices and vectors.
     const unsigned int nRows = m_nagb + static_cast<unsigned int>(m_constraints.size());
-    m_bgvec.resize(nRows, 0.);
-    m_cgmat.assign(nRows, std::vector<double>(nRows, 0.));
-    m_corrv.assign(m_nagb, 0.);
-    m_corrm.assign(m_nagb, std::vector<double>(m_nagb, 0.));
+    m_global.vector = Eigen::VectorXd::Zero(nRows);
+    m_global.matrix = Eigen::MatrixXd::Zero(nRows, nRows);
     m_dparm.assign(m_nagb, 0.);
 
     // Define the sigmas for each parameter.
@@ -665,9 +783,12 @@ bool AlignmentMillepede::reset(const size_t nPlanes, const double startfact) {
 //=============================================================================
 bool AlignmentMillepede::fitGlobal() {
 
+    auto& cgmat = m_global.matrix;
+    auto& bgvec = m_global.vector;
+    const auto nagb = static_cast<Eigen::Index>(m_nagb);
+
     m_diag.assign(m_nagb, 0.);
-    std::vector<double> bgvecPrev(m_nagb, 0.);
-    std::vector<double> trackParams(2 * m_nalc + 2, 0.);
+    Eigen::VectorXd bgvecPrev = Eigen::VectorXd::Zero(nagb);
     const size_t nTracks = m_equations.size();
     std::vector<std::vector<double>> localParams(nTracks, std::vector<double>(m_nalc, 0.));
 
@@ -683,73 +804,74 @@ bool AlignmentMillepede::fitGlobal() {
         LOG(INFO) << "Iteration " << iteration << " (using " << nGoodTracks << " tracks)";
 
         // Save the diagonal elements.
-        for(unsigned int i = 0; i < m_nagb; ++i) {
-            m_diag[i] = m_cgmat[i][i];
+        for(Eigen::Index i = 0; i < nagb; ++i) {
+            m_diag[static_cast<size_t>(i)] = cgmat(i, i);
         }
 
         unsigned int nFixed = 0;
-        for(unsigned int i = 0; i < m_nagb; ++i) {
-            if(m_fixed[i]) {
-                // Fixed global parameter.
+        for(Eigen::Index i = 0; i < nagb; ++i) {
+            const auto psigm = m_psigm[static_cast<size_t>(i)];
+            if(m_fixed[static_cast<size_t>(i)]) {
+                // Fixed global parameter, reset row and column.
                 ++nFixed;
-                for(unsigned int j = 0; j < m_nagb; ++j) {
-                    // Reset row and column.
-                    m_cgmat[i][j] = 0.0;
-                    m_cgmat[j][i] = 0.0;
-                }
+                cgmat.row(i).head(nagb).setZero();
+                cgmat.col(i).head(nagb).setZero();
             } else {
-                m_cgmat[i][i] += 1. / (m_psigm[i] * m_psigm[i]);
+                cgmat(i, i) += 1. / (psigm * psigm);
             }
         }
         // Add the constraints equations.
-        size_t nRows = static_cast<size_t>(m_nagb);
+        Eigen::Index nRows = nagb;
         for(const auto& constraint : m_constraints) {
             double sum = constraint.rhs;
-            for(unsigned int j = 0; j < m_nagb; ++j) {
-                if(m_psigm[j] == 0.) {
-                    m_cgmat[nRows][j] = 0.0;
-                    m_cgmat[j][nRows] = 0.0;
+            for(Eigen::Index j = 0; j < nagb; ++j) {
+                const auto jj = static_cast<size_t>(j);
+                if(m_psigm[jj] == 0.) {
+                    cgmat(nRows, j) = 0.0;
+                    cgmat(j, nRows) = 0.0;
                 } else {
-                    m_cgmat[nRows][j] = nGoodTracks * constraint.coefficients[j];
-                    m_cgmat[j][nRows] = m_cgmat[nRows][j];
+                    cgmat(nRows, j) = nGoodTracks * constraint.coefficients[jj];
+                    cgmat(j, nRows) = cgmat(nRows, j);
                 }
-                sum -= constraint.coefficients[j] * m_dparm[j];
+                sum -= constraint.coefficients[jj] * m_dparm[jj];
             }
-            m_cgmat[nRows][nRows] = 0.0;
-            m_bgvec[nRows] = nGoodTracks * sum;
+            cgmat(nRows, nRows) = 0.0;
+            bgvec(nRows) = nGoodTracks * sum;
             ++nRows;
         }
 
         double cor = 0.0;
         if(iteration > 1) {
-            for(unsigned int j = 0; j < m_nagb; ++j) {
-                for(unsigned int i = 0; i < m_nagb; ++i) {
-                    if(m_fixed[i])
+            for(Eigen::Index j = 0; j < nagb; ++j) {
+                for(Eigen::Index i = 0; i < nagb; ++i) {
+                    const auto ii = static_cast<size_t>(i);
+                    if(m_fixed[ii])
                         continue;
-                    cor += bgvecPrev[j] * m_cgmat[j][i] * bgvecPrev[i];
+                    cor += bgvecPrev(j) * cgmat(j, i) * bgvecPrev(i);
                     if(i == j) {
-                        cor -= bgvecPrev[i] * bgvecPrev[i] / (m_psigm[i] * m_psigm[i]);
+                        cor -= bgvecPrev(i) * bgvecPrev(i) / (m_psigm[ii] * m_psigm[ii]);
                     }
                 }
             }
         }
         LOG(DEBUG) << " Final corr. is " << cor;
 
-        // Do the matrix inversion.
-        const int rank = invertMatrix(m_cgmat, m_bgvec, nRows);
+        // Solve the system of equations.
+        const auto n = static_cast<size_t>(nRows);
+        const int rank = (m_solver == SolverMethod::LDLT ? solveLDLT(cgmat, bgvec, n) : invertMatrix(cgmat, bgvec, n));
         // Update the global parameters values.
-        for(unsigned int i = 0; i < m_nagb; ++i) {
-            m_dparm[i] += m_bgvec[i];
-            bgvecPrev[i] = m_bgvec[i];
-            LOG(DEBUG) << "bgvec[" << i << "] = " << m_bgvec[i];
-            LOG(DEBUG) << "dparm[" << i << "] = " << m_dparm[i];
-            LOG(DEBUG) << "cgmat[" << i << "][" << i << "] = " << m_cgmat[i][i];
-            LOG(DEBUG) << "err = " << sqrt(fabs(m_cgmat[i][i]));
-            LOG(DEBUG) << "cgmat * diag = " << std::setprecision(5) << m_cgmat[i][i] * m_diag[i];
+        for(Eigen::Index i = 0; i < nagb; ++i) {
+            m_dparm[static_cast<size_t>(i)] += bgvec(i);
+            bgvecPrev(i) = bgvec(i);
+            LOG(DEBUG) << "bgvec[" << i << "] = " << bgvec(i);
+            LOG(DEBUG) << "dparm[" << i << "] = " << m_dparm[static_cast<size_t>(i)];
+            LOG(DEBUG) << "cgmat[" << i << "][" << i << "] = " << cgmat(i, i);
+            LOG(DEBUG) << "err = " << sqrt(fabs(cgmat(i, i)));
+            LOG(DEBUG) << "cgmat * diag = " << std::setprecision(5) << cgmat(i, i) * m_diag[static_cast<size_t>(i)];
         }
-        if(nRows - nFixed - static_cast<unsigned int>(rank) != 0) {
-            LOG(WARNING) << "The rank defect of the symmetric " << nRows << " by " << nRows << " matrix is "
-                         << nRows - nFixed - static_cast<unsigned int>(rank);
+        if(n - nFixed - static_cast<unsigned int>(rank) != 0) {
+            LOG(WARNING) << "The rank defect of the symmetric " << n << " by " << n << " matrix is "
+                         << n - nFixed - static_cast<unsigned int>(rank);
         }
         if(!m_iterate)
             break;
@@ -765,17 +887,42 @@ bool AlignmentMillepede::fitGlobal() {
         }
         LOG(DEBUG) << "Refitting tracks with cut factor " << m_cfactr;
 
-        // Reset global variables.
-        for(unsigned int i = 0; i < nRows; ++i) {
-            m_bgvec[i] = 0.0;
-            for(unsigned int j = 0; j < nRows; ++j)
-                m_cgmat[i][j] = 0.0;
-        }
-        // Refit the tracks.
+        // Refit the tracks, this resets the global matrix and vector.
         double chi2 = 0.;
         double ndof = 0.;
-        nGoodTracks = 0;
-        for(size_t i = 0; i < nTracks; ++i) {
+        nGoodTracks = refitTracks(localParams, iteration, chi2, ndof);
+        LOG(INFO) << "Chi2 / DOF after re-fit: " << chi2 / (ndof - static_cast<double>(nRows));
+    }
+
+    // Print the final results.
+    printResults();
+    return true;
+}
+
+//=============================================================================
+// Refit all tracks and fill the global matrix and vector. Every worker sums up
+// the contributions of a contiguous range of tracks, the partial sums are
+// added in the order of the ranges afterwards.
+//=============================================================================
+unsigned int AlignmentMillepede::refitTracks(std::vector<std::vector<double>>& localParams,
+                                             const unsigned int iteration,
+                                             double& chi2,
+                                             double& ndof) {
+
+    struct Result {
+        GlobalSums sums;
+        double chi2{};
+        double ndof{};
+        unsigned int nGoodTracks{};
+    };
+
+    const auto nRows = m_global.vector.size();
+    auto refit_range = [&, nRows](size_t begin, size_t end) {
+        Result result;
+        result.sums.matrix = Eigen::MatrixXd::Zero(nRows, nRows);
+        result.sums.vector = Eigen::VectorXd::Zero(nRows);
+        std::vector<double> trackParams(2 * m_nalc + 2, 0.);
+        for(size_t i = begin; i < end; ++i) {
             // Skip invalidated tracks.
             if(m_equations[i].empty()) {
                 continue;
@@ -793,27 +940,44 @@ bool AlignmentMillepede::fitGlobal() {
             }
             std::fill(trackParams.begin(), trackParams.end(), 0.);
             // Refit the track.
-            bool ok = fitTrack(equations, trackParams, false, iteration);
+            bool ok = fitTrack(equations, trackParams, false, iteration, result.sums);
             // Cache the track state.
             for(unsigned int j = 0; j < m_nalc; ++j) {
                 localParams[i][j] = trackParams[2 * j];
             }
             if(ok) {
                 // Update the total chi2.
-                chi2 += trackParams[2 * m_nalc + 1];
-                ndof += trackParams[2 * m_nalc];
-                ++nGoodTracks;
+                result.chi2 += trackParams[2 * m_nalc + 1];
+                result.ndof += trackParams[2 * m_nalc];
+                ++result.nGoodTracks;
             } else {
                 // Disable the track.
                 m_equations[i].clear();
             }
         }
-        LOG(INFO) << "Chi2 / DOF after re-fit: " << chi2 / (ndof - static_cast<double>(nRows));
+        return result;
+    };
+
+    const size_t nTracks = m_equations.size();
+    const size_t range = nTracks / m_workers + 1;
+    std::vector<std::shared_future<Result>> results;
+    for(size_t begin = 0; begin < nTracks; begin += range) {
+        results.push_back(m_threadPool->submit(refit_range, begin, std::min(begin + range, nTracks)));
     }
 
-    // Print the final results.
-    printResults();
-    return true;
+    m_global.matrix.setZero();
+    m_global.vector.setZero();
+    unsigned int nGoodTracks = 0;
+    for(auto& future : results) {
+        const auto& result = future.get();
+        m_global.matrix += result.sums.matrix;
+        m_global.vector += result.sums.vector;
+        chi2 += result.chi2;
+        ndof += result.ndof;
+        nGoodTracks += result.nGoodTracks;
+    }
+    m_threadPool->wait();
+    return nGoodTracks;
 }
 
 //=============================================================================
@@ -822,68 +986,69 @@ bool AlignmentMillepede::fitGlobal() {
 // Solve the equation V * X = B.
 // V is replaced by its inverse matrix and B by X, the solution vector
 //=============================================================================
-int AlignmentMillepede::invertMatrix(std::vector<std::vector<double>>& v, std::vector<double>& b, const size_t n) {
+int AlignmentMillepede::invertMatrix(Eigen::MatrixXd& v, Eigen::VectorXd& b, const size_t size) {
+    const auto n = static_cast<Eigen::Index>(size);
     int rank = 0;
     const double eps = 0.0000000000001;
 
-    std::vector<double> diag(n, 0.);
-    std::vector<bool> used_param(n, true);
-    std::vector<bool> flag(n, true);
-    for(size_t i = 0; i < n; i++) {
-        for(size_t j = 0; j <= i; j++) {
-            v[j][i] = v[i][j];
+    Eigen::VectorXd diag = Eigen::VectorXd::Zero(n);
+    Eigen::Array<bool, Eigen::Dynamic, 1> used_param = Eigen::Array<bool, Eigen::Dynamic, 1>::Constant(n, true);
+    Eigen::Array<bool, Eigen::Dynamic, 1> flag = Eigen::Array<bool, Eigen::Dynamic, 1>::Constant(n, true);
+    for(Eigen::Index i = 0; i < n; i++) {
+        for(Eigen::Index j = 0; j <= i; j++) {
+            v(j, i) = v(i, j);
         }
     }
 
     // Find max. elements of each row and column.
-    std::vector<double> r(n, 0.);
-    std::vector<double> c(n, 0.);
-    for(size_t i = 0; i < n; i++) {
-        for(size_t j = 0; j < n; j++) {
-            if(fabs(v[i][j]) >= r[i])
-                r[i] = fabs(v[i][j]);
-            if(fabs(v[j][i]) >= c[i])
-                c[i] = fabs(v[j][i]);
+    Eigen::VectorXd r = Eigen::VectorXd::Zero(n);
+    Eigen::VectorXd c = Eigen::VectorXd::Zero(n);
+    for(Eigen::Index i = 0; i < n; i++) {
+        for(Eigen::Index j = 0; j < n; j++) {
+            if(fabs(v(i, j)) >= r(i))
+                r(i) = fabs(v(i, j));
+            if(fabs(v(j, i)) >= c(i))
+                c(i) = fabs(v(j, i));
         }
     }
-    for(size_t i = 0; i < n; i++) {
-        if(0.0 != r[i])
-            r[i] = 1. / r[i];
-        if(0.0 != c[i])
-            c[i] = 1. / c[i];
+    for(Eigen::Index i = 0; i < n; i++) {
+        if(0.0 != r(i))
+            r(i) = 1. / r(i);
+        if(0.0 != c(i))
+            c(i) = 1. / c(i);
         // Check if max elements are within requested precision.
-        if(eps >= r[i])
-            r[i] = 0.0;
-        if(eps >= c[i])
-            c[i] = 0.0;
+        if(eps >= r(i))
+            r(i) = 0.0;
+        if(eps >= c(i))
+            c(i) = 0.0;
     }
 
     // Equilibrate the V matrix
-    for(size_t i = 0; i < n; i++) {
-        for(size_t j = 0; j < n; j++) {
-            v[i][j] = sqrt(r[i]) * v[i][j] * sqrt(c[j]);
+    for(Eigen::Index i = 0; i < n; i++) {
+        for(Eigen::Index j = 0; j < n; j++) {
+            v(i, j) = sqrt(r(i)) * v(i, j) * sqrt(c(j));
         }
     }
 
-    for(size_t i = 0; i < n; i++) {
+    for(Eigen::Index i = 0; i < n; i++) {
         // Save the absolute values of the diagonal elements.
-        diag[i] = fabs(v[i][i]);
-        if(r[i] == 0. && c[i] == 0.) {
+        diag(i) = fabs(v(i, i));
+        if(r(i) == 0. && c(i) == 0.) {
             // This part is empty (non-linear treatment with non constraints)
-            flag[i] = false;
-            used_param[i] = false;
+            flag(i) = false;
+            used_param(i) = false;
         }
     }
 
-    for(size_t i = 0; i < n; i++) {
+    for(Eigen::Index i = 0; i < n; i++) {
         double vkk = 0.0;
 
-        size_t k = 0;
+        Eigen::Index k = 0;
         bool found_k = false;
         // First look for the pivot, i. e. the max unused diagonal element.
-        for(size_t j = 0; j < n; j++) {
-            if(flag[j] && (fabs(v[j][j]) > std::max(fabs(vkk), eps))) {
-                vkk = v[j][j];
+        for(Eigen::Index j = 0; j < n; j++) {
+            if(flag(j) && (fabs(v(j, j)) > std::max(fabs(vkk), eps))) {
+                vkk = v(j, j);
                 k = j;
                 found_k = true;
             }
@@ -893,32 +1058,32 @@ int AlignmentMillepede::invertMatrix(std::vector<std::vector<double>>& v, std::v
             // Pivot found.
             rank++;
             // Use this value.
-            flag[k] = false;
+            flag(k) = false;
             // Replace pivot by its inverse.
             vkk = 1.0 / vkk;
-            v[k][k] = -vkk;
-            for(size_t j = 0; j < n; j++) {
-                for(size_t jj = 0; jj < n; jj++) {
-                    if(j != k && jj != k && used_param[j] && used_param[jj]) {
-                        // Other elements (do them first as you use old v[k][j])
-                        v[j][jj] = v[j][jj] - vkk * v[j][k] * v[k][jj];
+            v(k, k) = -vkk;
+            for(Eigen::Index j = 0; j < n; j++) {
+                for(Eigen::Index jj = 0; jj < n; jj++) {
+                    if(j != k && jj != k && used_param(j) && used_param(jj)) {
+                        // Other elements (do them first as you use old v(k, j))
+                        v(j, jj) = v(j, jj) - vkk * v(j, k) * v(k, jj);
                     }
                 }
             }
-            for(size_t j = 0; j < n; j++) {
-                if(j != k && used_param[j]) {
-                    v[j][k] = v[j][k] * vkk;
-                    v[k][j] = v[k][j] * vkk;
+            for(Eigen::Index j = 0; j < n; j++) {
+                if(j != k && used_param(j)) {
+                    v(j, k) = v(j, k) * vkk;
+                    v(k, j) = v(k, j) * vkk;
                 }
             }
         } else {
             // No more pivot value (clear those elements)
-            for(size_t j = 0; j < n; j++) {
-                if(flag[j]) {
-                    b[j] = 0.0;
-                    for(size_t l = 0; l < n; l++) {
-                        v[j][k] = 0.0;
-                        v[k][j] = 0.0;
+            for(Eigen::Index j = 0; j < n; j++) {
+                if(flag(j)) {
+                    b(j) = 0.0;
+                    for(Eigen::Index l = 0; l < n; l++) {
+                        v(j, k) = 0.0;
+                        v(k, j) = 0.0;
                     }
                 }
             }
@@ -926,31 +1091,194 @@ int AlignmentMillepede::invertMatrix(std::vector<std::vector<double>>& v, std::v
         }
     }
     // Correct matrix V
-    for(size_t i = 0; i < n; i++) {
-        for(size_t j = 0; j < n; j++) {
-            v[i][j] = sqrt(c[i]) * v[i][j] * sqrt(r[j]);
+    for(Eigen::Index i = 0; i < n; i++) {
+        for(Eigen::Index j = 0; j < n; j++) {
+            v(i, j) = sqrt(c(i)) * v(i, j) * sqrt(r(j));
         }
     }
 
-    std::vector<double> temp(n, 0.);
-    for(size_t j = 0; j < n; j++) {
+    Eigen::VectorXd temp = Eigen::VectorXd::Zero(n);
+    for(Eigen::Index j = 0; j < n; j++) {
         // Reverse matrix elements
-        for(size_t jj = 0; jj < n; jj++) {
-            v[j][jj] = -v[j][jj];
-            temp[j] += v[j][jj] * b[jj];
+        for(Eigen::Index jj = 0; jj < n; jj++) {
+            v(j, jj) = -v(j, jj);
+            temp(j) += v(j, jj) * b(jj);
         }
     }
 
-    for(size_t j = 0; j < n; j++) {
-        b[j] = temp[j];
+    for(Eigen::Index j = 0; j < n; j++) {
+        b(j) = temp(j);
     }
     return rank;
 }
 
+//=============================================================================
+// Solve the equation V * X = B of the global fit with Lagrange multipliers for
+// the constraints,
+//   ( C  G^T ) ( x )   ( b )
+//   ( G   0  ) ( l ) = ( c ),
+// using a Cholesky decomposition of the positive definite matrix C of the free
+// parameters: x = C^-1 (b - G^T l), where the multipliers l follow from the
+// Schur complement S = G C^-1 G^T. Fixed parameters and empty constraints are
+// skipped. As for the inversion, V is replaced by its inverse and B by X.
+//=============================================================================
+int AlignmentMillepede::solveLDLT(Eigen::MatrixXd& v, Eigen::VectorXd& b, const size_t size) {
+    const auto n = static_cast<Eigen::Index>(size);
+    const auto nagb = static_cast<Eigen::Index>(m_nagb);
+
+    // Select the free parameters and the constraints acting on them.
+    std::vector<Eigen::Index> parameters;
+    for(Eigen::Index i = 0; i < nagb; ++i) {
+        if(v(i, i) != 0.) {
+            parameters.push_back(i);
+        }
+    }
+    std::vector<Eigen::Index> constraints;
+    for(Eigen::Index i = nagb; i < n; ++i) {
+        if(std::any_of(parameters.begin(), parameters.end(), [&](auto j) { return v(i, j) != 0.; })) {
+            constraints.push_back(i);
+        }
+    }
+
+    const auto np = static_cast<Eigen::Index>(parameters.size());
+    const auto nc = static_cast<Eigen::Index>(constraints.size());
+    Eigen::MatrixXd C(np, np);
+    Eigen::MatrixXd G(nc, np);
+    Eigen::VectorXd bp(np);
+    Eigen::VectorXd bc(nc);
+    for(Eigen::Index i = 0; i < np; ++i) {
+        const auto pi = parameters[static_cast<size_t>(i)];
+        bp(i) = b(pi);
+        for(Eigen::Index j = 0; j < np; ++j) {
+            // Use the lower triangle, as the inversion does
+            const auto pj = parameters[static_cast<size_t>(j)];
+            C(i, j) = (pi >= pj ? v(pi, pj) : v(pj, pi));
+        }
+        for(Eigen::Index k = 0; k < nc; ++k) {
+            G(k, i) = v(constraints[static_cast<size_t>(k)], pi);
+        }
+    }
+    for(Eigen::Index k = 0; k < nc; ++k) {
+        bc(k) = b(constraints[static_cast<size_t>(k)]);
+    }
+
+    v.topLeftCorner(n, n).setZero();
+    b.head(n).setZero();
+
+    Eigen::LDLT<Eigen::MatrixXd> decomposition(C);
+    if(decomposition.info() != Eigen::Success || !decomposition.isPositive()) {
+        LOG(ERROR) << "Cholesky decomposition of the global matrix failed, parameters not updated";
+        return 0;
+    }
+    Eigen::MatrixXd covariance = decomposition.solve(Eigen::MatrixXd::Identity(np, np));
+    Eigen::VectorXd x = decomposition.solve(bp);
+    Eigen::VectorXd multipliers = Eigen::VectorXd::Zero(nc);
+    Eigen::MatrixXd CinvGt = decomposition.solve(G.transpose());
+    Eigen::MatrixXd Sinv = Eigen::MatrixXd::Zero(nc, nc);
+    if(nc > 0) {
+        Eigen::LDLT<Eigen::MatrixXd> schur(G * CinvGt);
+        if(schur.info() != Eigen::Success || !schur.isPositive()) {
+            LOG(ERROR) << "Constraint equations of the global fit are degenerate, parameters not updated";
+            return 0;
+        }
+        Sinv = schur.solve(Eigen::MatrixXd::Identity(nc, nc));
+        multipliers = Sinv * (G * x - bc);
+        x -= CinvGt * multipliers;
+        covariance -= CinvGt * Sinv * CinvGt.transpose();
+    }
+
+    // Store the solution and the corresponding blocks of the inverse matrix.
+    const Eigen::MatrixXd cross = CinvGt * Sinv;
+    for(Eigen::Index i = 0; i < np; ++i) {
+        const auto pi = parameters[static_cast<size_t>(i)];
+        b(pi) = x(i);
+        for(Eigen::Index j = 0; j < np; ++j) {
+            v(pi, parameters[static_cast<size_t>(j)]) = covariance(i, j);
+        }
+        for(Eigen::Index k = 0; k < nc; ++k) {
+            v(pi, constraints[static_cast<size_t>(k)]) = cross(i, k);
+            v(constraints[static_cast<size_t>(k)], pi) = cross(i, k);
+        }
+    }
+    for(Eigen::Index k = 0; k < nc; ++k) {
+        const auto ck = constraints[static_cast<size_t>(k)];
+        b(ck) = multipliers(k);
+        for(Eigen::Index l = 0; l < nc; ++l) {
+            v(ck, constraints[static_cast<size_t>(l)]) = -Sinv(k, l);
+        }
+    }
+    return static_cast<int>(np + nc);
+}
+
+//=============================================================================
+// Write the equations of all accepted tracks in the Millepede-II binary format
+// (one record per track with the measurement, local derivatives, uncertainty and
+// global derivatives of every equation) and a steering file for pede with the
+// parameter uncertainties and the constraint equations.
+//=============================================================================
+void AlignmentMillepede::writeBinary(const std::string& binaryFile, const std::string& steeringFile) const {
+
+    std::ofstream binary(binaryFile, std::ios::binary);
+    if(!binary.good()) {
+        throw ModuleError("Cannot write Millepede binary file " + binaryFile);
+    }
+
+    std::vector<float> floats;
+    std::vector<int> ints;
+    for(const auto& equations : m_equations) {
+        // The first word is reserved as error counter.
+        floats.assign(1, 0.f);
+        ints.assign(1, 0);
+        for(const auto& equation : equations) {
+            floats.push_back(static_cast<float>(equation.rmeas));
+            ints.push_back(0);
+            for(size_t i = 0; i < equation.derL.size(); ++i) {
+                floats.push_back(static_cast<float>(equation.derL[i]));
+                ints.push_back(equation.indL[i] + 1);
+            }
+            floats.push_back(static_cast<float>(1. / std::sqrt(equation.weight)));
+            ints.push_back(0);
+            for(size_t i = 0; i < equation.derG.size(); ++i) {
+                floats.push_back(static_cast<float>(equation.derG[i]));
+                ints.push_back(equation.indG[i] + 1);
+            }
+        }
+
+        const auto words = static_cast<int>(2 * floats.size());
+        binary.write(reinterpret_cast<const char*>(&words), sizeof(words));
+        binary.write(reinterpret_cast<const char*>(floats.data()),
+                     static_cast<std::streamsize>(floats.size() * sizeof(float)));
+        binary.write(reinterpret_cast<const char*>(ints.data()), static_cast<std::streamsize>(ints.size() * sizeof(int)));
+    }
+    LOG(STATUS) << "Wrote equations of " << m_equations.size() << " tracks to Millepede binary file " << binaryFile;
+
+    std::ofstream steering(steeringFile);
+    if(!steering.good()) {
+        throw ModuleError("Cannot write pede steering file " + steeringFile);
+    }
+    steering << "Cfiles" << std::endl << binaryFile << std::endl << std::endl;
+    steering << "Parameter" << std::endl;
+    for(unsigned int i = 0; i < m_nagb; ++i) {
+        steering << (i + 1) << " 0.0 " << (m_fixed[i] ? -1. : m_psigm[i]) << std::endl;
+    }
+    for(const auto& constraint : m_constraints) {
+        steering << std::endl << "Constraint " << constraint.rhs << std::endl;
+        for(unsigned int i = 0; i < m_nagb; ++i) {
+            if(constraint.coefficients[i] != 0. && !m_fixed[i]) {
+                steering << (i + 1) << " " << constraint.coefficients[i] << std::endl;
+            }
+        }
+    }
+    steering << std::endl << "method inversion 5 0.1" << std::endl << "end" << std::endl;
+    LOG(STATUS) << "Wrote pede steering file " << steeringFile;
+}
+
 //=============================================================================
 // Simplified version.
 //=============================================================================
-int AlignmentMillepede::invertMatrixLocal(std::vector<std::vector<double>>& v, std::vector<double>& b, const size_t n) {
+int AlignmentMillepede::invertMatrixLocal(std::vector<std::vector<double>>& v,
+                                          std::vector<double>& b,
+                                          const size_t n) const {
 
     int rank = 0;
     const double eps = 0.0000000000001;
@@ -1052,61 +1380,6 @@ double AlignmentMillepede::chi2Limit(const int n, const int nd) const {
     return ((sn[m - 1] + sqrt(float(2 * nd - 3))) * (sn[m - 1] + sqrt(float(2 * nd - 3)))) / float(2 * nd - 2);
 }
 
-//=============================================================================
-// Multiply general M-by-N matrix A and N-vector X
-//=============================================================================
-bool AlignmentMillepede::multiplyAX(const std::vector<std::vector<double>>& a,
-                                    const std::vector<double>& x,
-                                    std::vector<double>& y,
-                                    const unsigned int n,
-                                    const unsigned int m) {
-
-    // Y = A * X, where
-    //   A = general M-by-N matrix
-    //   X = N vector
-    //   Y = M vector
-    for(unsigned int i = 0; i < m; ++i) {
-        y[i] = 0.0;
-        for(unsigned int j = 0; j < n; ++j) {
-            y[i] += a[i][j] * x[j];
-        }
-    }
-    return true;
-}
-
-//=============================================================================
-// Multiply symmetric N-by-N matrix V from the left with general M-by-N
-// matrix A and from the right with the transposed of the same general
-// matrix to form a symmetric M-by-M matrix W.
-//=============================================================================
-bool AlignmentMillepede::multiplyAVAt(const std::vector<std::vector<double>>& v,
-                                      const std::vector<std::vector<double>>& a,
-                                      std::vector<std::vector<double>>& w,
-                                      const unsigned int n,
-                                      const unsigned int m) {
-
-    // W = A * V * AT, where
-    //   V = symmetric N-by-N matrix
-    //   A = general N-by-M matrix
-    //   W = symmetric M-by-M matrix
-    for(unsigned int i = 0; i < m; ++i) {
-        for(unsigned int j = 0; j <= i; ++j) {
-            // Reset the final matrix.
-            w[i][j] = 0.0;
-            // Fill the upper left triangle.
-            for(unsigned int k = 0; k < n; ++k) {
-                for(unsigned int l = 0; l < n; ++l) {
-                    w[i][j] += a[i][k] * v[k][l] * a[j][l];
-                }
-            }
-            // Fill the rest.
-            w[j][i] = w[i][j];
-        }
-    }
-
-    return true;
-}
-
 //=============================================================================
 // Print results
 //=============================================================================
@@ -1118,17 +1391,17 @@ bool AlignmentMillepede::printResults() {
     LOG(INFO) << "   I  Difference    Last step      Error        Pull Global corr.";
     LOG(INFO) << line;
     for(unsigned int i = 0; i < m_nagb; ++i) {
-        double err = sqrt(fabs(m_cgmat[i][i]));
-        if(m_cgmat[i][i] < 0.0)
+        double err = sqrt(fabs(m_global.matrix(i, i)));
+        if(m_global.matrix(i, i) < 0.0)
             err = -err;
-        if(fabs(m_cgmat[i][i] * m_diag[i]) > 0) {
+        if(fabs(m_global.matrix(i, i) * m_diag[i]) > 0) {
             // Calculate the pull.
-            const double pull = m_dparm[i] / sqrt(m_psigm[i] * m_psigm[i] - m_cgmat[i][i]);
+            const double pull = m_dparm[i] / sqrt(m_psigm[i] * m_psigm[i] - m_global.matrix(i, i));
             // Calculate the global correlation coefficient
             // (correlation between the parameter and all the other variables).
-            const double gcor = sqrt(fabs(1.0 - 1.0 / (m_cgmat[i][i] * m_diag[i])));
+            const double gcor = sqrt(fabs(1.0 - 1.0 / (m_global.matrix(i, i) * m_diag[i])));
             LOG(INFO) << std::setprecision(3) << std::scientific << std::setw(3) << i << "   " << std::setw(10) << m_dparm[i]
-                      << "   " << std::setw(10) << m_bgvec[i] << "   " << std::setw(8) << std::setprecision(2) << err
+                      << "   " << std::setw(10) << m_global.vector(i) << "   " << std::setw(8) << std::setprecision(2) << err
                       << "   " << std::setw(9) << std::setprecision(2) << pull << "   " << std::setw(9) << gcor;
         } else {
             LOG(INFO) << std::setw(3) << i << "   " << std::setw(10) << "OFF" << "   " << std::setw(10) << "OFF" << "   "
@@ -1138,7 +1411,8 @@ bool AlignmentMillepede::printResults() {
             LOG(INFO) << line;
     }
     for(unsigned int i = 0; i < m_nagb; ++i) {
-        LOG(DEBUG) << " i=" << i << "  sqrt(fabs(cgmat[i][i]))=" << sqrt(fabs(m_cgmat[i][i])) << " diag = " << m_diag[i];
+        LOG(DEBUG) << " i=" << i << "  sqrt(fabs(cgmat[i][i]))=" << sqrt(fabs(m_global.matrix(i, i)))
+                   << " diag = " << m_diag[i];
     }
 
     return true;
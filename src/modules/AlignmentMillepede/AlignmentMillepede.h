@@ -12,7 +12,11 @@
 #ifndef AlignmentMillepede_H
 #define AlignmentMillepede_H 1
 
+#include <Eigen/Dense>
+
 #include "core/module/Module.hpp"
+#include "core/utils/AlignmentRecords.hpp"
+#include "core/utils/ThreadPool.hpp"
 #include "objects/Track.hpp"
 
 namespace corryvreckan {
@@ -44,6 +48,14 @@ namespace corryvreckan {
         virtual void updateGeometry();
 
     private:
+        /**
+         * @brief Method used to solve the system of equations of the global fit
+         */
+        enum class SolverMethod {
+            INVERSION, ///< Inversion of the full matrix including constraints using Gauss pivoting
+            LDLT,      ///< Cholesky decomposition of the normal equations, constraints solved via their Schur complement
+        };
+
         struct Equation {
             double rmeas;
             double weight;
@@ -55,6 +67,17 @@ namespace corryvreckan {
             std::vector<double> derNL;
             std::vector<double> slopes;
         };
+        struct Measurement {
+            std::shared_ptr<Detector> detector;
+            ROOT::Math::XYZPoint global;
+            double errorX;
+            double errorY;
+        };
+        /// Normal equations of the global fit, filled by the local fits of the tracks
+        struct GlobalSums {
+            Eigen::MatrixXd matrix;
+            Eigen::VectorXd vector;
+        };
         struct Constraint {
             /// Right-hand side (Lagrange multiplier)
             double rhs;
@@ -70,6 +93,10 @@ namespace corryvreckan {
         void addConstraint(const std::vector<double>& dercs, const double rhs);
         /// Add the equations for one track and do the local fit.
         bool putTrack(Track* track, const size_t nPlanes);
+        /// Add the equations for the measurements of one track with the given reference position and do the local fit.
+        bool putTrack(const std::vector<Measurement>& measurements, double tx, double ty, const size_t nPlanes);
+        /// Add the equations for all stored track records.
+        void putRecords(const size_t nPlanes, unsigned int& nSkipped, unsigned int& nOutliers);
         /// Store the parameters for one measurement.
         void addEquation(std::vector<Equation>& equations,
                          const std::vector<double>& derlc,
@@ -80,11 +107,15 @@ namespace corryvreckan {
                          const double rmeas,
                          const double sigma);
 
-        // Perform local parameters fit using the equations for one track.
+        // Perform local parameters fit using the equations for one track and add it to the global normal equations.
         bool fitTrack(const std::vector<Equation>& equations,
                       std::vector<double>& trackParams,
                       const bool singlefit,
-                      const unsigned int iteration);
+                      const unsigned int iteration,
+                      GlobalSums& sums) const;
+        /// Refit all tracks with the current global parameters, distributing batches of tracks to the worker threads.
+        unsigned int
+        refitTracks(std::vector<std::vector<double>>& localParams, const unsigned int iteration, double& chi2, double& ndof);
 
         // Perform global parameters fit.
         bool fitGlobal();
@@ -92,24 +123,17 @@ namespace corryvreckan {
         bool printResults();
 
         /// Matrix inversion and solution for global fit.
-        int invertMatrix(std::vector<std::vector<double>>& v, std::vector<double>& b, const size_t n);
+        int invertMatrix(Eigen::MatrixXd& v, Eigen::VectorXd& b, const size_t n);
+        /// Solution for global fit using a Cholesky decomposition.
+        int solveLDLT(Eigen::MatrixXd& v, Eigen::VectorXd& b, const size_t n);
         // Matrix inversion and solution for local fit.
-        int invertMatrixLocal(std::vector<std::vector<double>>& v, std::vector<double>& b, const size_t n);
+        int invertMatrixLocal(std::vector<std::vector<double>>& v, std::vector<double>& b, const size_t n) const;
+
+        /// Write the equations of all tracks to a Millepede-II binary file together with a steering file for pede.
+        void writeBinary(const std::string& binaryFile, const std::string& steeringFile) const;
 
         /// Return the limit in chi2 / ndof for n sigmas.
         double chi2Limit(const int n, const int nd) const;
-        /// Multiply matrix and vector
-        bool multiplyAX(const std::vector<std::vector<double>>& a,
-                        const std::vector<double>& x,
-                        std::vector<double>& y,
-                        const unsigned int n,
-                        const unsigned int m);
-        /// Multiply matrices
-        bool multiplyAVAt(const std::vector<std::vector<double>>& v,
-                          const std::vector<std::vector<double>>& a,
-                          std::vector<std::vector<double>>& w,
-                          const unsigned int n,
-                          const unsigned int m);
 
         /// Number of global derivatives
         unsigned int m_nagb;
@@ -131,12 +155,9 @@ namespace corryvreckan {
         /// Sigmas for each global parameter.
         std::vector<double> m_psigm;
 
-        std::vector<std::vector<double>> m_cgmat;
-        std::vector<std::vector<double>> m_corrm;
-        std::vector<std::vector<double>> m_clcmat;
+        /// Global matrix and vector, including the constraint equations.
+        GlobalSums m_global;
 
-        std::vector<double> m_bgvec;
-        std::vector<double> m_corrv;
         std::vector<double> m_diag;
 
         /// Difference in misalignment parameters with respect to initial values.
@@ -169,6 +190,19 @@ namespace corryvreckan {
         bool m_fix_all;
         /// It can be also reasonable to include the DUT in the alignment
         bool m_excludeDUT;
+
+        /// Storage of the collected tracks
+        AlignmentStorage m_storage;
+        /// Compact track records, if not storing full tracks
+        std::unique_ptr<AlignmentRecords> m_records;
+
+        /// Solver for the global fit
+        SolverMethod m_solver;
+        /// Number of worker threads for the track refits
+        unsigned int m_workers;
+        std::unique_ptr<ThreadPool> m_threadPool;
+        /// Output file for the track equations in Millepede-II binary format
+        std::string m_binaryFile;
     };
 } // namespace corryvreckan
 
@@ -11,13 +11,63 @@
 
 #include "AlignmentTime.h"
 
+#include <TMath.h>
+#include <algorithm>
+#include <complex>
+#include <future>
+#include <thread>
+
 using namespace corryvreckan;
 
+namespace {
+    // In-place iterative radix-2 FFT, the size of the data has to be a power of two
+    void fft(std::vector<std::complex<double>>& data, bool inverse) {
+        const size_t n = data.size();
+        for(size_t i = 1, j = 0; i < n; i++) {
+            size_t bit = n >> 1;
+            for(; j & bit; bit >>= 1) {
+                j ^= bit;
+            }
+            j ^= bit;
+            if(i < j) {
+                std::swap(data[i], data[j]);
+            }
+        }
+        for(size_t length = 2; length <= n; length <<= 1) {
+            const double angle = 2 * TMath::Pi() / static_cast<double>(length) * (inverse ? 1 : -1);
+            const std::complex<double> root(std::cos(angle), std::sin(angle));
+            for(size_t i = 0; i < n; i += length) {
+                std::complex<double> w(1.);
+                for(size_t j = 0; j < length / 2; j++) {
+                    auto u = data[i + j];
+                    auto v = data[i + j + length / 2] * w;
+                    data[i + j] = u + v;
+                    data[i + j + length / 2] = u - v;
+                    w *= root;
+                }
+            }
+        }
+        if(inverse) {
+            for(auto& value : data) {
+                value /= static_cast<double>(n);
+            }
+        }
+    }
+} // namespace
+
 AlignmentTime::AlignmentTime(Configuration& config, std::shared_ptr<Detector> detector)
     : Module(config, std::move(detector)) {
 
     // Check if the user wants to directly apply the determined correction
     update_time_offset = config_.get<bool>("update_time_offset", false);
+
+    // Scan method, the cross-correlation bin width defaults to the scan step
+    scan_method_ = config_.get<ScanMethod>("scan_method", ScanMethod::EXACT);
+    fft_bin_width_ = config_.get<double>("fft_bin_width", 0);
+    fft_max_bins_ = config_.get<size_t>("fft_max_bins", 1 << 20);
+    if(fft_max_bins_ < 2) {
+        throw InvalidValueError(config_, "fft_max_bins", "needs to be at least two");
+    }
 }
 
 void AlignmentTime::initialize() {
@@ -113,6 +163,15 @@ void AlignmentTime::finalize(const std::shared_ptr<ReadonlyClipboard>&) {
         hTimeStampsRef_long->Fill(static_cast<double>(Units::convert(ts, "s")));
     }
 
+    // Reference time stamps are searched with a binary search
+    if(scan_method_ == ScanMethod::FFT) {
+        auto& reference_ts = timestamps_[time_reference_name_];
+        std::sort(reference_ts.begin(), reference_ts.end());
+    }
+
+    // Cross-correlation scans of all detectors running concurrently
+    std::map<std::string, std::future<CorrelationScan>> scans;
+
     // Loop over all other detectors
     for(auto& detector : get_detectors()) {
         // Get the detector name
@@ -132,11 +191,35 @@ void AlignmentTime::finalize(const std::shared_ptr<ReadonlyClipboard>&) {
 
         // calculate final scan parameters and perform scan
         calculate_parameters(detectorName);
+        if(scan_method_ == ScanMethod::FFT) {
+            std::sort(timestamps_[detectorName].begin(), timestamps_[detectorName].end());
+            scans[detectorName] = std::async(std::launch::async,
+                                             &AlignmentTime::correlate_delay,
+                                             this,
+                                             std::cref(timestamps_.at(detectorName)),
+                                             std::cref(timestamps_.at(time_reference_name_)),
+                                             shift_start_,
+                                             shift_end_,
+                                             shift_step_,
+                                             shift_n_,
+                                             shift_guessed_,
+                                             time_scale_,
+                                             time_nbins_);
+            continue;
+        }
         scan_delay(detectorName);
         if(update_time_offset) {
             find_delay(detectorName);
         }
     }
+
+    // Collect the results of the cross-correlation scans
+    for(auto& scan : scans) {
+        fill_correlation(scan.first, scan.second.get());
+        if(update_time_offset && hResidualVsShift.count(scan.first) > 0) {
+            find_delay(scan.first);
+        }
+    }
 }
 
 // Calculating parameters from user input, or guess.
@@ -154,7 +237,8 @@ void AlignmentTime::calculate_parameters(std::string detectorName) {
               << "\tin shift_n = " << shift_n_ << " steps.";
 
     // Check if parameters are configured reasonably, otherwise calculate.
-    if(shift_start_ > shift_end_ || shift_n_ == 0) {
+    shift_guessed_ = (shift_start_ > shift_end_ || shift_n_ == 0);
+    if(shift_guessed_) {
         LOG(INFO) << "Attempting to guess reasonable scan parameters.";
 
         // Steps need to be smaller than the trigger period.
@@ -249,6 +333,180 @@ void AlignmentTime::scan_delay(std::string detectorName) {
     return;
 }
 
+// Scan delay by cross-correlation. Both time stamp streams are binned, and their cross-correlation is calculated via FFT.
+// The time stamps need to be sorted. The peak of the cross-correlation provides a coarse estimate of the shift, which is
+// refined by scanning the exact residuals around it in shift_n steps, zooming in until the scan step is reached.
+AlignmentTime::CorrelationScan AlignmentTime::correlate_delay(const std::vector<double>& detector_ts,
+                                                              const std::vector<double>& reference_ts,
+                                                              double shift_start,
+                                                              double shift_end,
+                                                              double shift_step,
+                                                              int shift_n,
+                                                              bool shift_guessed,
+                                                              double time_scale,
+                                                              int time_nbins) const {
+    CorrelationScan scan;
+    scan.shift_n = shift_n;
+    scan.time_scale = time_scale;
+    scan.time_nbins = time_nbins;
+
+    // Common time range of both streams, limiting the number of bins
+    const double t_min = std::min(detector_ts.front(), reference_ts.front());
+    const double t_max = std::max(detector_ts.back(), reference_ts.back());
+    const double span = t_max - t_min;
+    scan.bin_width = std::max(fft_bin_width_ > 0 ? fft_bin_width_ : shift_step, span / static_cast<double>(fft_max_bins_));
+    if(!(scan.bin_width > 0)) {
+        LOG(ERROR) << "Cannot bin time stamps for cross-correlation, time range is empty";
+        return scan;
+    }
+    const auto nbins = static_cast<size_t>(span / scan.bin_width) + 1;
+
+    // Binned time stamps without their mean, such that the overlap of both ranges does not bias the correlation
+    size_t size = 1;
+    while(size < 2 * nbins) {
+        size <<= 1;
+    }
+    auto binned = [&](const std::vector<double>& timestamps) {
+        std::vector<std::complex<double>> data(size);
+        for(auto ts : timestamps) {
+            data[static_cast<size_t>((ts - t_min) / scan.bin_width)] += 1.;
+        }
+        const double mean = static_cast<double>(timestamps.size()) / static_cast<double>(nbins);
+        for(size_t i = 0; i < nbins; i++) {
+            data[i] -= mean;
+        }
+        fft(data, false);
+        return data;
+    };
+    auto detector_fft = binned(detector_ts);
+    auto reference_fft = binned(reference_ts);
+
+    // Correlation c(k) = sum_i d(i) r(i + k), a detector time stamp shifted by k bins matches the reference
+    for(size_t i = 0; i < size; i++) {
+        detector_fft[i] = std::conj(detector_fft[i]) * reference_fft[i];
+    }
+    fft(detector_fft, true);
+
+    // Lags within the configured scan range, or all lags if the range has been guessed
+    auto max_lag = static_cast<long>(nbins) - 1;
+    long lag_min = -max_lag;
+    long lag_max = max_lag;
+    if(!shift_guessed) {
+        lag_min = std::max(lag_min, static_cast<long>(std::floor(shift_start / scan.bin_width)));
+        lag_max = std::min(lag_max, static_cast<long>(std::ceil(shift_end / scan.bin_width)));
+    }
+    scan.lag_start = static_cast<double>(lag_min) * scan.bin_width;
+    long best_lag = lag_min;
+    for(auto lag = lag_min; lag <= lag_max; lag++) {
+        auto index = static_cast<size_t>(lag < 0 ? static_cast<long>(size) + lag : lag);
+        scan.correlation.push_back(detector_fft[index].real());
+        if(scan.correlation.back() > scan.correlation[static_cast<size_t>(best_lag - lag_min)]) {
+            best_lag = lag;
+        }
+    }
+    LOG(INFO) << "Cross-correlation peaks at shift "
+              << Units::display(static_cast<double>(best_lag) * scan.bin_width, {"s", "ms", "us"});
+
+    // Refine with the exact residuals, distributing the shifts to the available threads
+    const auto n = static_cast<size_t>(shift_n);
+    const auto ny = static_cast<size_t>(time_nbins);
+    const auto threads = std::max(std::thread::hardware_concurrency(), 1u);
+    double centre = static_cast<double>(best_lag) * scan.bin_width;
+    double half_width = scan.bin_width;
+    for(int level = 0; level < 10; level++) {
+        scan.shift_step = 2 * half_width / static_cast<double>(n);
+        scan.shift_start = centre - half_width;
+        scan.counts.assign(n * (ny + 2), 0.);
+
+        auto residuals = [&](size_t first, size_t last) {
+            for(size_t i = first; i < last; i++) {
+                const double shift = scan.shift_start + static_cast<double>(i) * scan.shift_step;
+                for(auto ts : detector_ts) {
+                    const double shifted = ts + shift;
+                    const double residual = shifted - find_closest(reference_ts, shifted);
+                    const double position = (residual + time_scale) / (2 * time_scale) * static_cast<double>(ny);
+                    size_t bin = 0;
+                    if(position >= static_cast<double>(ny)) {
+                        bin = ny + 1;
+                    } else if(position >= 0) {
+                        bin = static_cast<size_t>(position) + 1;
+                    }
+                    scan.counts[i * (ny + 2) + bin] += 1.;
+                }
+            }
+        };
+        std::vector<std::future<void>> workers;
+        const size_t range = n / threads + 1;
+        for(size_t first = 0; first < n; first += range) {
+            workers.push_back(std::async(std::launch::async, residuals, first, std::min(first + range, n)));
+        }
+        for(auto& worker : workers) {
+            worker.get();
+        }
+
+        LOG(DEBUG) << "Refined delay scan with step " << Units::display(scan.shift_step, {"s", "ms", "us", "ns"});
+        if(scan.shift_step <= shift_step) {
+            break;
+        }
+
+        // Zoom in on the shift with the most entries in a single residual bin
+        size_t best = 0;
+        double maximum = -1.;
+        for(size_t i = 0; i < n; i++) {
+            for(size_t bin = 1; bin <= ny; bin++) {
+                if(scan.counts[i * (ny + 2) + bin] > maximum) {
+                    maximum = scan.counts[i * (ny + 2) + bin];
+                    best = i;
+                }
+            }
+        }
+        centre = scan.shift_start + static_cast<double>(best) * scan.shift_step;
+        half_width = 2 * scan.shift_step;
+    }
+
+    return scan;
+}
+
+// Fill the histograms of a cross-correlation scan
+void AlignmentTime::fill_correlation(const std::string& detectorName, const CorrelationScan& scan) {
+
+    if(scan.correlation.empty()) {
+        return;
+    }
+
+    std::string title = detectorName + ";time shift [ms]; cross-correlation";
+    const auto nlags = static_cast<int>(scan.correlation.size());
+    hCrossCorrelation[detectorName] =
+        new TH1D("hCrossCorrelation",
+                 title.c_str(),
+                 nlags,
+                 static_cast<double>(Units::convert(scan.lag_start - scan.bin_width / 2, "ms")),
+                 static_cast<double>(Units::convert(scan.lag_start + (nlags - 0.5) * scan.bin_width, "ms")));
+    for(int i = 0; i < nlags; i++) {
+        hCrossCorrelation[detectorName]->SetBinContent(i + 1, scan.correlation[static_cast<size_t>(i)]);
+    }
+
+    // Residuals of the final refinement step, binned such that every bin corresponds to one scanned shift
+    title = detectorName + ";time shift [ms]; #Deltat [ms]; # entries";
+    hResidualVsShift[detectorName] =
+        new TH2D("hResidualVsShift",
+                 title.c_str(),
+                 scan.shift_n,
+                 static_cast<double>(Units::convert(scan.shift_start - scan.shift_step / 2, "ms")),
+                 static_cast<double>(Units::convert(scan.shift_start + (scan.shift_n - 0.5) * scan.shift_step, "ms")),
+                 scan.time_nbins,
+                 -scan.time_scale / 1e6,
+                 scan.time_scale / 1e6);
+    const auto ny = static_cast<size_t>(scan.time_nbins);
+    for(size_t i = 0; i < static_cast<size_t>(scan.shift_n); i++) {
+        for(size_t bin = 0; bin < ny + 2; bin++) {
+            hResidualVsShift[detectorName]->SetBinContent(
+                static_cast<int>(i + 1), static_cast<int>(bin), scan.counts[i * (ny + 2) + bin]);
+        }
+    }
+    hResidualVsShift[detectorName]->ResetStats();
+}
+
 // Find delay
 void AlignmentTime::find_delay(std::string detectorName) {
 
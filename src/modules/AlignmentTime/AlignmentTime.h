@@ -50,6 +50,31 @@ namespace corryvreckan {
         void finalize(const std::shared_ptr<ReadonlyClipboard>& clipboard) override;
 
     private:
+        /**
+         * @brief Method used to scan the delay between detector and reference time stamps
+         */
+        enum class ScanMethod {
+            EXACT, ///< Calculate the residuals to the closest reference time stamp for every shift
+            FFT,   ///< Cross-correlate the binned time stamps via FFT, refine around the peak with the exact residuals
+        };
+
+        /**
+         * @brief Result of a cross-correlation delay scan of one detector
+         */
+        struct CorrelationScan {
+            // Cross-correlation as a function of the shift, starting at lag_start in steps of bin_width
+            double bin_width{};
+            double lag_start{};
+            std::vector<double> correlation;
+            // Residual counts of the final refinement step, time_nbins + 2 residual bins per shift
+            double shift_start{};
+            double shift_step{};
+            int shift_n{};
+            double time_scale{};
+            int time_nbins{};
+            std::vector<double> counts;
+        };
+
         // Handling time reference
         std::string time_reference_name_;
 
@@ -67,6 +92,13 @@ namespace corryvreckan {
         // Vertical axis
         double time_scale_;
         int time_nbins_;
+        // Scan range has been guessed rather than configured
+        bool shift_guessed_{};
+
+        // Scan method and binning of the cross-correlation
+        ScanMethod scan_method_;
+        double fft_bin_width_;
+        size_t fft_max_bins_;
 
         // Calculating parameters from user input, or guess.
         void calculate_parameters(std::string detectorName);
@@ -74,11 +106,25 @@ namespace corryvreckan {
         // Scan delay
         void scan_delay(std::string detectorName);
 
+        // Scan delay by cross-correlation of the binned time stamps, thread-safe
+        CorrelationScan correlate_delay(const std::vector<double>& detector_ts,
+                                        const std::vector<double>& reference_ts,
+                                        double shift_start,
+                                        double shift_end,
+                                        double shift_step,
+                                        int shift_n,
+                                        bool shift_guessed,
+                                        double time_scale,
+                                        int time_nbins) const;
+
+        // Fill the histograms from the result of a cross-correlation scan
+        void fill_correlation(const std::string& detectorName, const CorrelationScan& scan);
+
         // Find delay and correct geometry file
         void find_delay(std::string detectorName);
 
         // Returns the array element closest to the target value.
-        double find_closest(std::vector<double> const&, double);
+        static double find_closest(std::vector<double> const&, double);
 
         // Histograms
         std::map<std::string, TH1D*> hTimeStamps;
@@ -86,6 +132,7 @@ namespace corryvreckan {
         TH1D* hTimeStampsRef;
         TH1D* hTimeStampsRef_long;
         std::map<std::string, TH2D*> hResidualVsShift;
+        std::map<std::string, TH1D*> hCrossCorrelation;
     };
 
 } // namespace corryvreckan
@@ -11,9 +11,15 @@
 
 #include "AlignmentTrackChi2.h"
 
+#include <TDecompChol.h>
+#include <TMatrixDSym.h>
+#include <TVectorD.h>
 #include <TVirtualFitter.h>
+#include <array>
 #include <numeric>
 
+#include "objects/StraightLineTrack.hpp"
+
 using namespace corryvreckan;
 using namespace std;
 
@@ -22,6 +28,8 @@ TrackVector AlignmentTrackChi2::globalTracks;
 std::shared_ptr<Detector> AlignmentTrackChi2::globalDetector;
 int AlignmentTrackChi2::detNum;
 ThreadPool* AlignmentTrackChi2::thread_pool;
+AlignmentRecords* AlignmentTrackChi2::globalRecords;
+std::vector<std::shared_ptr<Detector>> AlignmentTrackChi2::globalPlanes;
 
 AlignmentTrackChi2::AlignmentTrackChi2(Configuration& config, std::vector<std::shared_ptr<Detector>> detectors)
     : Module(config, std::move(detectors)) {
@@ -32,11 +40,27 @@ AlignmentTrackChi2::AlignmentTrackChi2(Configuration& config, std::vector<std::s
     config_.setDefault<size_t>("max_associated_clusters", 1);
     config_.setDefault<double>("max_track_chi2ndof", 10.);
     config_.setDefault<unsigned int>("workers", std::max(std::thread::hardware_concurrency() - 1, 1u));
+    config_.setDefault<SolverMethod>("solver", SolverMethod::MINUIT);
+    config_.setDefault<AlignmentStorage>("storage", AlignmentStorage::TRACKS);
+    config_.setDefault<size_t>("max_solver_steps", 5);
+    config_.setDefault<double>("tolerance_position", Units::get<double>(0.1, "um"));
+    config_.setDefault<double>("tolerance_orientation", Units::get<double>(0.01, "mrad"));
 
     m_workers = config.get<unsigned int>("workers");
     nIterations = config_.get<size_t>("iterations");
     m_pruneTracks = config_.get<bool>("prune_tracks");
 
+    m_solver = config_.get<SolverMethod>("solver");
+    m_maxSolverSteps = config_.get<size_t>("max_solver_steps");
+    m_tolerancePosition = config_.get<double>("tolerance_position");
+    m_toleranceOrientation = config_.get<double>("tolerance_orientation");
+    LOG(INFO) << "Using alignment solver " << corryvreckan::to_string(m_solver);
+
+    m_storage = config_.get<AlignmentStorage>("storage");
+    if(m_storage != AlignmentStorage::TRACKS) {
+        m_records = std::make_unique<AlignmentRecords>(m_storage);
+    }
+
     m_alignPosition = config_.get<bool>("align_position");
     if(m_alignPosition) {
         LOG(INFO) << "Aligning positions";
@@ -79,6 +103,22 @@ StatusCode AlignmentTrackChi2::run(const std::shared_ptr<Clipboard>& clipboard)
             continue;
         }
 
+        if(m_records != nullptr) {
+            if(dynamic_cast<StraightLineTrack*>(track.get()) == nullptr && !m_warnedTrackModel) {
+                LOG(WARNING) << "Alignment records are refitted as straight lines, ignoring the track model \""
+                             << track->getType() << "\"";
+                m_warnedTrackModel = true;
+            }
+
+            // Only keep the compact cluster measurements of this track
+            std::vector<AlignmentRecords::Measurement> record;
+            for(auto& cluster : track->getClusters()) {
+                record.push_back(m_records->measurement(cluster));
+            }
+            m_records->add(record);
+            continue;
+        }
+
         LOG(TRACE) << "Storing track with track model \"" << track->getType() << "\" for alignment";
         alignmenttracks.push_back(track);
         for(auto& cluster : track->getClusters()) {
@@ -86,6 +126,10 @@ StatusCode AlignmentTrackChi2::run(const std::shared_ptr<Clipboard>& clipboard)
         }
     }
 
+    if(m_records != nullptr) {
+        return StatusCode::Success;
+    }
+
     // Store all tracks we want for alignment on the permanent storage:
     clipboard->putPersistentData(alignmenttracks);
     // Copy the objects of all track clusters on the clipboard to persistent storage:
@@ -115,41 +159,51 @@ void AlignmentTrackChi2::MinimiseTrackChi2(Int_t&, Double_t*, Double_t& result,
     // Apply new alignment conditions
     AlignmentTrackChi2::globalDetector->update(XYZPoint(par[detNum * 6 + 0], par[detNum * 6 + 1], par[detNum * 6 + 2]),
                                                XYZVector(par[detNum * 6 + 3], par[detNum * 6 + 4], par[detNum * 6 + 5]));
+    if(detName != AlignmentTrackChi2::globalDetector->getName()) {
+        detName = AlignmentTrackChi2::globalDetector->getName();
+        fitIterations = 0;
+    }
 
     // The chi2 value to be returned
-    result = 0.;
+    result = refitTracks(AlignmentTrackChi2::globalDetector);
+
+    auto tracks = (AlignmentTrackChi2::globalRecords != nullptr ? AlignmentTrackChi2::globalRecords->size()
+                                                                 : AlignmentTrackChi2::globalTracks.size());
+    LOG_PROGRESS(INFO, "t") << "Refit of " << tracks << " track, MINUIT iteration " << fitIterations;
+    fitIterations++;
+}
+
+// Move the clusters of the given detector according to its current alignment, refit all tracks and return the total chi2
+double AlignmentTrackChi2::refitTracks(const std::shared_ptr<Detector>& detector) {
+    // Records only store local positions, the current geometry is picked up by the refit itself
+    if(AlignmentTrackChi2::globalRecords != nullptr) {
+        return refitRecords();
+    }
 
     std::vector<std::shared_future<double>> result_futures;
-    auto track_refit = [&](auto& track) {
+    auto track_refit = [&detector](auto& track) {
         // Get all clusters on the track
         auto trackClusters = track->getClusters();
         // Find the cluster that needs to have its position recalculated
         for(size_t iTrackCluster = 0; iTrackCluster < trackClusters.size(); iTrackCluster++) {
             Cluster* trackCluster = trackClusters[iTrackCluster];
-            if(AlignmentTrackChi2::globalDetector->getName() != trackCluster->detectorID()) {
+            if(detector->getName() != trackCluster->detectorID()) {
                 continue;
             }
 
             // Recalculate the global position from the local
             auto positionLocal = trackCluster->local();
-            auto positionGlobal = AlignmentTrackChi2::globalDetector->localToGlobal(positionLocal);
+            auto positionGlobal = detector->localToGlobal(positionLocal);
             trackCluster->setClusterCentre(positionGlobal);
-            trackCluster->setErrorMatrixGlobal(AlignmentTrackChi2::globalDetector->getSpatialResolutionMatrixGlobal(
-                trackCluster->column(), trackCluster->row()));
-            LOG(DEBUG) << "Updating cluster with corrected global position for detector "
-                       << AlignmentTrackChi2::globalDetector->getName();
+            trackCluster->setErrorMatrixGlobal(
+                detector->getSpatialResolutionMatrixGlobal(trackCluster->column(), trackCluster->row()));
+            LOG(DEBUG) << "Updating cluster with corrected global position for detector " << detector->getName();
         }
 
         // Update plane and refit the track
-        track->updatePlane(AlignmentTrackChi2::globalDetector->getName(),
-                           AlignmentTrackChi2::globalDetector->displacement().z(),
-                           AlignmentTrackChi2::globalDetector->materialBudget(),
-                           AlignmentTrackChi2::globalDetector->toLocal());
-        LOG(DEBUG) << "Updated transformations for detector " << AlignmentTrackChi2::globalDetector->getName();
-        if(detName != AlignmentTrackChi2::globalDetector->getName()) {
-            detName = AlignmentTrackChi2::globalDetector->getName();
-            fitIterations = 0;
-        }
+        track->updatePlane(
+            detector->getName(), detector->displacement().z(), detector->materialBudget(), detector->toLocal());
+        LOG(DEBUG) << "Updated transformations for detector " << detector->getName();
 
         // check if the fit has failed
         if(!track->isFitted()) {
@@ -166,13 +220,242 @@ void AlignmentTrackChi2::MinimiseTrackChi2(Int_t&, Double_t*, Double_t& result,
         result_futures.push_back(AlignmentTrackChi2::thread_pool->submit(track_refit, track));
     }
 
+    double result = 0.;
     for(auto& result_future : result_futures) {
         result += result_future.get();
     }
 
-    LOG_PROGRESS(INFO, "t") << "Refit of " << result_futures.size() << " track, MINUIT iteration " << fitIterations;
-    fitIterations++;
     AlignmentTrackChi2::thread_pool->wait();
+    return result;
+}
+
+// Refit all track records as straight lines with the current geometry and return the total chi2
+double AlignmentTrackChi2::refitRecords(std::vector<AlignmentRecords::Line>* lines) {
+
+    double result = 0.;
+    if(lines != nullptr) {
+        lines->clear();
+    }
+
+    AlignmentTrackChi2::globalRecords->forEachBlock([&](const auto& data, const auto& offsets, const auto&) {
+        const size_t tracks = offsets.size() - 1;
+        const size_t first_line = (lines != nullptr ? lines->size() : 0);
+        if(lines != nullptr) {
+            lines->resize(first_line + tracks);
+        }
+
+        // Split the block into one range of tracks per worker
+        const size_t range = tracks / std::max(ThreadPool::threadCount(), 1u) + 1;
+        std::vector<std::shared_future<double>> result_futures;
+        for(size_t begin = 0; begin < tracks; begin += range) {
+            const size_t end = std::min(begin + range, tracks);
+            result_futures.push_back(AlignmentTrackChi2::thread_pool->submit([&, begin, end]() {
+                double chi2 = 0.;
+                for(size_t i = begin; i < end; i++) {
+                    auto line = AlignmentRecords::fit(
+                        &data[offsets[i]], offsets[i + 1] - offsets[i], AlignmentTrackChi2::globalPlanes);
+                    if(line.fitted) {
+                        chi2 += line.chi2;
+                    }
+                    if(lines != nullptr) {
+                        (*lines)[first_line + i] = line;
+                    }
+                }
+                return chi2;
+            }));
+        }
+
+        for(auto& result_future : result_futures) {
+            result += result_future.get();
+        }
+    });
+
+    AlignmentTrackChi2::thread_pool->wait();
+    return result;
+}
+
+// ========================================
+//  Linearized solver
+// ========================================
+
+// Collect the track states and cluster positions of all measurements on a plane
+std::vector<AlignmentTrackChi2::PlaneMeasurement>
+AlignmentTrackChi2::collectMeasurements(const std::shared_ptr<Detector>& detector) const {
+    std::vector<PlaneMeasurement> measurements;
+
+    if(AlignmentTrackChi2::globalRecords == nullptr) {
+        for(auto& track : AlignmentTrackChi2::globalTracks) {
+            if(!track->isFitted()) {
+                continue;
+            }
+            for(auto* cluster : track->getClusters()) {
+                if(cluster->detectorID() == detector->getName()) {
+                    measurements.push_back({track->getState(detector->getName()),
+                                            track->getDirection(detector->getName()),
+                                            cluster->local().x(),
+                                            cluster->local().y(),
+                                            cluster->column(),
+                                            cluster->row()});
+                }
+            }
+        }
+        return measurements;
+    }
+
+    // Fit all records with the current geometry and pick the measurements on this plane
+    std::vector<AlignmentRecords::Line> lines;
+    refitRecords(&lines);
+    const auto& planes = AlignmentTrackChi2::globalRecords->planes();
+    const auto plane = static_cast<uint32_t>(
+        std::distance(planes.begin(), std::find(planes.begin(), planes.end(), detector->getName())));
+    size_t track = 0;
+    AlignmentTrackChi2::globalRecords->forEachBlock([&](const auto& data, const auto& offsets, const auto&) {
+        for(size_t i = 0; i + 1 < offsets.size(); i++, track++) {
+            if(!lines[track].fitted) {
+                continue;
+            }
+            for(auto j = offsets[i]; j < offsets[i + 1]; j++) {
+                if(data[j].plane == plane) {
+                    measurements.push_back({lines[track].state,
+                                            lines[track].direction,
+                                            data[j].x,
+                                            data[j].y,
+                                            data[j].column,
+                                            data[j].row});
+                }
+            }
+        }
+    });
+    return measurements;
+}
+
+// Determine the alignment correction of one plane from the linearized residuals of all tracks with a cluster on it. The
+// local residuals r = m - p(a) between the cluster positions m and the track intercepts p are expanded around the current
+// alignment parameters a, the tracks are kept fixed. The correction follows from the normal equations
+// (J^T W J) da = J^T W r with the Jacobian J = dp/da and the weights W given by the spatial resolution of the plane. Since
+// the tracks are not refitted, only a few steps are required until the plane converges. Returns false if no solution
+// could be found.
+bool AlignmentTrackChi2::solveLinearized(const std::shared_ptr<Detector>& detector) {
+
+    // Alignment parameters solved for, the z displacement is never aligned
+    std::vector<size_t> active;
+    if(m_alignPosition) {
+        active.insert(active.end(), {0, 1});
+    }
+    if(m_alignOrientation) {
+        active.insert(active.end(), {3, 4, 5});
+    }
+    if(active.empty()) {
+        return true;
+    }
+
+    // Collect measurements of this plane
+    auto measurements = collectMeasurements(detector);
+    if(measurements.size() < active.size()) {
+        LOG(WARNING) << "Not enough clusters on tracks to align detector " << detector->getName();
+        return false;
+    }
+
+    auto parameters = [](const std::shared_ptr<Detector>& det) {
+        auto displacement = det->displacement();
+        auto rotation = det->rotation();
+        return std::vector<double>{
+            displacement.X(), displacement.Y(), displacement.Z(), rotation.X(), rotation.Y(), rotation.Z()};
+    };
+    auto apply = [&detector](const std::vector<double>& par) {
+        detector->update(XYZPoint(par[0], par[1], par[2]), XYZVector(par[3], par[4], par[5]));
+    };
+    auto intercepts = [&measurements, &detector]() {
+        std::vector<XYZPoint> points;
+        points.reserve(measurements.size());
+        for(auto& measurement : measurements) {
+            // Intersect the track with the plane as it is moved, keeping the track itself fixed
+            auto normal = detector->normal();
+            double path =
+                (detector->origin() - measurement.state).Dot(normal) / measurement.direction.Dot(normal);
+            points.emplace_back(detector->globalToLocal(measurement.state + path * measurement.direction));
+        }
+        return points;
+    };
+
+    // Step sizes for the numerical derivatives of the plane geometry
+    const std::vector<double> epsilon{Units::get<double>(1, "um"),
+                                      Units::get<double>(1, "um"),
+                                      Units::get<double>(1, "um"),
+                                      Units::get<double>(1, "urad"),
+                                      Units::get<double>(1, "urad"),
+                                      Units::get<double>(1, "urad")};
+
+    const auto n = static_cast<int>(active.size());
+    for(size_t step = 0; step < m_maxSolverSteps; step++) {
+        auto par = parameters(detector);
+        auto nominal = intercepts();
+
+        // Derivatives of the local track intercepts with respect to all active alignment parameters
+        std::vector<std::vector<XYZPoint>> varied;
+        for(auto index : active) {
+            auto shifted = par;
+            shifted[index] += epsilon[index];
+            apply(shifted);
+            varied.push_back(intercepts());
+        }
+        apply(par);
+
+        TMatrixDSym matrix(n);
+        TVectorD vector(n);
+        for(size_t i = 0; i < measurements.size(); i++) {
+            const auto& measurement = measurements[i];
+            auto resolution = detector->getSpatialResolution(measurement.column, measurement.row);
+            const double residual[2] = {measurement.x - nominal[i].x(), measurement.y - nominal[i].y()};
+            const double weight[2] = {1. / (resolution.x() * resolution.x()), 1. / (resolution.y() * resolution.y())};
+
+            std::vector<std::array<double, 2>> jacobian(active.size());
+            for(size_t k = 0; k < active.size(); k++) {
+                jacobian[k] = {(varied[k][i].x() - nominal[i].x()) / epsilon[active[k]],
+                               (varied[k][i].y() - nominal[i].y()) / epsilon[active[k]]};
+            }
+
+            for(int k = 0; k < n; k++) {
+                const auto& jk = jacobian[static_cast<size_t>(k)];
+                vector[k] += jk[0] * weight[0] * residual[0] + jk[1] * weight[1] * residual[1];
+                for(int l = 0; l <= k; l++) {
+                    const auto& jl = jacobian[static_cast<size_t>(l)];
+                    matrix(k, l) += jk[0] * weight[0] * jl[0] + jk[1] * weight[1] * jl[1];
+                }
+            }
+        }
+        for(int k = 0; k < n; k++) {
+            for(int l = 0; l < k; l++) {
+                matrix(l, k) = matrix(k, l);
+            }
+        }
+
+        TDecompChol decomposition(matrix);
+        bool ok = false;
+        auto correction = decomposition.Solve(vector, ok);
+        if(!ok) {
+            LOG(WARNING) << "Normal equations for detector " << detector->getName()
+                         << " are singular, alignment parameters not updated";
+            return false;
+        }
+
+        bool converged = true;
+        for(size_t k = 0; k < active.size(); k++) {
+            par[active[k]] += correction[static_cast<int>(k)];
+            auto tolerance = (active[k] < 3 ? m_tolerancePosition : m_toleranceOrientation);
+            converged &= (std::fabs(correction[static_cast<int>(k)]) < tolerance);
+        }
+        apply(par);
+
+        LOG(DEBUG) << "Linearized solver step " << step << " for detector " << detector->getName() << ": T"
+                   << Units::display(detector->displacement(), {"mm", "um"}) << " R"
+                   << Units::display(detector->rotation(), {"deg"});
+        if(converged) {
+            break;
+        }
+    }
+
+    return true;
 }
 
 // ==================================================================
@@ -190,7 +473,15 @@ void AlignmentTrackChi2::finalize(const std::shared_ptr<ReadonlyClipboard>& clip
     residualFitter->SetFCN(MinimiseTrackChi2);
 
     // Set the global parameters
-    AlignmentTrackChi2::globalTracks = clipboard->getPersistentData<Track>();
+    if(m_records != nullptr) {
+        AlignmentTrackChi2::globalRecords = m_records.get();
+        for(const auto& name : m_records->planes()) {
+            AlignmentTrackChi2::globalPlanes.push_back(get_detector(name));
+        }
+        LOG(INFO) << "Aligning with " << m_records->size() << " track records";
+    } else {
+        AlignmentTrackChi2::globalTracks = clipboard->getPersistentData<Track>();
+    }
 
     // Create thread pool:
     ThreadPool::registerThreadCount(m_workers);
@@ -220,11 +511,36 @@ void AlignmentTrackChi2::finalize(const std::shared_ptr<ReadonlyClipboard>& clip
     std::map<std::string, std::vector<double>> rot1;
     std::map<std::string, std::vector<double>> rot2;
 
+    size_t iterations_done = 0;
+    bool converged = false;
+    auto store_corrections = [&](const std::shared_ptr<Detector>& detector,
+                                 const XYZPoint& old_position,
+                                 const XYZVector& old_orientation,
+                                 size_t iteration) {
+        const auto& detectorID = detector->getName();
+        shiftsX[detectorID].push_back(
+            static_cast<double>(Units::convert(detector->displacement().X() - old_position.X(), "um")));
+        shiftsY[detectorID].push_back(
+            static_cast<double>(Units::convert(detector->displacement().Y() - old_position.Y(), "um")));
+        rot0[detectorID].push_back(
+            static_cast<double>(Units::convert(detector->rotation().X() - old_orientation.X(), "deg")));
+        rot1[detectorID].push_back(
+            static_cast<double>(Units::convert(detector->rotation().Y() - old_orientation.Y(), "deg")));
+        rot2[detectorID].push_back(
+            static_cast<double>(Units::convert(detector->rotation().Z() - old_orientation.Z(), "deg")));
+
+        LOG(INFO) << detector->getName() << "/" << iteration << " dT"
+                  << Units::display(detector->displacement() - old_position, {"mm", "um"}) << " dR"
+                  << Units::display(detector->rotation() - old_orientation, {"deg"});
+    };
+
     // Loop over all planes. For each plane, set the plane alignment parameters which will be varied, and then minimise the
     // track chi2 (sum of biased residuals). This means that tracks are refitted with each minimisation step.
-    for(size_t iteration = 0; iteration < nIterations; iteration++) {
+    for(size_t iteration = 0; iteration < nIterations && !converged; iteration++) {
 
         LOG_PROGRESS(STATUS, "alignment_track") << "Alignment iteration " << (iteration + 1) << " of " << nIterations;
+        iterations_done++;
+        converged = (m_solver == SolverMethod::LINEARIZED);
 
         int det = 0;
         for(auto& detector : get_regular_detectors(false)) {
@@ -237,6 +553,30 @@ void AlignmentTrackChi2::finalize(const std::shared_ptr<ReadonlyClipboard>& clip
                 continue;
             }
 
+            if(m_solver == SolverMethod::LINEARIZED) {
+                auto old_position = detector->displacement();
+                auto old_orientation = detector->rotation();
+
+                // Solve for the plane alignment with fixed tracks, then move its clusters and refit the tracks once
+                // Earlier solver steps might have moved the plane before a failure, so tracks are refitted regardless
+                bool solved = solveLinearized(detector);
+                if(!solved) {
+                    LOG(WARNING) << "Linearized alignment of detector " << detector->getName() << " failed in iteration "
+                                 << iteration << ", alignment cannot converge";
+                }
+                if(AlignmentTrackChi2::globalRecords == nullptr) {
+                    refitTracks(detector);
+                }
+
+                store_corrections(detector, old_position, old_orientation, iteration);
+                auto rotation_change = detector->rotation() - old_orientation;
+                converged &= (solved && (detector->displacement() - old_position).R() < m_tolerancePosition &&
+                              std::fabs(rotation_change.X()) < m_toleranceOrientation &&
+                              std::fabs(rotation_change.Y()) < m_toleranceOrientation &&
+                              std::fabs(rotation_change.Z()) < m_toleranceOrientation);
+                continue;
+            }
+
             // Say that this is the detector we align
             AlignmentTrackChi2::globalDetector = detector;
 
@@ -288,20 +628,7 @@ void AlignmentTrackChi2::finalize(const std::shared_ptr<ReadonlyClipboard>& clip
             auto rotation2 = residualFitter->GetParameter(det * 6 + 5);
 
             // Store corrections:
-            shiftsX[detectorID].push_back(
-                static_cast<double>(Units::convert(detector->displacement().X() - old_position.X(), "um")));
-            shiftsY[detectorID].push_back(
-                static_cast<double>(Units::convert(detector->displacement().Y() - old_position.Y(), "um")));
-            rot0[detectorID].push_back(
-                static_cast<double>(Units::convert(detector->rotation().X() - old_orientation.X(), "deg")));
-            rot1[detectorID].push_back(
-                static_cast<double>(Units::convert(detector->rotation().Y() - old_orientation.Y(), "deg")));
-            rot2[detectorID].push_back(
-                static_cast<double>(Units::convert(detector->rotation().Z() - old_orientation.Z(), "deg")));
-
-            LOG(INFO) << detector->getName() << "/" << iteration << " dT"
-                      << Units::display(detector->displacement() - old_position, {"mm", "um"}) << " dR"
-                      << Units::display(detector->rotation() - old_orientation, {"deg"});
+            store_corrections(detector, old_position, old_orientation, iteration);
 
             // Now that this device is fitted, set parameter errors to 0 so that they
             // are not fitted again
@@ -319,7 +646,10 @@ void AlignmentTrackChi2::finalize(const std::shared_ptr<ReadonlyClipboard>& clip
         }
     }
 
-    LOG_PROGRESS(STATUS, "alignment_track") << "Alignment finished, " << nIterations << " iteration.";
+    LOG_PROGRESS(STATUS, "alignment_track") << "Alignment finished, " << iterations_done << " iteration.";
+    if(converged) {
+        LOG(STATUS) << "Linearized alignment converged after " << iterations_done << " iterations";
+    }
 
     // Now list the new alignment parameters
     for(auto& detector : get_regular_detectors(false)) {
@@ -336,7 +666,7 @@ void AlignmentTrackChi2::finalize(const std::shared_ptr<ReadonlyClipboard>& clip
                     << Units::display(detector->rotation(), {"deg"});
 
         // Fill the alignment convergence graphs:
-        std::vector<double> iterations(nIterations);
+        std::vector<double> iterations(iterations_done);
         std::iota(std::begin(iterations), std::end(iterations), 0);
 
         std::string name = "alignment_correction_displacementX_" + detector->getName();
@@ -378,4 +708,6 @@ void AlignmentTrackChi2::finalize(const std::shared_ptr<ReadonlyClipboard>& clip
     // Clean up local track storage
     AlignmentTrackChi2::globalTracks.clear();
     AlignmentTrackChi2::globalDetector.reset();
+    AlignmentTrackChi2::globalRecords = nullptr;
+    AlignmentTrackChi2::globalPlanes.clear();
 }
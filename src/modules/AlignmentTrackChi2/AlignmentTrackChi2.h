@@ -21,6 +21,7 @@
 #include <TProfile.h>
 
 #include "core/module/Module.hpp"
+#include "core/utils/AlignmentRecords.hpp"
 #include "core/utils/ThreadPool.hpp"
 #include "objects/Cluster.hpp"
 #include "objects/Track.hpp"
@@ -31,6 +32,14 @@ namespace corryvreckan {
      */
     class AlignmentTrackChi2 : public Module {
 
+        /**
+         * @brief Method used to determine the alignment parameters of a plane
+         */
+        enum class SolverMethod {
+            MINUIT,     ///< Minimize the total track chi2 with MIGRAD, refitting all tracks for every function call
+            LINEARIZED, ///< Solve the linearized normal equations of the plane residuals, Gauss-Newton style
+        };
+
     public:
         // Constructors and destructors
         AlignmentTrackChi2(Configuration& config, std::vector<std::shared_ptr<Detector>> detectors);
@@ -42,6 +51,22 @@ namespace corryvreckan {
 
     private:
         static void MinimiseTrackChi2(Int_t& npar, Double_t* grad, Double_t& result, Double_t* par, Int_t flag);
+        static double refitTracks(const std::shared_ptr<Detector>& detector);
+        static double refitRecords(std::vector<AlignmentRecords::Line>* lines = nullptr);
+        bool solveLinearized(const std::shared_ptr<Detector>& detector);
+
+        /**
+         * @brief Track state at a plane used by the linearized solver
+         */
+        struct PlaneMeasurement {
+            ROOT::Math::XYZPoint state;
+            ROOT::Math::XYZVector direction;
+            double x;
+            double y;
+            double column;
+            double row;
+        };
+        std::vector<PlaneMeasurement> collectMeasurements(const std::shared_ptr<Detector>& detector) const;
         // Member variables
         int m_discardedtracks{};
 
@@ -50,9 +75,19 @@ namespace corryvreckan {
         static std::shared_ptr<Detector> globalDetector;
         static int detNum;
         static ThreadPool* thread_pool;
+        static AlignmentRecords* globalRecords;
+        static std::vector<std::shared_ptr<Detector>> globalPlanes;
+
+        AlignmentStorage m_storage;
+        std::unique_ptr<AlignmentRecords> m_records;
+        bool m_warnedTrackModel{};
 
         unsigned int m_workers;
         size_t nIterations;
+        SolverMethod m_solver;
+        size_t m_maxSolverSteps;
+        double m_tolerancePosition;
+        double m_toleranceOrientation;
         bool m_pruneTracks;
         bool m_alignPosition;
         bool m_alignOrientation;
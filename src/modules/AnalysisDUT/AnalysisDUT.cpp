@@ -11,6 +11,9 @@
 
 #include "AnalysisDUT.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "objects/Cluster.hpp"
 #include "objects/Pixel.hpp"
 #include "objects/Track.hpp"
@@ -33,6 +36,7 @@ AnalysisDUT::AnalysisDUT(Configuration& config, std::shared_ptr<Detector> detect
     config_.setDefault<int>("n_raw_bins", 1000);
     config_.setDefault<double>("raw_histo_range", 1000.0);
     config_.setDefault<ROOT::Math::XYPoint>("inpixel_bin_size", {Units::get(0.5, "um"), Units::get(0.5, "um")});
+    config_.setDefault<double>("track_distance_max", std::numeric_limits<double>::max());
 
     time_cut_frameedge_ = config_.get<double>("time_cut_frameedge");
     spatial_cut_sensoredge_ = config_.get<double>("spatial_cut_sensoredge");
@@ -42,6 +46,7 @@ AnalysisDUT::AnalysisDUT(Configuration& config, std::shared_ptr<Detector> detect
     n_timebins_ = config_.get<int>("n_time_bins");
     time_binning_ = config_.get<double>("time_binning");
     correlations_ = config_.get<bool>("correlations");
+    track_distance_max_ = config_.get<double>("track_distance_max");
     n_chargebins_ = config_.get<int>("n_charge_bins");
     charge_histo_range_ = config_.get<double>("charge_histo_range");
     if(config_.getArray<double>("inpixel_bin_size").size() == 2) {
@@ -696,19 +701,51 @@ bool AnalysisDUT::acceptTrackDUT(const std::shared_ptr<Track>& track) {
 
 StatusCode AnalysisDUT::run(const std::shared_ptr<Clipboard>& clipboard) {
 
-    // Get the telescope tracks from the clipboard
+    // Get the telescope tracks and the DUT clusters from the clipboard
     auto tracks = clipboard->getData<Track>();
+    auto clusters = clipboard->getData<Cluster>(m_detector->getName());
 
-    // Loop over all tracks
+    // Intercepts of all tracks with the DUT, computed once per event
+    std::vector<ROOT::Math::XYZPoint> global_intercepts;
+    std::vector<ROOT::Math::XYZPoint> local_intercepts;
+    global_intercepts.reserve(tracks.size());
+    local_intercepts.reserve(tracks.size());
     for(auto& track : tracks) {
+        global_intercepts.push_back(m_detector->getIntercept(track.get()));
+        local_intercepts.push_back(m_detector->globalToLocal(global_intercepts.back()));
+    }
+
+    // In-pixel positions of all tracks, calculated in one batch from the local intercepts
+    std::vector<double> local_x(tracks.size()), local_y(tracks.size());
+    for(size_t i = 0; i < tracks.size(); ++i) {
+        local_x[i] = local_intercepts[i].x();
+        local_y[i] = local_intercepts[i].y();
+    }
+    std::vector<double> inpixel_x(tracks.size()), inpixel_y(tracks.size());
+    m_detector->inPixelBatch(tracks.size(), local_x.data(), local_y.data(), inpixel_x.data(), inpixel_y.data());
+
+    // Tracks entering the track-to-track distance plot, sorted by their local x intercept
+    std::vector<size_t> sorted_tracks;
+    for(size_t i = 0; i < tracks.size(); ++i) {
+        if(!(tracks[i]->getChi2ndof() > chi2_ndof_cut_)) {
+            sorted_tracks.push_back(i);
+        }
+    }
+    std::sort(sorted_tracks.begin(), sorted_tracks.end(), [&](size_t a, size_t b) {
+        return local_intercepts[a].x() < local_intercepts[b].x();
+    });
+    std::vector<size_t> neighbours;
+
+    // Loop over all tracks
+    for(size_t i = 0; i < tracks.size(); ++i) {
+        auto& track = tracks[i];
         hCutHisto->Fill(ETrackSelection::kAllTrack);
 
-        auto globalIntercept = m_detector->getIntercept(track.get());
-        auto localIntercept = m_detector->globalToLocal(globalIntercept);
+        const auto& globalIntercept = global_intercepts[i];
+        const auto& localIntercept = local_intercepts[i];
 
         // Fill correlation plots BEFORE applying any cuts:
         if(correlations_) {
-            auto clusters = clipboard->getData<Cluster>(m_detector->getName());
             for(auto& cls : clusters) {
                 double xdistance_um = (globalIntercept.X() - cls->global().x()) * 1000.;
                 double ydistance_um = (globalIntercept.Y() - cls->global().y()) * 1000.;
@@ -730,14 +767,21 @@ StatusCode AnalysisDUT::run(const std::shared_ptr<Clipboard>& clipboard) {
             continue;
         }
 
-        // Create track-to-track plot
-        for(auto& track2 : tracks) {
-            if((track == track2) || (track2->getChi2ndof() > chi2_ndof_cut_)) {
+        // Create track-to-track plot from all other tracks within the maximum distance in x, in the order of the tracks
+        auto first = std::partition_point(sorted_tracks.begin(), sorted_tracks.end(), [&](size_t j) {
+            return local_intercepts[j].x() < localIntercept.x() - track_distance_max_;
+        });
+        auto last = std::partition_point(first, sorted_tracks.end(), [&](size_t j) {
+            return !(local_intercepts[j].x() > localIntercept.x() + track_distance_max_);
+        });
+        neighbours.assign(first, last);
+        std::sort(neighbours.begin(), neighbours.end());
+        for(const auto j : neighbours) {
+            if(j == i) {
                 continue;
             }
-            auto inter1 = m_detector->globalToLocal(m_detector->getIntercept(track.get()));
-            auto inter2 = m_detector->globalToLocal(m_detector->getIntercept(track2.get()));
-            track_trackDistance->Fill(1000. * (inter1.x() - inter2.x()), 1000. * (inter1.y() - inter2.y()));
+            const auto& inter2 = local_intercepts[j];
+            track_trackDistance->Fill(1000. * (localIntercept.x() - inter2.x()), 1000. * (localIntercept.y() - inter2.y()));
         }
 
         // DUT geometry
@@ -746,7 +790,6 @@ StatusCode AnalysisDUT::run(const std::shared_ptr<Clipboard>& clipboard) {
 
         // Fill correlation plots after applying cuts:
         if(correlations_) {
-            auto clusters = clipboard->getData<Cluster>(m_detector->getName());
             for(auto& cls : clusters) {
                 double xdistance_um = (globalIntercept.X() - cls->global().x()) * 1000.;
                 double ydistance_um = (globalIntercept.Y() - cls->global().y()) * 1000.;
@@ -778,10 +821,9 @@ StatusCode AnalysisDUT::run(const std::shared_ptr<Clipboard>& clipboard) {
             continue;
         }
 
-        // Calculate in-pixel position of track in microns
-        auto inpixel = m_detector->inPixel(localIntercept);
-        auto xmod_um = inpixel.X() * 1000.; // convert mm -> um
-        auto ymod_um = inpixel.Y() * 1000.; // convert mm -> um
+        // In-pixel position of track in microns
+        auto xmod_um = inpixel_x[i] * 1000.; // convert mm -> um
+        auto ymod_um = inpixel_y[i] * 1000.; // convert mm -> um
 
         hCutHisto->Fill(ETrackSelection::kPass);
         // Loop over all associated DUT clusters:
@@ -820,7 +862,7 @@ StatusCode AnalysisDUT::run(const std::shared_ptr<Clipboard>& clipboard) {
             associatedTracksVersusTime->Fill(track->timestamp() / 1e9); // convert ns -> s
 
             // Check distance between track and cluster in local coordinates
-            auto intercept = m_detector->getLocalIntercept(track.get());
+            const auto& intercept = localIntercept;
             double local_x_distance = intercept.X() - assoc_cluster->local().x();
             double local_y_distance = intercept.Y() - assoc_cluster->local().y();
             double local_x_distance_um = local_x_distance * 1000.;
@@ -870,7 +912,7 @@ StatusCode AnalysisDUT::run(const std::shared_ptr<Clipboard>& clipboard) {
 
             // Global residuals
 
-            ROOT::Math::XYZPoint global_lintercept = m_detector->getIntercept(track.get());
+            const auto& global_lintercept = globalIntercept;
             double global_x_distance = global_lintercept.X() - assoc_cluster->global().x();
             double global_y_distance = global_lintercept.Y() - assoc_cluster->global().y();
             double global_x_distance_um = global_x_distance * 1000.;
@@ -146,6 +146,7 @@ namespace corryvreckan {
         int n_rawbins_;
         double raw_histo_range_;
         bool correlations_;
+        double track_distance_max_;
         int num_tracks_;
 
         void createGlobalResidualPlots();
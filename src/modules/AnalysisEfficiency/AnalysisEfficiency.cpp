@@ -369,10 +369,16 @@ StatusCode AnalysisEfficiency::run(const std::shared_ptr<Clipboard>& clipboard)
     // Get the event:
     auto event = clipboard->getEvent();
 
+    // Reference tracks passing all selection cuts, buffered as structure of arrays
+    std::vector<Track*> selected_tracks;
+    std::vector<bool> selected_within_roi;
+    std::vector<double> selected_local_x, selected_local_y;
+    std::vector<double> selected_global_x, selected_global_y;
+    std::vector<double> selected_column, selected_row;
+
     // Loop over all tracks
     for(auto& track : tracks) {
         n_track++;
-        bool has_associated_cluster = false;
         bool is_within_roi = true;
         LOG(DEBUG) << "Looking at next track";
 
@@ -446,10 +452,38 @@ StatusCode AnalysisEfficiency::run(const std::shared_ptr<Clipboard>& clipboard)
         // Count this as reference track:
         total_tracks++;
 
-        // Calculate in-pixel position of track in microns
-        auto inpixel = m_detector->inPixel(localIntercept);
-        auto xmod = inpixel.X();
-        auto ymod = inpixel.Y();
+        // Buffer the reference track for the batched in-pixel calculation below
+        selected_tracks.push_back(track.get());
+        selected_within_roi.push_back(is_within_roi);
+        selected_local_x.push_back(localIntercept.X());
+        selected_local_y.push_back(localIntercept.Y());
+        selected_global_x.push_back(globalIntercept.X());
+        selected_global_y.push_back(globalIntercept.Y());
+        selected_column.push_back(m_detector->getColumn(localIntercept));
+        selected_row.push_back(m_detector->getRow(localIntercept));
+    } // end loop over tracks
+
+    // Calculate the in-pixel positions of all reference tracks of this event at once
+    const auto n_selected = selected_tracks.size();
+    std::vector<double> selected_xmod(n_selected);
+    std::vector<double> selected_ymod(n_selected);
+    m_detector->inPixelBatch(n_selected,
+                             selected_local_x.data(),
+                             selected_local_y.data(),
+                             selected_xmod.data(),
+                             selected_ymod.data());
+
+    // Loop over all reference tracks, in the order of the tracks
+    for(size_t i = 0; i < n_selected; ++i) {
+        auto* track = selected_tracks[i];
+        bool has_associated_cluster = false;
+        bool is_within_roi = selected_within_roi[i];
+        auto column = selected_column[i];
+        auto row = selected_row[i];
+
+        // In-pixel position of track in microns
+        auto xmod = selected_xmod[i];
+        auto ymod = selected_ymod[i];
         auto xmod_um = xmod * 1000.; // mm->um (for plotting)
         auto ymod_um = ymod * 1000.; // mm->um (for plotting)
 
@@ -464,8 +498,7 @@ StatusCode AnalysisEfficiency::run(const std::shared_ptr<Clipboard>& clipboard)
             matched_tracks++;
             auto pixels = cluster->pixels();
             for(auto& pixel : pixels) {
-                if((pixel->column() == static_cast<int>(m_detector->getColumn(localIntercept)) &&
-                    pixel->row() == static_cast<int>(m_detector->getRow(localIntercept))) &&
+                if((pixel->column() == static_cast<int>(column) && pixel->row() == static_cast<int>(row)) &&
                    isWithinInPixelROI) {
                     hPixelEfficiencyMatrix_TProfile->Fill(pixel->column(), pixel->row(), 1);
                     break; // There cannot be a second pixel within the cluster through which the track goes.
@@ -474,32 +507,29 @@ StatusCode AnalysisEfficiency::run(const std::shared_ptr<Clipboard>& clipboard)
 
             auto clusterLocal = m_detector->globalToLocal(cluster->global());
 
-            auto distance =
-                ROOT::Math::XYZVector(localIntercept.x() - clusterLocal.x(), localIntercept.y() - clusterLocal.y(), 0);
+            auto distance = ROOT::Math::XYZVector(
+                selected_local_x[i] - clusterLocal.x(), selected_local_y[i] - clusterLocal.y(), 0);
             hDistanceCluster_track->Fill(distance.X(), distance.Y());
             hDistanceCluster->Fill(std::sqrt(distance.Mag2()));
         }
 
         if(!has_associated_cluster && isWithinInPixelROI) {
-            hPixelEfficiencyMatrix_TProfile->Fill(
-                m_detector->getColumn(localIntercept), m_detector->getRow(localIntercept), 0);
+            hPixelEfficiencyMatrix_TProfile->Fill(column, row, 0);
         }
 
-        hGlobalEfficiencyMap_trackPos_TProfile->Fill(globalIntercept.X(), globalIntercept.Y(), has_associated_cluster);
-        hGlobalEfficiencyMap_trackPos->Fill(has_associated_cluster, globalIntercept.X(), globalIntercept.Y());
+        hGlobalEfficiencyMap_trackPos_TProfile->Fill(selected_global_x[i], selected_global_y[i], has_associated_cluster);
+        hGlobalEfficiencyMap_trackPos->Fill(has_associated_cluster, selected_global_x[i], selected_global_y[i]);
 
-        hChipEfficiencyMap_trackPos_TProfile->Fill(
-            m_detector->getColumn(localIntercept), m_detector->getRow(localIntercept), has_associated_cluster);
-        hChipEfficiencyMap_trackPos->Fill(
-            has_associated_cluster, m_detector->getColumn(localIntercept), m_detector->getRow(localIntercept));
+        hChipEfficiencyMap_trackPos_TProfile->Fill(column, row, has_associated_cluster);
+        hChipEfficiencyMap_trackPos->Fill(has_associated_cluster, column, row);
 
         // For pixels, only look at the ROI:
         if(is_within_roi) {
             hPixelEfficiencyMap_trackPos_TProfile->Fill(xmod_um, ymod_um, has_associated_cluster);
             hPixelEfficiencyMap_trackPos->Fill(has_associated_cluster, xmod_um, ymod_um);
             eTotalEfficiency->Fill(has_associated_cluster, 0); // use 0th bin for total efficiency
-            efficiencyColumns->Fill(has_associated_cluster, m_detector->getColumn(localIntercept));
-            efficiencyRows->Fill(has_associated_cluster, m_detector->getRow(localIntercept));
+            efficiencyColumns->Fill(has_associated_cluster, column);
+            efficiencyRows->Fill(has_associated_cluster, row);
             efficiencyVsTime->Fill(has_associated_cluster, track->timestamp() / 1e9);     // convert nanoseconds to seconds
             efficiencyVsTimeLong->Fill(has_associated_cluster, track->timestamp() / 1e9); // convert nanoseconds to seconds
             if(isWithinInPixelROI) {
@@ -508,8 +538,8 @@ StatusCode AnalysisEfficiency::run(const std::shared_ptr<Clipboard>& clipboard)
             }
         }
 
-        auto intercept_col = static_cast<size_t>(m_detector->getColumn(localIntercept));
-        auto intercept_row = static_cast<size_t>(m_detector->getRow(localIntercept));
+        auto intercept_col = static_cast<size_t>(column);
+        auto intercept_row = static_cast<size_t>(row);
 
         if(has_associated_cluster) {
             for(auto c : associated_clusters) {
@@ -518,10 +548,9 @@ StatusCode AnalysisEfficiency::run(const std::shared_ptr<Clipboard>& clipboard)
             }
             hTimeDiffPrevTrack_assocCluster->Fill(
                 static_cast<double>(Units::convert(track->timestamp() - last_track_timestamp, "us")));
-            hRowDiffPrevTrack_assocCluster->Fill(m_detector->getRow(localIntercept) - last_track_row);
-            hColDiffPrevTrack_assocCluster->Fill(m_detector->getColumn(localIntercept) - last_track_col);
-            hPosDiffPrevTrack_assocCluster->Fill(m_detector->getColumn(localIntercept) - last_track_col,
-                                                 m_detector->getRow(localIntercept) - last_track_row);
+            hRowDiffPrevTrack_assocCluster->Fill(row - last_track_row);
+            hColDiffPrevTrack_assocCluster->Fill(column - last_track_col);
+            hPosDiffPrevTrack_assocCluster->Fill(column - last_track_col, row - last_track_row);
             if((prev_hit_ts.at(intercept_col)).at(intercept_row) != 0) {
                 hTrackTimeToPrevHit_matched->Fill(static_cast<double>(
                     Units::convert(track->timestamp() - prev_hit_ts.at(intercept_col).at(intercept_row), "us")));
@@ -529,10 +558,9 @@ StatusCode AnalysisEfficiency::run(const std::shared_ptr<Clipboard>& clipboard)
         } else {
             hTimeDiffPrevTrack_noAssocCluster->Fill(
                 static_cast<double>(Units::convert(track->timestamp() - last_track_timestamp, "us")));
-            hRowDiffPrevTrack_noAssocCluster->Fill(m_detector->getRow(localIntercept) - last_track_row);
-            hColDiffPrevTrack_noAssocCluster->Fill(m_detector->getColumn(localIntercept) - last_track_col);
-            hPosDiffPrevTrack_noAssocCluster->Fill(m_detector->getColumn(localIntercept) - last_track_col,
-                                                   m_detector->getRow(localIntercept) - last_track_row);
+            hRowDiffPrevTrack_noAssocCluster->Fill(row - last_track_row);
+            hColDiffPrevTrack_noAssocCluster->Fill(column - last_track_col);
+            hPosDiffPrevTrack_noAssocCluster->Fill(column - last_track_col, row - last_track_row);
             if((prev_hit_ts.at(intercept_col)).at(intercept_row) != 0) {
                 LOG(DEBUG) << "Found a time difference of "
                            << Units::display(track->timestamp() - prev_hit_ts.at(intercept_col).at(intercept_row), "us");
@@ -541,9 +569,9 @@ StatusCode AnalysisEfficiency::run(const std::shared_ptr<Clipboard>& clipboard)
             }
         }
         last_track_timestamp = track->timestamp();
-        last_track_col = m_detector->getColumn(localIntercept);
-        last_track_row = m_detector->getRow(localIntercept);
-    } // end loop over tracks
+        last_track_col = column;
+        last_track_row = row;
+    } // end loop over reference tracks
 
     // Before going to the next event, loop over all pixels (all hits incl. noise)
     // and fill matrix with timestamps of previous pixels.
@@ -12,9 +12,86 @@
 #include "Correlations.h"
 #include "tools/cuts.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <utility>
+#include <vector>
+
 using namespace corryvreckan;
 using namespace std;
 
+namespace {
+    // Number of entries per distinct value, sorted by value
+    template <typename T> std::vector<std::pair<T, double>> occupancy(std::vector<T> values) {
+        std::sort(values.begin(), values.end());
+        std::vector<std::pair<T, double>> result;
+        for(const auto& value : values) {
+            if(result.empty() || result.back().first != value) {
+                result.emplace_back(value, 0.);
+            }
+            result.back().second += 1.;
+        }
+        return result;
+    }
+
+    // Identical to count unit-weight fills of the same value, without allocating the sum of squared weights
+    void fill_repeated(TH1* histogram, double x, double count) {
+        // Statistics have to be retrieved before modifying the bin contents since ROOT may recompute them from these
+        std::array<double, 4> stats{};
+        histogram->GetStats(stats.data());
+        auto bin = histogram->GetXaxis()->FindBin(x);
+        histogram->AddBinContent(bin, count);
+        if(histogram->GetSumw2N() > 0) {
+            histogram->GetSumw2()->fArray[bin] += count;
+        }
+        histogram->SetEntries(histogram->GetEntries() + count);
+        if(bin > 0 && bin <= histogram->GetNbinsX()) {
+            stats[0] += count;
+            stats[1] += count;
+            stats[2] += count * x;
+            stats[3] += count * x * x;
+            histogram->PutStats(stats.data());
+        }
+    }
+
+    // Identical to count unit-weight fills of the same value pair, without allocating the sum of squared weights
+    void fill_repeated(TH2* histogram, double x, double y, double count) {
+        std::array<double, 7> stats{};
+        histogram->GetStats(stats.data());
+        auto bin_x = histogram->GetXaxis()->FindBin(x);
+        auto bin_y = histogram->GetYaxis()->FindBin(y);
+        auto bin = histogram->GetBin(bin_x, bin_y);
+        histogram->AddBinContent(bin, count);
+        if(histogram->GetSumw2N() > 0) {
+            histogram->GetSumw2()->fArray[bin] += count;
+        }
+        histogram->SetEntries(histogram->GetEntries() + count);
+        if(bin_x > 0 && bin_x <= histogram->GetNbinsX() && bin_y > 0 && bin_y <= histogram->GetNbinsY()) {
+            stats[0] += count;
+            stats[1] += count;
+            stats[2] += count * x;
+            stats[3] += count * x * x;
+            stats[4] += count * y;
+            stats[5] += count * y * y;
+            stats[6] += count * x * y;
+            histogram->PutStats(stats.data());
+        }
+    }
+
+    // Identical to count fills outside of the histogram range, which only contribute to the entries
+    void fill_outside(TH1* histogram, int bin, double count) {
+        if(count > 0) {
+            histogram->AddBinContent(bin, count);
+            if(histogram->GetSumw2N() > 0) {
+                histogram->GetSumw2()->fArray[bin] += count;
+            }
+            histogram->SetEntries(histogram->GetEntries() + count);
+        }
+    }
+} // namespace
+
 Correlations::Correlations(Configuration& config, std::shared_ptr<Detector> detector)
     : Module(config, detector), m_detector(detector) {
 
@@ -37,6 +114,13 @@ Correlations::Correlations(Configuration& config, std::shared_ptr<Detector> dete
     corr_vs_time_ = config_.get<bool>("correlation_vs_time");
     time_binning_ = config_.get<double>("time_binning");
 
+    config_.setDefault<PairSearch>("pair_search", PairSearch::ALL);
+    pair_search_ = config_.get<PairSearch>("pair_search");
+    if(pair_search_ == PairSearch::SORTED && corr_vs_time_) {
+        LOG(WARNING) << "Correlations versus time require all pairs, ignoring sorted pair search";
+        pair_search_ = PairSearch::ALL;
+    }
+
     // Plotting
     config_.setDefault<double>("range_abs", Units::get<double>(10, "mm"));
     config_.setDefault<int>("nbins_global", 1000);
@@ -96,6 +180,13 @@ StatusCode Correlations::run(const std::shared_ptr<Clipboard>& clipboard) {
     auto reference = get_reference();
     auto referencePixels = clipboard->getData<Pixel>(reference->getName());
     auto referenceClusters = clipboard->getData<Cluster>(reference->getName());
+
+    if(pair_search_ == PairSearch::SORTED) {
+        correlate_pixels_sorted(pixels, referencePixels, timer_signals);
+        correlate_clusters_sorted(clusters, referenceClusters, firsttrigger);
+        return StatusCode::Success;
+    }
+
     // Loop over reference plane pixels:
     for(auto& refPixel : referencePixels) {
         for(auto& pixel : pixels) {
@@ -139,27 +230,7 @@ StatusCode Correlations::run(const std::shared_ptr<Clipboard>& clipboard) {
 
             // Correlation plots
             if(abs(timeDifference) < time_cut_ || !do_time_cut_) {
-                auto globalXref = refCluster->global().x();
-                auto globalXcluster = cluster->global().x();
-                auto globalYref = refCluster->global().y();
-                auto globalYcluster = cluster->global().y();
-                correlationX->Fill(globalXref - globalXcluster);
-                correlationX2D->Fill(globalXcluster, globalXref);
-                correlationX2Dlocal->Fill(cluster->column(), refCluster->column());
-
-                correlationY->Fill(globalYref - globalYcluster);
-                correlationY2D->Fill(globalYcluster, globalYref);
-                correlationY2Dlocal->Fill(cluster->row(), refCluster->row());
-
-                correlationXY->Fill(globalYref - globalXcluster);
-                correlationXY2D->Fill(globalYref, globalXcluster);
-                correlationYX->Fill(globalXref - globalYcluster);
-                correlationYX2D->Fill(globalXref, globalYcluster);
-
-                correlationXVsTrigger->Fill(firsttrigger, globalXref - globalXcluster);
-                correlationYVsTrigger->Fill(firsttrigger, globalYref - globalYcluster);
-                correlationXYVsTrigger->Fill(firsttrigger, globalYref - globalXcluster);
-                correlationYXVsTrigger->Fill(firsttrigger, globalXref - globalYcluster);
+                fill_spatial_correlations(cluster.get(), refCluster.get(), firsttrigger);
             }
 
             correlationTime->Fill(timeDifference); // time difference in ns
@@ -190,6 +261,188 @@ StatusCode Correlations::run(const std::shared_ptr<Clipboard>& clipboard) {
     return StatusCode::Success;
 }
 
+void Correlations::fill_spatial_correlations(const Cluster* cluster, const Cluster* refCluster, uint32_t firsttrigger) {
+    auto globalXref = refCluster->global().x();
+    auto globalXcluster = cluster->global().x();
+    auto globalYref = refCluster->global().y();
+    auto globalYcluster = cluster->global().y();
+    correlationX->Fill(globalXref - globalXcluster);
+    correlationX2D->Fill(globalXcluster, globalXref);
+    correlationX2Dlocal->Fill(cluster->column(), refCluster->column());
+
+    correlationY->Fill(globalYref - globalYcluster);
+    correlationY2D->Fill(globalYcluster, globalYref);
+    correlationY2Dlocal->Fill(cluster->row(), refCluster->row());
+
+    correlationXY->Fill(globalYref - globalXcluster);
+    correlationXY2D->Fill(globalYref, globalXcluster);
+    correlationYX->Fill(globalXref - globalYcluster);
+    correlationYX2D->Fill(globalXref, globalYcluster);
+
+    correlationXVsTrigger->Fill(firsttrigger, globalXref - globalXcluster);
+    correlationYVsTrigger->Fill(firsttrigger, globalYref - globalYcluster);
+    correlationXYVsTrigger->Fill(firsttrigger, globalYref - globalXcluster);
+    correlationYXVsTrigger->Fill(firsttrigger, globalXref - globalYcluster);
+}
+
+/*
+ * Every pair of pixels contributes exactly one entry to the 2D pixel correlations, which are therefore the outer products
+ * of the occupancies of both planes. Since pixel addresses are integers, the statistics stored with the histograms are
+ * identical to filling all pairs. Time differences are only filled individually for pairs within the histogram range,
+ * found by a sweep over the time-sorted pixels, and in the same order as the loop over all pairs.
+ */
+void Correlations::correlate_pixels_sorted(const PixelVector& pixels,
+                                           const PixelVector& referencePixels,
+                                           const TimerSignalVector& timer_signals) {
+    if(!pixels.empty() && !referencePixels.empty()) {
+        std::vector<int> columns, rows, ref_columns, ref_rows;
+        for(const auto& pixel : pixels) {
+            columns.push_back(pixel->column());
+            rows.push_back(pixel->row());
+        }
+        for(const auto& refPixel : referencePixels) {
+            ref_columns.push_back(refPixel->column());
+            ref_rows.push_back(refPixel->row());
+        }
+        auto column_occupancy = occupancy(std::move(columns));
+        auto row_occupancy = occupancy(std::move(rows));
+        auto ref_column_occupancy = occupancy(std::move(ref_columns));
+        auto ref_row_occupancy = occupancy(std::move(ref_rows));
+
+        for(const auto& [column, entries] : column_occupancy) {
+            for(const auto& [ref_column, ref_entries] : ref_column_occupancy) {
+                fill_repeated(correlationColCol_px, column, ref_column, entries * ref_entries);
+            }
+            for(const auto& [ref_row, ref_entries] : ref_row_occupancy) {
+                fill_repeated(correlationColRow_px, column, ref_row, entries * ref_entries);
+            }
+        }
+        for(const auto& [row, entries] : row_occupancy) {
+            for(const auto& [ref_column, ref_entries] : ref_column_occupancy) {
+                fill_repeated(correlationRowCol_px, row, ref_column, entries * ref_entries);
+            }
+            for(const auto& [ref_row, ref_entries] : ref_row_occupancy) {
+                fill_repeated(correlationRowRow_px, row, ref_row, entries * ref_entries);
+            }
+        }
+
+        // The time difference to a reference pixel decreases monotonically along the time-sorted pixels
+        std::vector<size_t> order(pixels.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return pixels[a]->timestamp() < pixels[b]->timestamp();
+        });
+
+        const auto low = correlationTime_px->GetXaxis()->GetXmin();
+        const auto high = correlationTime_px->GetXaxis()->GetXmax();
+        std::vector<size_t> window;
+        for(const auto& refPixel : referencePixels) {
+            auto difference = [&](size_t i) {
+                return static_cast<double>(Units::convert(refPixel->timestamp() - pixels[i]->timestamp(), "ns"));
+            };
+            auto first = std::partition_point(
+                order.begin(), order.end(), [&](size_t i) { return !(difference(i) < high); });
+            auto last = std::partition_point(first, order.end(), [&](size_t i) { return !(difference(i) < low); });
+
+            fill_outside(correlationTime_px,
+                         correlationTime_px->GetNbinsX() + 1,
+                         static_cast<double>(std::distance(order.begin(), first)));
+            fill_outside(correlationTime_px, 0, static_cast<double>(std::distance(last, order.end())));
+
+            window.assign(first, last);
+            std::sort(window.begin(), window.end());
+            for(const auto i : window) {
+                correlationTime_px->Fill(difference(i));
+            }
+        }
+    }
+
+    for(const auto& refPixel : referencePixels) {
+        for(const auto& timer_signal : timer_signals) {
+            double timeDiff = refPixel->timestamp() - timer_signal->timestamp();
+            correlationTimerSignalTime_px->Fill(static_cast<double>(Units::convert(timeDiff, "ns")));
+        }
+    }
+}
+
+/*
+ * With a time cut, only pairs of clusters within the time cut or within the range of the time correlation histogram are
+ * visited, found by a sweep over the time-sorted reference clusters. They are filled in the same order as the loop over
+ * all pairs, such that all histograms except for the integer time correlation are identical. The latter is computed as
+ * convolution of the cluster occupancies in bins of 25 ns, which does not require to visit all pairs of clusters.
+ */
+void Correlations::correlate_clusters_sorted(const ClusterVector& clusters,
+                                             const ClusterVector& referenceClusters,
+                                             uint32_t firsttrigger) {
+    // Sorted by decreasing time, such that the time difference to a cluster decreases monotonically
+    std::vector<size_t> order(referenceClusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return referenceClusters[a]->timestamp() > referenceClusters[b]->timestamp();
+    });
+
+    std::vector<long long int> bins;
+    std::vector<size_t> window;
+    for(const auto& cluster : clusters) {
+
+        // Check that track is within region of interest using winding number algorithm
+        if(!m_detector->isWithinROI(cluster.get())) {
+            LOG(DEBUG) << " - cluster outside ROI";
+            continue;
+        }
+        bins.push_back(static_cast<long long int>(std::floor(cluster->timestamp() / 25)));
+
+        auto difference = [&](size_t i) { return referenceClusters[i]->timestamp() - cluster->timestamp(); };
+        if(!do_time_cut_) {
+            for(const auto& refCluster : referenceClusters) {
+                fill_spatial_correlations(cluster.get(), refCluster.get(), firsttrigger);
+                correlationTime->Fill(refCluster->timestamp() - cluster->timestamp());
+            }
+            continue;
+        }
+
+        // First reference cluster with a time difference below the given value
+        auto below = [&](auto begin, double value) {
+            return std::partition_point(begin, order.end(), [&](size_t i) { return !(difference(i) < value); });
+        };
+        auto first_range = below(order.begin(), correlationTime->GetXaxis()->GetXmax());
+        auto last_range = below(first_range, correlationTime->GetXaxis()->GetXmin());
+        auto first_cut = below(order.begin(), time_cut_);
+        auto last_cut = std::partition_point(first_cut, order.end(), [&](size_t i) { return difference(i) > -time_cut_; });
+        auto first = std::min(first_range, first_cut);
+        auto last = std::max(last_range, last_cut);
+
+        fill_outside(correlationTime,
+                     correlationTime->GetNbinsX() + 1,
+                     static_cast<double>(std::distance(order.begin(), first)));
+        fill_outside(correlationTime, 0, static_cast<double>(std::distance(last, order.end())));
+
+        window.assign(first, last);
+        std::sort(window.begin(), window.end());
+        for(const auto i : window) {
+            double timeDifference = difference(i);
+            if(abs(timeDifference) < time_cut_) {
+                fill_spatial_correlations(cluster.get(), referenceClusters[i].get(), firsttrigger);
+            }
+            correlationTime->Fill(timeDifference);
+        }
+    }
+
+    if(bins.empty()) {
+        return;
+    }
+    std::vector<long long int> ref_bins;
+    for(const auto& refCluster : referenceClusters) {
+        ref_bins.push_back(static_cast<long long int>(std::floor(refCluster->timestamp() / 25)));
+    }
+    auto cluster_occupancy = occupancy(std::move(bins));
+    for(const auto& [ref_bin, ref_entries] : occupancy(std::move(ref_bins))) {
+        for(const auto& [bin, entries] : cluster_occupancy) {
+            fill_repeated(correlationTimeInt, static_cast<double>(ref_bin - bin), ref_entries * entries);
+        }
+    }
+}
+
 // Booking of histograms
 void Correlations::bookStandardHistograms(int trigger_max,
                                           double range_abs,
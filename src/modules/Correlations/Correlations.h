@@ -36,6 +36,42 @@ namespace corryvreckan {
         StatusCode run(const std::shared_ptr<Clipboard>& clipboard) override;
 
     private:
+        /**
+         * @brief Method used to find the pairs of detector and reference objects to correlate
+         */
+        enum class PairSearch {
+            ALL,    ///< Loop over all pairs of pixels and clusters
+            SORTED, ///< Sweep over time-sorted reference clusters and fill pixel correlations from occupancies
+        };
+
+        /**
+         * @brief Fill pixel correlations of an event using occupancies and a sorted time sweep
+         * @param pixels Pixels of the detector
+         * @param referencePixels Pixels of the reference detector
+         * @param timer_signals Timer signals of the detector
+         */
+        void correlate_pixels_sorted(const PixelVector& pixels,
+                                     const PixelVector& referencePixels,
+                                     const TimerSignalVector& timer_signals);
+
+        /**
+         * @brief Fill cluster correlations of an event using a sorted time sweep
+         * @param clusters Clusters of the detector
+         * @param referenceClusters Clusters of the reference detector
+         * @param firsttrigger First trigger ID of the event
+         */
+        void correlate_clusters_sorted(const ClusterVector& clusters,
+                                       const ClusterVector& referenceClusters,
+                                       uint32_t firsttrigger);
+
+        /**
+         * @brief Fill the spatial correlations of a pair of clusters
+         * @param cluster Cluster of the detector
+         * @param refCluster Cluster of the reference detector
+         * @param firsttrigger First trigger ID of the event
+         */
+        void fill_spatial_correlations(const Cluster* cluster, const Cluster* refCluster, uint32_t firsttrigger);
+
         std::shared_ptr<Detector> m_detector;
 
         // Pixel histograms
@@ -82,6 +118,7 @@ namespace corryvreckan {
         bool do_time_cut_;
         bool corr_vs_time_;
         double time_binning_;
+        PairSearch pair_search_;
 
         // Functions for booking of histogram
         // Booking of histograms for normal detectors
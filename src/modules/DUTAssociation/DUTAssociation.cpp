@@ -12,6 +12,12 @@
 #include "DUTAssociation.h"
 #include "tools/cuts.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
 using namespace corryvreckan;
 using namespace std;
 
@@ -39,6 +45,15 @@ DUTAssociation::DUTAssociation(Configuration& config, std::shared_ptr<Detector>
     // spatial cut, relative (x * spatial_resolution) or absolute:
     spatial_cut_ = corryvreckan::calculate_cut<XYVector>("spatial_cut", config_, m_detector);
     use_cluster_centre_ = config_.get<bool>("use_cluster_centre");
+
+    config_.setDefault<bool>("use_cluster_index", false);
+    use_cluster_index_ = config_.get<bool>("use_cluster_index");
+    if(use_cluster_index_ && m_detector->is<PolarDetector>()) {
+        LOG(WARNING) << "Cluster index not available for polar detectors, testing all clusters";
+        use_cluster_index_ = false;
+    }
+    // Search range of the index, slightly enlarged to be robust against rounding
+    index_reach_ = spatial_cut_ * (1. + 1e-6);
     elliptic_cut_ = config_.get<bool>("elliptic_cut", true);
 
     charge_cut_ = config_.get<double>("charge_cut");
@@ -154,6 +169,24 @@ StatusCode DUTAssociation::run(const std::shared_ptr<Clipboard>& clipboard) {
     // Get the DUT clusters from the clipboard
     auto clusters = clipboard->getData<Cluster>(m_detector->getName());
 
+    // Convert pixel addresses to local coordinates once for all tracks
+    pixel_positions_.resize(clusters.size());
+    for(size_t i = 0; i < clusters.size(); ++i) {
+        pixel_positions_[i].clear();
+        for(auto& pixel : clusters[i]->pixels()) {
+            pixel_positions_[i].push_back(
+                m_detector->getLocalPosition(static_cast<double>(pixel->column()), static_cast<double>(pixel->row())));
+        }
+    }
+
+    std::vector<size_t> candidates;
+    if(use_cluster_index_) {
+        build_index(clusters);
+    } else {
+        candidates.resize(clusters.size());
+        std::iota(candidates.begin(), candidates.end(), 0);
+    }
+
     // Loop over all tracks
     for(auto& track : tracks) {
         total_tracks_++;
@@ -171,9 +204,15 @@ StatusCode DUTAssociation::run(const std::shared_ptr<Clipboard>& clipboard) {
 
         // Check distance between track and cluster
         auto interceptLocal = m_detector->getLocalIntercept(track.get());
-        LOG(TRACE) << "Starting loop over all clusters";
+        if(use_cluster_index_) {
+            find_candidates(clusters, interceptLocal, track->timestamp(), candidates);
+            LOG(TRACE) << "Starting loop over " << candidates.size() << " candidate clusters";
+        } else {
+            LOG(TRACE) << "Starting loop over all clusters";
+        }
         // Loop over all DUT clusters
-        for(auto& cluster : clusters) {
+        for(const auto index : candidates) {
+            auto& cluster = clusters[index];
 
             // distance of track to cluster centre
             double xdistance_centre = std::abs(interceptLocal.X() - cluster->local().x());
@@ -184,11 +223,7 @@ StatusCode DUTAssociation::run(const std::shared_ptr<Clipboard>& clipboard) {
             auto ydistance_nearest = std::numeric_limits<double>::max();
             LOG(TRACE) << "Cluster distance to track intercept " << xdistance_centre << "," << ydistance_centre;
 
-            for(auto& pixel : cluster->pixels()) {
-                // convert pixel address to local coordinates:
-                auto pixelPositionLocal =
-                    m_detector->getLocalPosition(static_cast<double>(pixel->column()), static_cast<double>(pixel->row()));
-
+            for(auto& pixelPositionLocal : pixel_positions_[index]) {
                 xdistance_nearest = std::min(xdistance_nearest, std::abs(interceptLocal.X() - pixelPositionLocal.x()));
                 ydistance_nearest = std::min(ydistance_nearest, std::abs(interceptLocal.Y() - pixelPositionLocal.y()));
 
@@ -319,6 +354,114 @@ StatusCode DUTAssociation::run(const std::shared_ptr<Clipboard>& clipboard) {
     return StatusCode::Success;
 }
 
+void DUTAssociation::build_index(const ClusterVector& clusters) {
+    index_cells_.clear();
+    index_cells_x_ = 0;
+    index_cells_y_ = 0;
+    if(clusters.empty()) {
+        return;
+    }
+
+    // Bounding boxes of all clusters in local coordinates, spanning all pixels as well as the cluster centre
+    std::vector<std::array<double, 4>> boxes;
+    boxes.reserve(clusters.size());
+    for(size_t i = 0; i < clusters.size(); ++i) {
+        auto centre = clusters[i]->local();
+        std::array<double, 4> box{centre.x(), centre.x(), centre.y(), centre.y()};
+        for(const auto& position : pixel_positions_[i]) {
+            box[0] = std::min(box[0], position.x());
+            box[1] = std::max(box[1], position.x());
+            box[2] = std::min(box[2], position.y());
+            box[3] = std::max(box[3], position.y());
+        }
+        boxes.push_back(box);
+    }
+
+    index_origin_x_ = std::min_element(boxes.begin(), boxes.end(), [](auto& a, auto& b) { return a[0] < b[0]; })->at(0);
+    index_origin_y_ = std::min_element(boxes.begin(), boxes.end(), [](auto& a, auto& b) { return a[2] < b[2]; })->at(2);
+    auto extent_x = std::max_element(boxes.begin(), boxes.end(), [](auto& a, auto& b) { return a[1] < b[1]; })->at(1) -
+                    index_origin_x_;
+    auto extent_y = std::max_element(boxes.begin(), boxes.end(), [](auto& a, auto& b) { return a[3] < b[3]; })->at(3) -
+                    index_origin_y_;
+
+    // Cells span the full search range, such that a track only needs to test up to two cells per axis. The number of
+    // cells is limited to the order of the number of clusters.
+    auto max_cells = std::ceil(std::sqrt(static_cast<double>(clusters.size())));
+    index_cell_x_ = std::max({2. * index_reach_.x(), extent_x / max_cells, std::numeric_limits<double>::min()});
+    index_cell_y_ = std::max({2. * index_reach_.y(), extent_y / max_cells, std::numeric_limits<double>::min()});
+    index_cells_x_ = static_cast<size_t>(std::min(std::floor(extent_x / index_cell_x_) + 1, max_cells));
+    index_cells_y_ = static_cast<size_t>(std::min(std::floor(extent_y / index_cell_y_) + 1, max_cells));
+    index_cells_.resize(index_cells_x_ * index_cells_y_);
+
+    auto cell = [](double value, double origin, double size, size_t cells) {
+        auto n = std::floor((value - origin) / size);
+        return static_cast<size_t>(std::clamp(n, 0., static_cast<double>(cells - 1)));
+    };
+    for(size_t i = 0; i < clusters.size(); ++i) {
+        const auto& box = boxes[i];
+        for(auto y = cell(box[2], index_origin_y_, index_cell_y_, index_cells_y_);
+            y <= cell(box[3], index_origin_y_, index_cell_y_, index_cells_y_);
+            ++y) {
+            for(auto x = cell(box[0], index_origin_x_, index_cell_x_, index_cells_x_);
+                x <= cell(box[1], index_origin_x_, index_cell_x_, index_cells_x_);
+                ++x) {
+                index_cells_[x + index_cells_x_ * y].push_back(i);
+            }
+        }
+    }
+    for(auto& indices : index_cells_) {
+        std::sort(indices.begin(), indices.end(), [&](size_t a, size_t b) {
+            return clusters[a]->timestamp() < clusters[b]->timestamp();
+        });
+    }
+}
+
+/*
+ * Clusters are only skipped if they fail the spatial or the time cut for sure, and candidates are returned in the order of
+ * the clusters on the clipboard. The associations are therefore identical to testing all clusters.
+ */
+void DUTAssociation::find_candidates(const ClusterVector& clusters,
+                                     const PositionVector3D<Cartesian3D<double>>& intercept,
+                                     double timestamp,
+                                     std::vector<size_t>& candidates) const {
+    candidates.clear();
+    if(index_cells_.empty()) {
+        return;
+    }
+
+    // Test all clusters if the cell of the intercept cannot be determined
+    if(!std::isfinite(intercept.x()) || !std::isfinite(intercept.y())) {
+        candidates.resize(clusters.size());
+        std::iota(candidates.begin(), candidates.end(), 0);
+        return;
+    }
+
+    auto cell = [](double value, double origin, double size, size_t cells) {
+        auto n = std::floor((value - origin) / size);
+        return static_cast<size_t>(std::clamp(n, 0., static_cast<double>(cells - 1)));
+    };
+    auto first_x = cell(intercept.x() - index_reach_.x(), index_origin_x_, index_cell_x_, index_cells_x_);
+    auto last_x = cell(intercept.x() + index_reach_.x(), index_origin_x_, index_cell_x_, index_cells_x_);
+    auto first_y = cell(intercept.y() - index_reach_.y(), index_origin_y_, index_cell_y_, index_cells_y_);
+    auto last_y = cell(intercept.y() + index_reach_.y(), index_origin_y_, index_cell_y_, index_cells_y_);
+
+    for(auto y = first_y; y <= last_y; ++y) {
+        for(auto x = first_x; x <= last_x; ++x) {
+            const auto& indices = index_cells_[x + index_cells_x_ * y];
+            // Time window in which clusters may pass the time cut
+            auto first = std::partition_point(indices.begin(), indices.end(), [&](size_t i) {
+                return clusters[i]->timestamp() - timestamp < -time_cut_;
+            });
+            auto last = std::partition_point(
+                first, indices.end(), [&](size_t i) { return !(clusters[i]->timestamp() - timestamp > time_cut_); });
+            candidates.insert(candidates.end(), first, last);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+}
+
 void DUTAssociation::finalize(const std::shared_ptr<ReadonlyClipboard>&) {
     hCutHisto->Scale(1 / double(num_cluster));
     LOG(STATUS) << "In total, " << assoc_cluster_counter << " clusters are associated to " << track_w_assoc_cls
@@ -16,6 +16,7 @@
 #include <TH1F.h>
 #include <TH2F.h>
 #include <iostream>
+#include <vector>
 #include "core/module/Module.hpp"
 #include "objects/Cluster.hpp"
 #include "objects/Pixel.hpp"
@@ -37,12 +38,47 @@ namespace corryvreckan {
         void finalize(const std::shared_ptr<ReadonlyClipboard>& clipboard) override;
 
     private:
+        /**
+         * @brief Build the spatio-temporal index of the clusters of the event
+         * @param clusters Clusters of the DUT
+         *
+         * Every cluster is entered into all cells of a uniform grid in local coordinates overlapped by its bounding box,
+         * spanning all its pixels and its centre. The clusters of every cell are sorted by time.
+         */
+        void build_index(const ClusterVector& clusters);
+
+        /**
+         * @brief Find the clusters which may pass the spatial and time cuts for a track
+         * @param clusters Clusters of the DUT the index has been built from
+         * @param intercept Local track intercept
+         * @param timestamp Track timestamp
+         * @param candidates Indices of the candidate clusters in ascending order
+         */
+        void find_candidates(const ClusterVector& clusters,
+                             const PositionVector3D<Cartesian3D<double>>& intercept,
+                             double timestamp,
+                             std::vector<size_t>& candidates) const;
+
         std::shared_ptr<Detector> m_detector;
         double time_cut_;
         double charge_cut_;
         ROOT::Math::XYVector spatial_cut_;
         bool elliptic_cut_;
         bool use_cluster_centre_;
+        bool use_cluster_index_;
+
+        // Local pixel positions of all clusters of the event
+        std::vector<std::vector<PositionVector3D<Cartesian3D<double>>>> pixel_positions_;
+
+        // Spatio-temporal cluster index of the event
+        std::vector<std::vector<size_t>> index_cells_;
+        XYVector index_reach_;
+        double index_origin_x_{};
+        double index_origin_y_{};
+        double index_cell_x_{};
+        double index_cell_y_{};
+        size_t index_cells_x_{};
+        size_t index_cells_y_{};
 
         TH1F* hCutHisto;
 
@@ -0,0 +1,89 @@
+/**
+ * @file
+ * @brief Implementation of module EventGeneratorSynthetic
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "EventGeneratorSynthetic.h"
+#include "objects/Event.hpp"
+
+using namespace corryvreckan;
+
+EventGeneratorSynthetic::EventGeneratorSynthetic(Configuration& config, std::vector<std::shared_ptr<Detector>> detectors)
+    : Module(config, std::move(detectors)) {
+
+    config_.setDefault<uint64_t>("random_seed", 0);
+    config_.setDefault<double>("event_length", Units::get<double>(10, "us"));
+    config_.setDefault<double>("particles_per_event", 5.);
+    config_.setDefault<double>("noise_hits", 1.);
+    config_.setDefault<double>("charge_sharing", 0.3);
+    config_.setDefault<double>("beam_size", Units::get<double>(2, "mm"));
+    config_.setDefault<double>("beam_divergence", Units::get<double>(0.1, "mrad"));
+    config_.setDefault<double>("time_resolution", Units::get<double>(1, "ns"));
+
+    seed_ = config_.get<uint64_t>("random_seed");
+    event_length_ = config_.get<double>("event_length");
+    particles_per_event_ = config_.get<double>("particles_per_event");
+    noise_hits_ = config_.get<double>("noise_hits");
+    charge_sharing_ = config_.get<double>("charge_sharing");
+    beam_size_ = config_.get<double>("beam_size");
+    beam_divergence_ = config_.get<double>("beam_divergence");
+    time_resolution_ = config_.get<double>("time_resolution");
+
+    if(event_length_ <= 0) {
+        throw InvalidValueError(config_, "event_length", "event length has to be positive");
+    }
+    if(particles_per_event_ < 0) {
+        throw InvalidValueError(config_, "particles_per_event", "number of particles cannot be negative");
+    }
+    if(noise_hits_ < 0) {
+        throw InvalidValueError(config_, "noise_hits", "number of noise hits cannot be negative");
+    }
+    if(charge_sharing_ < 0 || charge_sharing_ > 1) {
+        throw InvalidValueError(config_, "charge_sharing", "probability has to be between zero and one");
+    }
+}
+
+void EventGeneratorSynthetic::initialize() {
+    generator_ = std::make_unique<SyntheticData>(get_detectors(), seed_);
+    generator_->setBeam(beam_size_, beam_divergence_);
+    generator_->setTimeResolution(time_resolution_);
+    event_start_ = config_.get<double>("skip_time", 0.);
+    LOG(STATUS) << "Generating synthetic events with seed " << seed_;
+}
+
+StatusCode EventGeneratorSynthetic::run(const std::shared_ptr<Clipboard>& clipboard) {
+
+    auto event_end = event_start_ + event_length_;
+    clipboard->putEvent(std::make_shared<Event>(event_start_, event_end));
+    LOG(DEBUG) << "Defining event, time frame " << Units::display(event_start_, {"us", "ms", "s"}) << " to "
+               << Units::display(event_end, {"us", "ms", "s"});
+
+    auto particles = generator_->particles(generator_->poisson(particles_per_event_), event_start_, event_end);
+    particles_ += particles.size();
+
+    for(const auto& detector : generator_->detectors()) {
+        // Pixels fired by the particles, and noise hits uniformly distributed over matrix and event
+        auto pixels = generator_->pixels(*detector, particles, charge_sharing_);
+        generator_->noise(pixels, *detector, generator_->poisson(noise_hits_), event_start_, event_end);
+        if(pixels.empty()) {
+            continue;
+        }
+
+        LOG(DEBUG) << "Generated " << pixels.size() << " pixels for " << detector->getName();
+        pixels_ += pixels.size();
+        clipboard->putData(pixels, detector->getName());
+    }
+
+    event_start_ = event_end;
+    return StatusCode::Success;
+}
+
+void EventGeneratorSynthetic::finalize(const std::shared_ptr<ReadonlyClipboard>&) {
+    LOG(INFO) << "Generated " << particles_ << " particles and " << pixels_ << " pixels";
+}
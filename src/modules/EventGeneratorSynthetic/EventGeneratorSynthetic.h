@@ -0,0 +1,71 @@
+/**
+ * @file
+ * @brief Definition of module EventGeneratorSynthetic
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef EventGeneratorSynthetic_H
+#define EventGeneratorSynthetic_H 1
+
+#include <memory>
+
+#include "core/module/Module.hpp"
+#include "tools/SyntheticData.h"
+
+namespace corryvreckan {
+    /** @ingroup Modules
+     * @brief Module to generate seeded synthetic events with straight particle tracks and noise hits
+     *
+     * Every event is a time frame of fixed length, filled with a Poisson-distributed number of particles crossing all
+     * detectors along straight lines. Each crossing fires the pixel of the intercept and, with a configurable probability,
+     * each of its direct neighbours. Random noise hits are added to every detector. With a fixed seed, the generated data
+     * are identical for every run, which makes the module suitable for benchmarks of the reconstruction.
+     */
+    class EventGeneratorSynthetic : public Module {
+
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param detectors Vector of pointers to the detectors
+         */
+        EventGeneratorSynthetic(Configuration& config, std::vector<std::shared_ptr<Detector>> detectors);
+
+        /**
+         * @brief Seed the random number generator and set the start of the first event
+         */
+        void initialize() override;
+
+        /**
+         * @brief Define the next event and generate the pixels of all detectors
+         */
+        StatusCode run(const std::shared_ptr<Clipboard>& clipboard) override;
+
+        /**
+         * @brief Print the number of generated particles and pixels
+         */
+        void finalize(const std::shared_ptr<ReadonlyClipboard>& clipboard) override;
+
+    private:
+        std::unique_ptr<SyntheticData> generator_;
+        uint64_t seed_;
+
+        double event_length_;
+        double event_start_{0.};
+        double particles_per_event_;
+        double noise_hits_;
+        double charge_sharing_;
+        double beam_size_;
+        double beam_divergence_;
+        double time_resolution_;
+
+        uint64_t particles_{0};
+        uint64_t pixels_{0};
+    };
+} // namespace corryvreckan
+#endif // EventGeneratorSynthetic_H
@@ -10,8 +10,14 @@
  */
 
 #include "EventLoaderATLASpix.h"
+#include <algorithm>
 #include <regex>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace corryvreckan;
 using namespace std;
 
@@ -26,6 +32,8 @@ EventLoaderATLASpix::EventLoaderATLASpix(Configuration& config, std::shared_ptr<
     config_.setDefault<int>("high_tot_cut", 40);
     config_.setDefault<int>("buffer_depth", 1000);
     config_.setDefault<double>("time_offset", 0.);
+    config_.setDefault<bool>("build_index", false);
+    config_.setDefault<size_t>("index_spacing", 65536);
 
     m_clockCycle = config_.get<double>("clock_cycle");
     // m_clkdivendM = config_.get<int>("clkdivend") + 1;
@@ -33,11 +41,22 @@ EventLoaderATLASpix::EventLoaderATLASpix(Configuration& config, std::shared_ptr<
     m_highToTCut = config_.get<int>("high_tot_cut");
     m_buffer_depth = config_.get<int>("buffer_depth");
     m_time_offset = config_.get<double>("time_offset");
+    m_buildIndex = config_.get<bool>("build_index");
+    m_indexSpacing = config_.get<size_t>("index_spacing");
 
     // ts1Range = 0x800 * m_clkdivendM;
     ts2Range = 0x40 * m_clkdivend2M;
 }
 
+EventLoaderATLASpix::~EventLoaderATLASpix() {
+    if(mapped_data_ != nullptr) {
+        munmap(mapped_data_, mapped_size_);
+    }
+    if(file_descriptor_ >= 0) {
+        close(file_descriptor_);
+    }
+}
+
 uint32_t EventLoaderATLASpix::gray_decode(uint32_t gray) {
     uint32_t bin = gray;
     while(gray >>= 1) {
@@ -79,9 +98,16 @@ void EventLoaderATLASpix::initialize() {
     }
     LOG(STATUS) << "Opened data file for ATLASpix: (dbg)" << m_filename;
 
-    // Open the binary data file for later
-    m_file.open(m_filename.c_str(), ios::in | ios::binary);
+    // Map the binary data file for later
     LOG(DEBUG) << "Opening file " << m_filename;
+    map_file();
+
+    if(m_indexSpacing < 1) {
+        throw InvalidValueError(config_, "index_spacing", "Index spacing must be larger than 0.");
+    }
+    if(m_buildIndex) {
+        build_index();
+    }
 
     std::string title = m_detector->getName() + ": number of different messages;message type;# events";
     hMessages = new TH1F("hMessages", title.c_str(), 5, 1, 6);
@@ -198,6 +224,11 @@ StatusCode EventLoaderATLASpix::run(const std::shared_ptr<Clipboard>& clipboard)
     double start_time = event->start();
     double end_time = event->end();
 
+    // Skip data which cannot contribute to this event
+    if(index_ != nullptr && !eof_reached) {
+        seek(start_time);
+    }
+
     // prepare pixels vector
     PixelVector pixels;
     while(true) {
@@ -310,25 +341,191 @@ StatusCode EventLoaderATLASpix::run(const std::shared_ptr<Clipboard>& clipboard)
     return StatusCode::Success;
 }
 
-bool EventLoaderATLASpix::read_caribou_data() { // return false when reaching eof
+void EventLoaderATLASpix::map_file() {
+    file_descriptor_ = open(m_filename.c_str(), O_RDONLY);
+    if(file_descriptor_ < 0) {
+        throw ModuleError("Could not open data file " + m_filename);
+    }
+
+    struct stat file_stat;
+    if(fstat(file_descriptor_, &file_stat) != 0) {
+        throw ModuleError("Could not determine size of data file " + m_filename);
+    }
+    mapped_size_ = static_cast<size_t>(file_stat.st_size);
+
+    // Incomplete words at the end of the file are ignored
+    n_words_ = mapped_size_ / sizeof(uint32_t);
+    if(mapped_size_ == 0) {
+        LOG(WARNING) << "Data file " << m_filename << " is empty";
+        return;
+    }
+
+    mapped_data_ = mmap(nullptr, mapped_size_, PROT_READ, MAP_PRIVATE, file_descriptor_, 0);
+    if(mapped_data_ == MAP_FAILED) {
+        mapped_data_ = nullptr;
+        throw ModuleError("Could not memory-map data file " + m_filename);
+    }
+    madvise(mapped_data_, mapped_size_, MADV_SEQUENTIAL);
+    words_ = static_cast<const uint32_t*>(mapped_data_);
+    LOG(DEBUG) << "Mapped " << n_words_ << " data words from " << m_filename;
+}
+
+std::vector<uint64_t> EventLoaderATLASpix::pack_state(const DecoderState& state) {
+    return {state.readout_ts,
+            state.fpga_ts,
+            state.fpga_ts1,
+            state.fpga_ts2,
+            state.fpga_ts3,
+            static_cast<uint64_t>(state.new_ts1),
+            static_cast<uint64_t>(state.new_ts2),
+            static_cast<uint64_t>(state.t0_seen)};
+}
+
+EventLoaderATLASpix::DecoderState EventLoaderATLASpix::unpack_state(const std::vector<uint64_t>& words) {
+    DecoderState state;
+    state.readout_ts = words.at(0);
+    state.fpga_ts = words.at(1);
+    state.fpga_ts1 = words.at(2);
+    state.fpga_ts2 = words.at(3);
+    state.fpga_ts3 = words.at(4);
+    state.new_ts1 = (words.at(5) != 0);
+    state.new_ts2 = (words.at(6) != 0);
+    state.t0_seen = static_cast<size_t>(words.at(7));
+    return state;
+}
+
+void EventLoaderATLASpix::build_index() {
+    index_ = std::make_unique<SeekIndex>(m_filename, "ATLASpix-Caribou/1", 8);
+    if(index_->load()) {
+        LOG(INFO) << "Using cached index of data file with " << index_->size() << " checkpoints";
+        return;
+    }
+
+    LOG(INFO) << "Building index of data file with one checkpoint every " << m_indexSpacing << " words";
 
-    // Read file and load data
-    uint32_t datain;
+    DecoderState state;
+    size_t last_checkpoint = 0;
+    for(size_t offset = 0; offset < n_words_; offset++) {
+        auto datain = words_[offset];
 
-    // Read next 4-byte data from file
-    m_file.read(reinterpret_cast<char*>(&datain), 4);
-    if(m_file.eof()) {
+        // Store the state before decoding this word, but only for positions where timestamps are valid. Out-of-order
+        // readout timestamps are rejected by the index and do not provide a checkpoint.
+        if(state.t0_seen == 1 && (index_->empty() || offset - last_checkpoint >= m_indexSpacing)) {
+            if(index_->add(static_cast<double>(state.readout_ts), offset * sizeof(uint32_t), pack_state(state))) {
+                last_checkpoint = offset;
+            }
+        }
+
+        if(datain & 0x80000000) {
+            // No data is decoded after the second T0
+            if(state.t0_seen > 1) {
+                break;
+            }
+        } else {
+            decode_timestamp(datain, state);
+        }
+    }
+
+    LOG(INFO) << "Index contains " << index_->size() << " checkpoints";
+    index_->write();
+}
+
+void EventLoaderATLASpix::seek(double time) {
+    // Hits are decoded relative to the last readout timestamp and can be up to one full TS1 range (0x800 clock cycles)
+    // away from it. Stay clear of that range to not lose any hits of the event.
+    auto target = (time - m_detector->timeOffset() - m_time_offset) / m_clockCycle - 0x800;
+
+    auto checkpoint = index_->find(target);
+    if(checkpoint == nullptr) {
+        return;
+    }
+
+    // Only ever jump forward, all skipped hits are before the requested time
+    auto offset = static_cast<size_t>(checkpoint->offset / sizeof(uint32_t));
+    if(offset <= position_) {
+        return;
+    }
+
+    LOG(DEBUG) << "Jumping from word " << position_ << " to checkpoint at word " << offset;
+    position_ = offset;
+    state_ = unpack_state(checkpoint->state);
+}
+
+bool EventLoaderATLASpix::decode_timestamp(uint32_t datain, DecoderState& state) const {
+
+    // Decode the message content according to 8 MSBits
+    unsigned int message_type = (datain >> 24);
+    if(message_type == 0b01000000) {
+        uint64_t atp_ts = (datain >> 7) & 0x1FFFE;
+        long long ts_diff = static_cast<long long>(atp_ts) - static_cast<long long>(state.fpga_ts & 0x1FFFF);
+
+        if(ts_diff > 0) {
+            if(ts_diff > 0x10000) {
+                ts_diff -= 0x20000;
+            }
+        } else {
+            if(ts_diff < -0x1000) {
+                ts_diff += 0x20000;
+            }
+        }
+        state.readout_ts = static_cast<unsigned long long>(static_cast<long long>(state.fpga_ts) + ts_diff);
+    } else if(message_type == 0b00110000) {
+        // Trigger counter from FPGA [31:24] and timestamp from FPGA [63:48] (2/4)
+        state.fpga_ts1 = ((static_cast<unsigned long long>(datain) << 48) & 0xFFFF000000000000);
+        state.new_ts1 = true;
+    } else if(message_type == 0b00100000) {
+
+        // Timestamp from FPGA [47:24] (3/4)
+        uint64_t fpga_tsx = ((static_cast<unsigned long long>(datain) << 24) & 0x0000FFFFFF000000);
+        if((!state.new_ts1) && (fpga_tsx < state.fpga_ts2)) {
+            state.fpga_ts1 += 0x0001000000000000;
+            LOG(DEBUG) << "Missing TS_FPGA_1, adding one";
+        }
+        state.new_ts1 = false;
+        state.new_ts2 = true;
+        state.fpga_ts2 = fpga_tsx;
+    } else if(message_type == 0b01100000) {
+
+        // Timestamp from FPGA [23:0] (4/4)
+        uint64_t fpga_tsx = ((datain) & 0xFFFFFF);
+        if((!state.new_ts2) && (fpga_tsx < state.fpga_ts3)) {
+            state.fpga_ts2 += 0x0000000001000000;
+            LOG(DEBUG) << "Missing TS_FPGA_2, adding one";
+        }
+        state.new_ts2 = false;
+        state.fpga_ts3 = fpga_tsx;
+        state.fpga_ts = state.fpga_ts1 | state.fpga_ts2 | state.fpga_ts3;
+    } else if(message_type == 0b01110000) {
+        // T0 received
+        state.new_ts1 = false;
+        state.new_ts2 = false;
+        state.fpga_ts = 0;
+        state.fpga_ts1 = 0;
+        state.fpga_ts2 = 0;
+        state.fpga_ts3 = 0;
+        state.t0_seen++;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool EventLoaderATLASpix::read_caribou_data() { // return false when reaching eof
+
+    // Read next 4-byte data word from the mapped file
+    if(position_ >= n_words_) {
         LOG(TRACE) << "EOF...";
         eof_reached = true;
         return false;
     }
+    uint32_t datain = words_[position_++];
 
     // Check if current word is a pixel data:
     if(datain & 0x80000000) {
         // Do not return and decode pixel data before T0 arrived
-        if(t0_seen_ == 0) {
+        if(state_.t0_seen == 0) {
             return true;
-        } else if(t0_seen_ > 1) {
+        } else if(state_.t0_seen > 1) {
             LOG(ERROR) << "Detected 2nd T0 signal. Finish the reconstruction and throw this event away!";
             eof_reached = true;
             return false;
@@ -344,7 +541,7 @@ bool EventLoaderATLASpix::read_caribou_data() { // return false when reaching eo
         int col = ((datain >> (6 + 10 + 9)) & 0x003F);
         // long tot = 0;
 
-        long long ts_diff = ts1 - static_cast<long long>(readout_ts_ & 0x07FF);
+        long long ts_diff = ts1 - static_cast<long long>(state_.readout_ts & 0x07FF);
 
         if(ts_diff > 0) {
             // Hit probably came before readout started and meanwhile an OVF of TS1 happened
@@ -358,7 +555,7 @@ bool EventLoaderATLASpix::read_caribou_data() { // return false when reaching eo
             }
         }
 
-        long long hit_ts = static_cast<long long>(readout_ts_) + ts_diff;
+        long long hit_ts = static_cast<long long>(state_.readout_ts) + ts_diff;
 
         // Convert the timestamp to nanoseconds:
         double timestamp = m_clockCycle * static_cast<double>(hit_ts) + m_detector->timeOffset();
@@ -438,61 +635,17 @@ bool EventLoaderATLASpix::read_caribou_data() { // return false when reaching eo
         // Decode the message content according to 8 MSBits
         unsigned int message_type = (datain >> 24);
         LOG(TRACE) << "Message type " << std::hex << message_type << std::dec;
-        if(message_type == 0b01000000) {
-            uint64_t atp_ts = (datain >> 7) & 0x1FFFE;
-            long long ts_diff = static_cast<long long>(atp_ts) - static_cast<long long>(fpga_ts_ & 0x1FFFF);
-
-            if(ts_diff > 0) {
-                if(ts_diff > 0x10000) {
-                    ts_diff -= 0x20000;
-                }
-            } else {
-                if(ts_diff < -0x1000) {
-                    ts_diff += 0x20000;
-                }
+        if(decode_timestamp(datain, state_)) {
+            // Timestamp and T0 messages update the decoder state
+            if(message_type == 0b01000000) {
+                LOG(DEBUG) << "RO_ts " << std::hex << state_.readout_ts << std::dec;
+            } else if(message_type == 0b01110000) {
+                LOG(DEBUG) << "T0 event was found in the data";
             }
-            readout_ts_ = static_cast<unsigned long long>(static_cast<long long>(fpga_ts_) + ts_diff);
-            LOG(DEBUG) << "RO_ts " << std::hex << readout_ts_ << " atp_ts " << atp_ts << std::dec;
         } else if(message_type == 0b00010000) {
             // Trigger counter from FPGA [23:0] (1/4)
-        } else if(message_type == 0b00110000) {
-            // Trigger counter from FPGA [31:24] and timestamp from FPGA [63:48] (2/4)
-            fpga_ts1_ = ((static_cast<unsigned long long>(datain) << 48) & 0xFFFF000000000000);
-            new_ts1_ = true;
-        } else if(message_type == 0b00100000) {
-
-            // Timestamp from FPGA [47:24] (3/4)
-            uint64_t fpga_tsx = ((static_cast<unsigned long long>(datain) << 24) & 0x0000FFFFFF000000);
-            if((!new_ts1_) && (fpga_tsx < fpga_ts2_)) {
-                fpga_ts1_ += 0x0001000000000000;
-                LOG(DEBUG) << "Missing TS_FPGA_1, adding one";
-            }
-            new_ts1_ = false;
-            new_ts2_ = true;
-            fpga_ts2_ = fpga_tsx;
-        } else if(message_type == 0b01100000) {
-
-            // Timestamp from FPGA [23:0] (4/4)
-            uint64_t fpga_tsx = ((datain) & 0xFFFFFF);
-            if((!new_ts2_) && (fpga_tsx < fpga_ts3_)) {
-                fpga_ts2_ += 0x0000000001000000;
-                LOG(DEBUG) << "Missing TS_FPGA_2, adding one";
-            }
-            new_ts2_ = false;
-            fpga_ts3_ = fpga_tsx;
-            fpga_ts_ = fpga_ts1_ | fpga_ts2_ | fpga_ts3_;
         } else if(message_type == 0b00000010) {
             // BUSY was asserted due to FIFO_FULL + 24 LSBs of FPGA timestamp when it happened
-        } else if(message_type == 0b01110000) {
-            // T0 received
-            LOG(DEBUG) << "T0 event was found in the data";
-            new_ts1_ = false;
-            new_ts2_ = false;
-            fpga_ts_ = 0;
-            fpga_ts1_ = 0;
-            fpga_ts2_ = 0;
-            fpga_ts3_ = 0;
-            t0_seen_++;
         } else if(message_type == 0b00000000) {
 
             // Empty data - should not happen
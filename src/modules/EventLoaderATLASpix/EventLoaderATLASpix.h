@@ -23,7 +23,9 @@
 #include <sstream>
 #include <stdio.h>
 #include <string.h>
+#include <vector>
 #include "core/module/Module.hpp"
+#include "core/utils/SeekIndex.hpp"
 #include "objects/Cluster.hpp"
 #include "objects/Pixel.hpp"
 #include "objects/Track.hpp"
@@ -36,13 +38,27 @@ namespace corryvreckan {
     public:
         // Constructors and destructors
         EventLoaderATLASpix(Configuration& config, std::shared_ptr<Detector> detector);
-        ~EventLoaderATLASpix() {}
+        ~EventLoaderATLASpix();
 
         // Functions
         void initialize() override;
         StatusCode run(const std::shared_ptr<Clipboard>& clipboard) override;
 
     private:
+        /*
+         * @brief State of the timestamp decoding, required to resume decoding at any position in the file
+         */
+        struct DecoderState {
+            unsigned long long readout_ts = 0;
+            unsigned long long fpga_ts = 0;
+            unsigned long long fpga_ts1 = 0;
+            unsigned long long fpga_ts2 = 0;
+            unsigned long long fpga_ts3 = 0;
+            bool new_ts1 = false;
+            bool new_ts2 = false;
+            size_t t0_seen = 0;
+        };
+
         /*
          * @brief Converts gray encoded data to binary number
          */
@@ -54,6 +70,37 @@ namespace corryvreckan {
          */
         bool read_caribou_data();
 
+        /*
+         * @brief Update the decoder state with a non-pixel data word
+         * @param datain Data word to decode
+         * @param state Decoder state to be updated
+         * @return Bool which is true if the word was a timestamp or T0 message, false for all other messages
+         */
+        bool decode_timestamp(uint32_t datain, DecoderState& state) const;
+
+        /*
+         * @brief Memory-map the data file
+         */
+        void map_file();
+
+        /*
+         * @brief Load the cached index of the data file or scan the full file once and store checkpoints of the decoder
+         * state in regular intervals
+         */
+        void build_index();
+
+        /*
+         * @brief Conversion between the decoder state and the state words stored in the index
+         */
+        static std::vector<uint64_t> pack_state(const DecoderState& state);
+        static DecoderState unpack_state(const std::vector<uint64_t>& words);
+
+        /*
+         * @brief Jump forward to the last checkpoint which is safely before the given time
+         * @param time Start time of the current event
+         */
+        void seek(double time);
+
         // custom comparator for time-sorted priority_queue
         struct CompareTimeGreater {
             bool operator()(const std::shared_ptr<Pixel> a, const std::shared_ptr<Pixel> b) {
@@ -65,17 +112,20 @@ namespace corryvreckan {
 
         std::shared_ptr<Detector> m_detector;
         std::string m_filename;
-        std::ifstream m_file;
+
+        // Memory-mapped data file, read in 4-byte words
+        int file_descriptor_{-1};
+        void* mapped_data_{nullptr};
+        size_t mapped_size_{0};
+        const uint32_t* words_{nullptr};
+        size_t n_words_{0};
+        size_t position_{0};
+
+        // Sparse index of checkpoints, in readout timestamp clock cycles
+        std::unique_ptr<SeekIndex> index_;
 
         // Resuming in next event:
-        unsigned long long readout_ts_ = 0;
-        unsigned long long fpga_ts_ = 0;
-        unsigned long long fpga_ts1_ = 0;
-        unsigned long long fpga_ts2_ = 0;
-        unsigned long long fpga_ts3_ = 0;
-        bool new_ts1_ = false;
-        bool new_ts2_ = false;
-        size_t t0_seen_ = 0;
+        DecoderState state_;
         bool eof_reached = false;
 
         // int ts1Range;
@@ -123,6 +173,8 @@ namespace corryvreckan {
         int m_clkdivend2M;
         int m_buffer_depth;
         double m_time_offset;
+        bool m_buildIndex;
+        size_t m_indexSpacing;
     };
 } // namespace corryvreckan
 #endif // EventLoaderATLASpix_H
@@ -11,19 +11,29 @@
 
 #include "EventLoaderHDF5.h"
 
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+
 namespace corryvreckan {
 
+    namespace {
+        // The HDF5 library is not guaranteed to be thread-safe, serialize all reads of all module instances
+        std::mutex hdf5_mutex;
+    } // namespace
+
+    void EventLoaderHDF5::HitBuffer::clear() {
+        column.clear();
+        row.clear();
+        raw.clear();
+        charge.clear();
+        timestamp.clear();
+        trigger_number.clear();
+        sorted = true;
+    }
+
     EventLoaderHDF5::EventLoaderHDF5(Configuration& config, std::shared_ptr<Detector> detector)
-        : Module(config, detector), m_detector(detector),
-          m_buffer([sort_trg = config.get<bool>("sync_by_trigger", false)](const auto a, const auto b) noexcept {
-              // Sort buffer by timestamp to make sure to read them in chronological order.
-              // If timestamps are not available, sort by trigger number. If that fails, good luck
-              if(!sort_trg && (a->timestamp > 0) && (b->timestamp > 0)) {
-                  return a->timestamp > b->timestamp;
-              } else {
-                  return a->trigger_number > b->trigger_number;
-              }
-          }) {
+        : Module(config, detector), m_detector(detector) {
         h5_datatype.insertMember("column", HOFFSET(Hit, column), H5::PredType::STD_U16LE);
         h5_datatype.insertMember("row", HOFFSET(Hit, row), H5::PredType::STD_U16LE);
         h5_datatype.insertMember("raw", HOFFSET(Hit, raw), H5::PredType::STD_U8LE);
@@ -38,11 +48,20 @@ namespace corryvreckan {
         m_eventLength = config.get<double>("event_length", Units::get<double>(1.0, "us"));
         m_timestampShift = config.get<double>("timestamp_shift", 0);
         m_triggerShift = config.get<uint32_t>("trigger_shift", 0);
+        m_prefetch = config.get<bool>("prefetch", true);
+    }
+
+    EventLoaderHDF5::~EventLoaderHDF5() {
+        // Make sure no background read accesses this module anymore
+        if(m_pending.valid()) {
+            m_pending.wait();
+        }
     }
 
     void EventLoaderHDF5::initialize() {
         // Open the file
         try {
+            std::lock_guard<std::mutex> lock(hdf5_mutex);
             m_file = H5::H5File(m_fileName, H5F_ACC_RDONLY);
             m_dataset = m_file.openDataSet(m_datasetName);
         } catch(const std::exception& ex) {
@@ -91,9 +110,11 @@ namespace corryvreckan {
 
         m_start_record = 0;
 
-        f_dataspace = m_dataset.getSpace();
-        f_total_records = static_cast<hsize_t>(f_dataspace.getSimpleExtentNpoints());
+        f_total_records = static_cast<hsize_t>(m_dataset.getSpace().getSimpleExtentNpoints());
         LOG(DEBUG) << "Total number of records " << f_total_records;
+
+        // Start reading the first chunk
+        requestChunk();
     }
 
     StatusCode EventLoaderHDF5::run(const std::shared_ptr<Clipboard>& clipboard) {
@@ -113,7 +134,7 @@ namespace corryvreckan {
         }
 
         LOG(DEBUG) << clipboard->countObjects<Pixel>() << " objects on the clipboard";
-        if(m_buffer.empty() && (m_start_record == f_total_records)) {
+        if(bufferEmpty() && !m_pending.valid() && (m_start_record == f_total_records)) {
             return StatusCode::EndRun;
         }
 
@@ -121,16 +142,18 @@ namespace corryvreckan {
     }
 
     bool EventLoaderHDF5::loadData(const std::shared_ptr<Clipboard>& clipboard, PixelVector& deviceData_) {
-        // Ensure that m_buffer is filled with data
+        // Ensure that the current chunk holds data
         fillBuffer();
 
         std::string detectorID = m_detector->getName();
 
-        while(!m_buffer.empty()) {
-            auto hit = m_buffer.top();
+        while(!bufferEmpty()) {
+            const auto index = m_position;
+            const int column = m_current.column[index];
+            const int row = m_current.row[index];
 
-            double shiftedTimestamp = static_cast<double>(hit->timestamp) + m_timestampShift;
-            uint32_t shiftedTriggerId = hit->trigger_number + m_triggerShift;
+            double shiftedTimestamp = m_current.timestamp[index] + m_timestampShift;
+            uint32_t shiftedTriggerId = m_current.trigger_number[index] + m_triggerShift;
 
             // Check if an event is defined or if we need to create it:
             if(!clipboard->isEventDefined()) {
@@ -156,7 +179,7 @@ namespace corryvreckan {
             }
 
             auto event = clipboard->getEvent();
-            Event::Position position = getPosition(event, hit);
+            Event::Position position = getPosition(event, shiftedTimestamp, shiftedTriggerId);
 
             if(position == Event::Position::AFTER) {
                 LOG(DEBUG) << "Stopping processing event, pixel is after event window ("
@@ -167,12 +190,12 @@ namespace corryvreckan {
                 LOG(TRACE) << "Skipping pixel, is before event window ("
                            << Units::display(shiftedTimestamp, {"s", "us", "ns"}) << " < "
                            << Units::display(event->start(), {"s", "us", "ns"}) << ")";
-                m_buffer.pop();
+                m_position++;
             } else {
                 LOG(DEBUG) << "Position is DURING";
                 if(!m_detector->isAuxiliary()) {
                     double pixel_timestamp;
-                    LOG(DEBUG) << "Loaded pixel (" << hit->column << ", " << hit->row << ")";
+                    LOG(DEBUG) << "Loaded pixel (" << column << ", " << row << ")";
                     if(m_sync_by_trigger) {
                         pixel_timestamp =
                             event->getTriggerTime(shiftedTriggerId) + m_timestampShift; // Use trigger time as pixel time
@@ -180,23 +203,24 @@ namespace corryvreckan {
                         pixel_timestamp = shiftedTimestamp;
                     }
 
-                    if(m_detector->masked(hit->column, hit->row)) {
-                        LOG(TRACE) << "Masking pixel (col, row) = (" << hit->column << ", " << hit->row << ")";
-                        m_buffer.pop();
+                    if(m_detector->masked(column, row)) {
+                        LOG(TRACE) << "Masking pixel (col, row) = (" << column << ", " << row << ")";
+                        m_position++;
+                        fillBuffer();
                         continue;
                     } else {
-                        LOG(TRACE) << "Storing (col, row, timestamp) = (" << hit->column << ", " << hit->row << ", "
+                        LOG(TRACE) << "Storing (col, row, timestamp) = (" << column << ", " << row << ", "
                                    << Units::display(pixel_timestamp, {"ns", "us", "ms"}) << ") from HDF5 event data";
                     }
                     auto pixel = std::make_shared<Pixel>(
-                        m_detector->getName(), hit->column, hit->row, hit->raw, hit->charge, pixel_timestamp);
+                        detectorID, column, row, m_current.raw[index], m_current.charge[index], pixel_timestamp);
                     deviceData_.push_back(pixel);
                     hHitMap->Fill(pixel->column(), pixel->row());
                     hTotMap->Fill(pixel->column(), pixel->row(), pixel->raw());
                     hPixelToT->Fill(pixel->raw());
                     hPixelCharge->Fill(pixel->charge());
                 }
-                m_buffer.pop();
+                m_position++;
             }
             // Refill buffer for next iteration
             fillBuffer();
@@ -209,37 +233,88 @@ namespace corryvreckan {
         return true;
     }
 
-    std::vector<EventLoaderHDF5::Hit> EventLoaderHDF5::readChunk() {
-        hsize_t num_records_to_read = std::min(m_bufferDepth, f_total_records - m_start_record);
-        H5::DataSpace mem_space = H5::DataSpace(1, &num_records_to_read);
-        std::vector<EventLoaderHDF5::Hit> chunk(num_records_to_read);
+    void EventLoaderHDF5::readChunk(hsize_t first, hsize_t count, HitBuffer& chunk) {
+        m_records.resize(count);
+        {
+            std::lock_guard<std::mutex> lock(hdf5_mutex);
+
+            // Select memory space within the file to read
+            H5::DataSpace mem_space = H5::DataSpace(1, &count);
+            H5::DataSpace file_space = m_dataset.getSpace();
+            file_space.selectHyperslab(H5S_SELECT_SET, &count, &first, nullptr, nullptr);
+            m_dataset.read(m_records.data(), h5_datatype, mem_space, file_space);
+        }
+
+        // Sort chunk by timestamp to make sure to read them in chronological order.
+        // If timestamps are not available, sort by trigger number. If that fails, good luck
+        const bool by_trigger = m_sync_by_trigger || std::any_of(m_records.begin(), m_records.end(), [](const Hit& hit) {
+                                    return hit.timestamp <= 0;
+                                });
+        const auto earlier = [by_trigger](const Hit& a, const Hit& b) {
+            return by_trigger ? a.trigger_number < b.trigger_number : a.timestamp < b.timestamp;
+        };
+
+        // Data files are usually written in chronological order already, only sort if required
+        std::vector<size_t> order;
+        chunk.sorted = std::is_sorted(m_records.begin(), m_records.end(), earlier);
+        if(!chunk.sorted) {
+            order.resize(m_records.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(
+                order.begin(), order.end(), [&](size_t a, size_t b) { return earlier(m_records[a], m_records[b]); });
+        }
+
+        chunk.column.resize(count);
+        chunk.row.resize(count);
+        chunk.raw.resize(count);
+        chunk.charge.resize(count);
+        chunk.timestamp.resize(count);
+        chunk.trigger_number.resize(count);
+        for(size_t i = 0; i < count; i++) {
+            const auto& hit = m_records[chunk.sorted ? i : order[i]];
+            chunk.column[i] = hit.column;
+            chunk.row[i] = hit.row;
+            chunk.raw[i] = hit.raw;
+            chunk.charge[i] = hit.charge;
+            chunk.timestamp[i] = hit.timestamp;
+            chunk.trigger_number[i] = hit.trigger_number;
+        }
+    }
+
+    void EventLoaderHDF5::requestChunk() {
+        if(m_start_record == f_total_records) {
+            return;
+        }
 
-        // Select memory space within the file to read
-        f_dataspace.selectHyperslab(H5S_SELECT_SET, &num_records_to_read, &m_start_record, nullptr, nullptr);
-        m_dataset.read(chunk.data(), h5_datatype, mem_space, f_dataspace);
-        m_start_record += num_records_to_read;
+        hsize_t first = m_start_record;
+        hsize_t count = std::min(m_bufferDepth, f_total_records - m_start_record);
+        m_start_record += count;
 
-        return chunk;
+        if(m_prefetch) {
+            // Read the next chunk in the background while the current one is consumed
+            m_pending = std::async(std::launch::async, [this, first, count]() { readChunk(first, count, m_next); });
+        } else {
+            m_pending = std::async(std::launch::deferred, [this, first, count]() { readChunk(first, count, m_next); });
+        }
     }
 
     void EventLoaderHDF5::fillBuffer() {
-        // Fill buffer only if it is empty and there are records left in the file
-        if(m_buffer.empty() && (m_start_record != f_total_records)) {
-            std::vector<Hit> chunk = readChunk();
-
-            // Add the elements of chunk to the buffer
-            for(auto hit : chunk) {
-                m_buffer.push(std::make_shared<EventLoaderHDF5::Hit>(hit));
-            }
+        // Switch to the next chunk only if the current one is consumed and there are records left in the file
+        if(bufferEmpty() && m_pending.valid()) {
+            m_pending.get();
+            std::swap(m_current, m_next);
+            m_next.clear();
+            m_position = 0;
+            LOG(DEBUG) << "Loaded chunk of " << m_current.size() << " records"
+                       << (m_current.sorted ? "" : ", records were not in chronological order and have been sorted");
+
+            requestChunk();
         }
     }
 
     Event::Position EventLoaderHDF5::getPosition(const std::shared_ptr<Event>& event,
-                                                 const std::shared_ptr<Hit>& hit) const {
-
-        uint32_t shiftedTriggerId = hit->trigger_number + m_triggerShift;
-        double shiftedTimestamp = static_cast<double>(hit->timestamp) + m_timestampShift;
-
+                                                 double shiftedTimestamp,
+                                                 uint32_t shiftedTriggerId) const {
         if(m_sync_by_trigger) {
             const auto trigger_position = event->getTriggerPosition(shiftedTriggerId);
             LOG(DEBUG) << "Corryvreckan event with trigger id " << shiftedTriggerId << " has trigger time at "
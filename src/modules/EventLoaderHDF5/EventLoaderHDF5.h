@@ -17,7 +17,8 @@
 #include <TH2F.h>
 #include <TProfile2D.h>
 
-#include <queue>
+#include <future>
+#include <vector>
 #include "core/module/Module.hpp"
 #include "objects/Pixel.hpp"
 
@@ -28,7 +29,7 @@ namespace corryvreckan {
     public:
         // Constructors and destructors
         EventLoaderHDF5(Configuration& config, std::shared_ptr<Detector> detector);
-        ~EventLoaderHDF5() {}
+        ~EventLoaderHDF5();
 
         // Standard algorithm functions
         void initialize() override;
@@ -44,7 +45,22 @@ namespace corryvreckan {
             uint32_t trigger_number;
         };
 
-        using HitVector = std::vector<std::shared_ptr<Hit>>;
+        /**
+         * @brief Hits of one chunk in time order, stored as structure of arrays
+         */
+        struct HitBuffer {
+            std::vector<int> column;
+            std::vector<int> row;
+            std::vector<int> raw;
+            std::vector<double> charge;
+            std::vector<double> timestamp;
+            std::vector<uint32_t> trigger_number;
+            // Whether the records were already stored in chronological order in the file
+            bool sorted{true};
+
+            size_t size() const { return column.size(); }
+            void clear();
+        };
 
         H5::CompType h5_datatype{sizeof(Hit)};
 
@@ -57,12 +73,21 @@ namespace corryvreckan {
         double m_timestampShift;
         uint32_t m_triggerShift;
 
+        bool m_prefetch;
+
         H5::DataSet m_dataset;
         H5::H5File m_file;
-        H5::DataSpace f_dataspace;
         hsize_t f_total_records;
         hsize_t m_start_record;
 
+        // Chunk currently consumed, position of the next hit in it, and chunk read in the background
+        HitBuffer m_current;
+        size_t m_position{};
+        HitBuffer m_next;
+        std::future<void> m_pending;
+        // Staging area for the compound records of the chunk being read
+        std::vector<Hit> m_records;
+
         // Plots
         TH2F* hHitMap;
         TProfile2D* hTotMap;
@@ -75,13 +100,13 @@ namespace corryvreckan {
         TH1D* hClipboardEventDuration;
 
         // Additional helper function
-        std::vector<Hit> readChunk();
+        void readChunk(hsize_t first, hsize_t count, HitBuffer& chunk);
+        void requestChunk();
         bool loadData(const std::shared_ptr<Clipboard>& clipboard, PixelVector&);
         void fillBuffer();
-        Event::Position getPosition(const std::shared_ptr<Event>& event, const std::shared_ptr<Hit>& hit) const;
-
-        std::priority_queue<std::shared_ptr<Hit>, HitVector, std::function<bool(std::shared_ptr<Hit>, std::shared_ptr<Hit>)>>
-            m_buffer;
+        bool bufferEmpty() const { return m_position == m_current.size(); }
+        Event::Position
+        getPosition(const std::shared_ptr<Event>& event, double shiftedTimestamp, uint32_t shiftedTriggerId) const;
     };
 
 } // namespace corryvreckan
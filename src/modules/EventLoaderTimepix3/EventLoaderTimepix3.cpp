@@ -11,6 +11,7 @@
 
 #include "EventLoaderTimepix3.h"
 
+#include <algorithm>
 #include <bitset>
 #include <cmath>
 #include <dirent.h>
@@ -28,7 +29,13 @@ EventLoaderTimepix3::EventLoaderTimepix3(Configuration& config, std::shared_ptr<
     : Module(config, detector), m_detector(detector), m_currentEvent(0), m_prevTime(0), m_shutterOpen(false) {
 
     config_.setDefault<size_t>("buffer_depth", 1000);
+    config_.setDefault<bool>("build_index", false);
+    config_.setDefault<size_t>("index_spacing", 65536);
+    config_.setDefault<double>("seek_margin", Units::get<double>(10, "ms"));
     m_buffer_depth = config_.get<size_t>("buffer_depth");
+    m_buildIndex = config_.get<bool>("build_index");
+    m_indexSpacing = config_.get<size_t>("index_spacing");
+    m_seekMargin = config_.get<double>("seek_margin");
 
     // Take input directory from global parameters
     m_inputDirectory = config_.getPath("input_directory");
@@ -159,6 +166,8 @@ void EventLoaderTimepix3::initialize() {
 
             // Store the file in the data vector:
             m_files.push_back(std::move(new_file));
+            m_filenames.push_back(filename);
+            m_dataOffsets.push_back(headerSize);
         } else {
             throw ModuleError("Could not open data file " + filename);
         }
@@ -167,6 +176,18 @@ void EventLoaderTimepix3::initialize() {
     // Set the file iterator to the first file for every detector:
     m_file_iterator = m_files.begin();
 
+    if(m_buildIndex) {
+        if(m_indexSpacing < 1) {
+            throw InvalidValueError(config_, "index_spacing", "Index spacing must be larger than 0.");
+        }
+        SeekIndexSet::Decoder decoder;
+        decoder.pack = [this]() { return packState(); };
+        decoder.unpack = [this](const std::vector<uint64_t>& state) { unpackState(state); };
+        decoder.scan = [this](uint64_t word, double& time) { return indexWord(word, time); };
+        m_index = std::make_unique<SeekIndexSet>(m_filenames, m_dataOffsets, "Timepix3-SPIDR/1", 7, std::move(decoder));
+        m_index->build(m_indexSpacing);
+    }
+
     // Trigger time
     hTriggerTime = new TH1F("triggerTime", "triggerTime", 100, -0.5, 1e12);
 
@@ -252,6 +273,13 @@ StatusCode EventLoaderTimepix3::run(const std::shared_ptr<Clipboard>& clipboard)
         return StatusCode::Failure;
     }
 
+    // Skip data which cannot contribute to this event
+    if(m_index) {
+        // Pixel data can arrive out of order with respect to the heartbeat, stay clear by the configured margin
+        auto target = (event->start() - m_detector->timeOffset() - m_seekMargin) * (4096. / 25.);
+        m_index->seek(m_files, m_file_iterator, target);
+    }
+
     // Make a new container for the data
     PixelVector deviceData;
     TimerSignalVector spidrData;
@@ -373,40 +401,9 @@ bool EventLoaderTimepix3::decodeNextWord() {
     const UChar_t header = static_cast<UChar_t>((pixdata & 0xF000000000000000) >> 60) & 0xF;
 
     // Use header 0x4 to get the long timestamps (called syncTime here)
-    if(header == 0x4) {
-        LOG(TRACE) << "Found syncTime data";
-
-        // The 0x4 header tells us that it is part of the timestamp
-        // There is a second 4-bit header that says if it is the most
-        // or least significant part of the timestamp
-        const UChar_t header2 = ((pixdata & 0x0F00000000000000) >> 56) & 0xF;
-
-        // This is a bug fix. There appear to be errant packets with garbage data
-        // - source to be tracked down.
-        // Between the data and the header the intervening bits should all be 0,
-        // check if this is the case
-        const UChar_t intermediateBits = ((pixdata & 0x00FF000000000000) >> 48) & 0xFF;
-        if(intermediateBits != 0x00) {
-            LOG(DEBUG) << "Detector " << detectorID << ": intermediateBits error";
-            return true;
-        }
-
-        // 0x4 is the least significant part of the timestamp
-        if(header2 == 0x4) {
-            // The data is shifted 16 bits to the right, then 12 to the left in
-            // order to match the timestamp format (net 4 right)
-            m_syncTime = (m_syncTime & 0xFFFFF00000000000) + ((pixdata & 0x0000FFFFFFFF0000) >> 4);
-        }
-        // 0x5 is the most significant part of the timestamp
-        if(header2 == 0x5) {
-            // The data is shifted 16 bits to the right, then 44 to the left in
-            // order to match the timestamp format (net 28 left)
-            m_syncTime = (m_syncTime & 0x00000FFFFFFFFFFF) + ((pixdata & 0x00000000FFFF0000) << 28);
-            if(!m_clearedHeader && static_cast<double>(m_syncTime) / (4096. * 40000000.) < 6.) {
-                m_clearedHeader = true;
-                LOG(DEBUG) << detectorID << ": Cleared header";
-            }
-        }
+    if(header == 0x4 && !decodeHeartbeat(pixdata)) {
+        LOG(DEBUG) << "Detector " << detectorID << ": intermediateBits error";
+        return true;
     }
 
     // In data taking during 2015 there was sometimes still data left in the buffers at the start of
@@ -476,37 +473,11 @@ bool EventLoaderTimepix3::decodeNextWord() {
 
     // Header 0x6 indicate trigger data
     if(header == 0x6) {
-        const UChar_t header2 = ((pixdata & 0x0F00000000000000) >> 56) & 0xF;
-        if(header2 == 0xF) {
-            unsigned int stamp = (pixdata & 0x1E0) >> 5;
-            long long int timestamp_raw = static_cast<long long int>(pixdata & 0xFFFFFFFFE00) >> 9;
-            long long int timestamp = 0;
-            int triggerNumber = ((pixdata & 0xFFF00000000000) >> 44);
-
-            int intermediate = (pixdata & 0x1F);
-            if(intermediate != 0) {
-                return true;
-            }
-
-            if(triggerNumber < m_prevTriggerNumber) {
-                m_triggerOverflowCounter++;
-            }
-
-            // if jump back in time is larger than 1 sec, overflow detected...
-            if((m_syncTimeTDC - timestamp_raw) > 0x1312d000) {
-                m_TDCoverflowCounter++;
-            }
-
-            timestamp = timestamp_raw + (static_cast<long long int>(m_TDCoverflowCounter) << 35);
-
-            double triggerTime =
-                (static_cast<double>(timestamp) + static_cast<double>(stamp) / 12) / (8. * 0.04); // 320 MHz clock
+        double triggerTime;
+        uint32_t triggerID;
+        if(decodeTrigger(pixdata, triggerTime, triggerID)) {
             hTriggerTime->Fill(triggerTime);
             LOG(TRACE) << "Trigger time value of: " << triggerTime;
-            m_syncTimeTDC = timestamp_raw;
-
-            auto triggerID = static_cast<uint32_t>(triggerNumber + (m_triggerOverflowCounter << 12));
-            m_prevTriggerNumber = triggerNumber;
 
             auto triggerSignal = std::make_shared<TimerSignal>(detectorID, triggerTime, TimerType::TRIGGER);
             triggerSignal->setTriggerID(triggerID);
@@ -619,6 +590,124 @@ bool EventLoaderTimepix3::decodeNextWord() {
     return true;
 }
 
+bool EventLoaderTimepix3::decodeHeartbeat(ULong64_t pixdata) {
+
+    // The 0x4 header tells us that it is part of the timestamp
+    // There is a second 4-bit header that says if it is the most
+    // or least significant part of the timestamp
+    const UChar_t header2 = ((pixdata & 0x0F00000000000000) >> 56) & 0xF;
+
+    // This is a bug fix. There appear to be errant packets with garbage data
+    // - source to be tracked down.
+    // Between the data and the header the intervening bits should all be 0,
+    // check if this is the case
+    const UChar_t intermediateBits = ((pixdata & 0x00FF000000000000) >> 48) & 0xFF;
+    if(intermediateBits != 0x00) {
+        return false;
+    }
+
+    // 0x4 is the least significant part of the timestamp
+    if(header2 == 0x4) {
+        // The data is shifted 16 bits to the right, then 12 to the left in
+        // order to match the timestamp format (net 4 right)
+        m_syncTime = (m_syncTime & 0xFFFFF00000000000) + ((pixdata & 0x0000FFFFFFFF0000) >> 4);
+    }
+    // 0x5 is the most significant part of the timestamp
+    if(header2 == 0x5) {
+        // The data is shifted 16 bits to the right, then 44 to the left in
+        // order to match the timestamp format (net 28 left)
+        m_syncTime = (m_syncTime & 0x00000FFFFFFFFFFF) + ((pixdata & 0x00000000FFFF0000) << 28);
+        if(!m_clearedHeader && static_cast<double>(m_syncTime) / (4096. * 40000000.) < 6.) {
+            m_clearedHeader = true;
+            LOG(DEBUG) << m_detector->getName() << ": Cleared header";
+        }
+    }
+    return true;
+}
+
+bool EventLoaderTimepix3::decodeTrigger(ULong64_t pixdata, double& triggerTime, uint32_t& triggerID) {
+    const UChar_t header2 = ((pixdata & 0x0F00000000000000) >> 56) & 0xF;
+    if(header2 != 0xF) {
+        return false;
+    }
+
+    unsigned int stamp = (pixdata & 0x1E0) >> 5;
+    long long int timestamp_raw = static_cast<long long int>(pixdata & 0xFFFFFFFFE00) >> 9;
+    long long int timestamp = 0;
+    int triggerNumber = ((pixdata & 0xFFF00000000000) >> 44);
+
+    int intermediate = (pixdata & 0x1F);
+    if(intermediate != 0) {
+        return false;
+    }
+
+    if(triggerNumber < m_prevTriggerNumber) {
+        m_triggerOverflowCounter++;
+    }
+
+    // if jump back in time is larger than 1 sec, overflow detected...
+    if((m_syncTimeTDC - timestamp_raw) > 0x1312d000) {
+        m_TDCoverflowCounter++;
+    }
+
+    timestamp = timestamp_raw + (static_cast<long long int>(m_TDCoverflowCounter) << 35);
+
+    triggerTime = (static_cast<double>(timestamp) + static_cast<double>(stamp) / 12) / (8. * 0.04); // 320 MHz clock
+    m_syncTimeTDC = timestamp_raw;
+
+    triggerID = static_cast<uint32_t>(triggerNumber + (m_triggerOverflowCounter << 12));
+    m_prevTriggerNumber = triggerNumber;
+    return true;
+}
+
+std::vector<uint64_t> EventLoaderTimepix3::packState() const {
+    return {m_syncTime,
+            static_cast<uint64_t>(m_clearedHeader),
+            static_cast<uint64_t>(m_syncTimeTDC),
+            static_cast<uint64_t>(m_TDCoverflowCounter),
+            static_cast<uint64_t>(m_prevTriggerNumber),
+            static_cast<uint64_t>(m_triggerOverflowCounter),
+            static_cast<uint64_t>(m_shutterOpen)};
+}
+
+void EventLoaderTimepix3::unpackState(const std::vector<uint64_t>& state) {
+    m_syncTime = state.at(0);
+    m_clearedHeader = (state.at(1) != 0);
+    m_syncTimeTDC = static_cast<long long int>(state.at(2));
+    m_TDCoverflowCounter = static_cast<int>(state.at(3));
+    m_prevTriggerNumber = static_cast<int>(state.at(4));
+    m_triggerOverflowCounter = static_cast<int>(state.at(5));
+    m_shutterOpen = (state.at(6) != 0);
+}
+
+bool EventLoaderTimepix3::indexWord(uint64_t pixdata, double& time) {
+    const UChar_t header = static_cast<UChar_t>((pixdata & 0xF000000000000000) >> 60) & 0xF;
+    const UChar_t header2 = ((pixdata & 0x0F00000000000000) >> 56) & 0xF;
+
+    if(header == 0x4) {
+        // Only place checkpoints after the most significant part of the heartbeat, where the syncTime is consistent
+        if(decodeHeartbeat(pixdata) && header2 == 0x5 && m_clearedHeader) {
+            time = static_cast<double>(m_syncTime);
+            return true;
+        }
+        return false;
+    }
+    if(!m_clearedHeader) {
+        return false;
+    }
+
+    if(header == 0x0 && header2 == 0x6 && m_detector->isDUT()) {
+        // Power pulsing shutter state
+        const uint64_t shutterClosed = ((pixdata & 0x00F0000000000000) >> 52) & 0x1;
+        m_shutterOpen = (shutterClosed == 0);
+    } else if(header == 0x6) {
+        double triggerTime;
+        uint32_t triggerID;
+        decodeTrigger(pixdata, triggerTime, triggerID);
+    }
+    return false;
+}
+
 void EventLoaderTimepix3::fillBuffer() {
     // read data from file and fill timesorted buffer
     while(sorted_pixels_.size() < m_buffer_depth && !eof_reached) {
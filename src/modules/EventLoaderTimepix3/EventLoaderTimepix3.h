@@ -18,6 +18,7 @@
 #include <queue>
 #include <stdio.h>
 #include "core/module/Module.hpp"
+#include "core/utils/SeekIndex.hpp"
 #include "objects/Pixel.hpp"
 #include "objects/TimerSignal.hpp"
 
@@ -53,7 +54,14 @@ namespace corryvreckan {
         TH1F* hTriggerTime;
 
         bool decodeNextWord();
+        bool decodeHeartbeat(ULong64_t pixdata);
+        bool decodeTrigger(ULong64_t pixdata, double& triggerTime, uint32_t& triggerID);
         void fillBuffer();
+
+        // Format-specific part of the index of checkpoints for seeking to the event start
+        std::vector<uint64_t> packState() const;
+        void unpackState(const std::vector<uint64_t>& state);
+        bool indexWord(uint64_t pixdata, double& time);
         bool loadData(const std::shared_ptr<Clipboard>& clipboard, PixelVector&, TimerSignalVector&);
         void loadCalibration(std::string path, char delim, std::vector<std::vector<float>>& dat);
         void maskPixels(std::string);
@@ -68,7 +76,14 @@ namespace corryvreckan {
         std::vector<std::vector<float>> vtot;
         std::vector<std::vector<float>> vtoa;
 
+        bool m_buildIndex;
+        size_t m_indexSpacing;
+        double m_seekMargin;
+
         // Member variables
+        std::vector<std::string> m_filenames;
+        std::vector<uint64_t> m_dataOffsets;
+        std::unique_ptr<SeekIndexSet> m_index;
         std::vector<std::unique_ptr<std::ifstream>> m_files;
         std::vector<std::unique_ptr<std::ifstream>>::iterator m_file_iterator;
 
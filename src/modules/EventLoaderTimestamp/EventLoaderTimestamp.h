@@ -17,6 +17,7 @@
 #include <queue>
 
 #include "core/module/Module.hpp"
+#include "core/utils/SeekIndex.hpp"
 #include "objects/Cluster.hpp"
 #include "objects/Pixel.hpp"
 #include "objects/TimerSignal.hpp"
@@ -57,12 +58,27 @@ namespace corryvreckan {
         void fillBuffer();
 
     private:
+        bool decodeHeartbeat(ULong64_t pixdata);
+        bool decodeTrigger(ULong64_t pixdata, double& triggerTime, uint32_t& triggerID);
+
+        // Format-specific part of the index of checkpoints for seeking to the event start
+        std::vector<uint64_t> packState() const;
+        void unpackState(const std::vector<uint64_t>& state);
+        bool indexWord(uint64_t pixdata, double& time);
+
         std::shared_ptr<Detector> m_detector;
 
         // configuration parameters:
         std::string m_inputDirectory;
 
+        bool m_buildIndex;
+        size_t m_indexSpacing;
+        double m_seekMargin;
+
         // Member variables
+        std::vector<std::string> m_filenames;
+        std::vector<uint64_t> m_dataOffsets;
+        std::unique_ptr<SeekIndexSet> m_index;
         std::vector<std::unique_ptr<std::ifstream>> m_files;
         std::vector<std::unique_ptr<std::ifstream>>::iterator m_file_iterator;
 
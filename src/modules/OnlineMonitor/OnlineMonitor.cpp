@@ -11,7 +11,11 @@
 
 #include "OnlineMonitor.h"
 #include <TGButtonGroup.h>
+#include <TMemFile.h>
+#include <TObjString.h>
 #include <TVirtualPadEditor.h>
+#include <filesystem>
+#include <fstream>
 #include <regex>
 
 using namespace corryvreckan;
@@ -25,6 +29,9 @@ OnlineMonitor::OnlineMonitor(Configuration& config, std::vector<std::shared_ptr<
     config_.setDefault<bool>("ignore_aux", true);
     config_.setDefault<std::string>("clustering_module", "Clustering4D");
     config_.setDefault<std::string>("tracking_module", "Tracking4D");
+    config_.setDefault<Mode>("mode", Mode::GUI);
+    config_.setDefault<std::string>("publish_path", "/dev/shm/corryvreckan_monitor.root");
+    config_.setDefault<double>("publish_interval", Units::get<double>(1, "s"));
 
     canvasTitle = config_.get<std::string>("canvas_title");
     updateNumber = config_.get<int>("update");
@@ -32,6 +39,10 @@ OnlineMonitor::OnlineMonitor(Configuration& config, std::vector<std::shared_ptr<
     clusteringModule = config_.get<std::string>("clustering_module");
     trackingModule = config_.get<std::string>("tracking_module");
 
+    mode_ = config_.get<Mode>("mode");
+    publish_path_ = config_.get<std::string>("publish_path");
+    publish_interval_ = std::chrono::nanoseconds(static_cast<int64_t>(config_.get<double>("publish_interval")));
+
     config_.setDefaultMatrix<std::string>("overview",
                                           {{trackingModule + "/trackChi2ndof"},
                                            {clusteringModule + "/%REFERENCE%/clusterCharge"},
@@ -80,17 +91,116 @@ OnlineMonitor::OnlineMonitor(Configuration& config, std::vector<std::shared_ptr<
     canvas_time = config_.getMatrix<std::string>("event_times");
 }
 
-void OnlineMonitor::initialize() { gui_run(); }
+OnlineMonitor::~OnlineMonitor() {
+    if(writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+void OnlineMonitor::initialize() {
+    if(mode_ == Mode::PUBLISH) {
+        // Only collect the plots, the canvases are drawn by the standalone viewer
+        add_canvases();
+        LOG(STATUS) << "Publishing " << plots_.size() << " plots to " << publish_path_ << " every "
+                    << Units::display(static_cast<double>(publish_interval_.count()), {"ms", "s"});
+        eventNumber = 0;
+        last_publish_ = std::chrono::steady_clock::now();
+        return;
+    }
+
+    gui_run();
+}
 
 StatusCode OnlineMonitor::run(const std::shared_ptr<Clipboard>&) {
-    gui_update();
+    if(mode_ == Mode::PUBLISH) {
+        // Never wait for the writer: if the previous snapshot is still being written, try again with the next event
+        auto now = std::chrono::steady_clock::now();
+        if(now - last_publish_ >= publish_interval_ && !writer_busy_) {
+            publish();
+            last_publish_ = now;
+        }
+    } else {
+        gui_update();
+    }
 
     // Increase the event number
     eventNumber++;
     return StatusCode::Success;
 }
 
+void OnlineMonitor::finalize(const std::shared_ptr<ReadonlyClipboard>&) {
+    if(mode_ != Mode::PUBLISH) {
+        return;
+    }
+
+    // Publish the final state of all plots and wait for it to be written
+    if(writer_.joinable()) {
+        writer_.join();
+    }
+    publish();
+    writer_.join();
+}
+
+void OnlineMonitor::publish() {
+    // Serialize the snapshot in the calling thread, ROOT I/O is not used concurrently with the event loop
+    std::vector<char> buffer;
+    {
+        TDirectory::TContext directory_context;
+        TMemFile snapshot("snapshot.root", "RECREATE", "", 0);
+
+        // Each histogram is stored once, the layout lists group, canvas, key, style and log flag of every plot
+        std::map<TH1*, std::string> keys;
+        std::string layout;
+        for(const auto& plot : plots_) {
+            auto key = keys.find(plot.histogram);
+            if(key == keys.end()) {
+                key = keys.emplace(plot.histogram, "plot" + std::to_string(keys.size())).first;
+                snapshot.WriteTObject(plot.histogram, key->second.c_str());
+            }
+            layout += plot.group + "\t" + plot.canvas + "\t" + key->second + "\t" + plot.style + "\t" +
+                      (plot.logy ? "1" : "0") + "\n";
+        }
+        TObjString layout_string(layout.c_str());
+        snapshot.WriteTObject(&layout_string, "layout");
+        snapshot.Write();
+
+        buffer.resize(static_cast<size_t>(snapshot.GetSize()));
+        snapshot.CopyTo(buffer.data(), snapshot.GetSize());
+    }
+
+    // Hand the file content to the writer thread
+    if(writer_.joinable()) {
+        writer_.join();
+    }
+    writer_busy_ = true;
+    writer_ = std::thread([this, content = std::move(buffer)]() {
+        write_snapshot(content);
+        writer_busy_ = false;
+    });
+}
+
+void OnlineMonitor::write_snapshot(const std::vector<char>& buffer) const {
+    // Write to a temporary file first and rename it, the viewer never sees a partially written snapshot
+    auto temporary = publish_path_ + ".tmp";
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.close();
+    if(!file) {
+        LOG(WARNING) << "Could not write monitoring snapshot to " << temporary;
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, publish_path_, error);
+    if(error) {
+        LOG(WARNING) << "Could not publish monitoring snapshot to " << publish_path_ << ": " << error.message();
+    }
+}
+
 void OnlineMonitor::AddCanvasGroup(std::string group_title) {
+    if(gui == nullptr) {
+        return;
+    }
     gui->buttonGroups[group_title] = new TGVButtonGroup(gui->buttonMenu, group_title.c_str());
     gui->buttonMenu->AddFrame(gui->buttonGroups[group_title], new TGLayoutHints(kLHintsLeft | kLHintsTop, 10, 10, 10, 10));
     gui->buttonGroups[group_title]->Show();
@@ -98,6 +208,9 @@ void OnlineMonitor::AddCanvasGroup(std::string group_title) {
 
 // Need special function to get scroll bar working
 void OnlineMonitor::AddDUTGroup(uint64_t num_planes) {
+    if(gui == nullptr) {
+        return;
+    }
     std::string group_title = "DUTs";
 
     // Dynamic sizing of DUT section for less than 3 planes
@@ -129,6 +242,12 @@ void OnlineMonitor::AddCanvas(std::string canvas_title,
                               bool ignoreDut,
                               std::string detector_name) {
     std::string canvas_name = canvas_title + "Canvas";
+    canvas_titles_[canvas_name] = {canvasGroup, canvas_title};
+
+    if(gui == nullptr) {
+        AddPlots(canvas_name, canvas_plots, ignoreDut, detector_name);
+        return;
+    }
 
     if(canvasGroup.empty()) {
         gui->buttons[canvas_title] = new TGTextButton(gui->buttonMenu, canvas_title.c_str());
@@ -225,6 +344,11 @@ void OnlineMonitor::AddHisto(string canvasName, string histoName, string style,
 
     TH1* histogram = static_cast<TH1*>(gDirectory->Get(histoName.c_str()));
     if(histogram) {
+        const auto& titles = canvas_titles_[canvasName];
+        plots_.push_back({titles.first, titles.second, histogram, style, logy});
+        if(gui == nullptr) {
+            return;
+        }
         gui->histograms[canvasName].push_back(static_cast<TH1*>(gDirectory->Get(histoName.c_str())));
         gui->logarithmic[gui->histograms[canvasName].back()] = logy;
         gui->styles[gui->histograms[canvasName].back()] = style;
@@ -233,22 +357,7 @@ void OnlineMonitor::AddHisto(string canvasName, string histoName, string style,
     }
 }
 
-void OnlineMonitor::gui_run() {
-
-    // TApplication keeps the canvases persistent
-    app = new TApplication("example", nullptr, nullptr);
-
-    // Make the GUI
-    gui = new GuiDisplay(gClient->GetRoot(), 1200, 600);
-
-    // Make the main window object and set the attributes
-    gui->buttonMenu = new TGHorizontalFrame(gui, 1200, 50);
-    gui->canvas = new TRootEmbeddedCanvas("canvas", gui, 1200, 600);
-    gui->AddFrame(gui->canvas, new TGLayoutHints(kLHintsExpandX | kLHintsExpandY, 10, 10, 10, 10));
-    gui->SetCleanup(kDeepCleanup);
-    gui->DontCallClose();
-
-    // Add canvases and histograms
+void OnlineMonitor::add_canvases() {
     AddCanvasGroup("Tracking");
     AddCanvas("Overview", "Tracking", canvas_overview);
     AddCanvas("Tracking Performance", "Tracking", canvas_tracking);
@@ -273,6 +382,25 @@ void OnlineMonitor::gui_run() {
             AddCanvas(detector->getName(), "DUTs", canvas_dutplots, false, detector->getName());
         }
     }
+}
+
+void OnlineMonitor::gui_run() {
+
+    // TApplication keeps the canvases persistent
+    app = new TApplication("example", nullptr, nullptr);
+
+    // Make the GUI
+    gui = new GuiDisplay(gClient->GetRoot(), 1200, 600);
+
+    // Make the main window object and set the attributes
+    gui->buttonMenu = new TGHorizontalFrame(gui, 1200, 50);
+    gui->canvas = new TRootEmbeddedCanvas("canvas", gui, 1200, 600);
+    gui->AddFrame(gui->canvas, new TGLayoutHints(kLHintsExpandX | kLHintsExpandY, 10, 10, 10, 10));
+    gui->SetCleanup(kDeepCleanup);
+    gui->DontCallClose();
+
+    // Add canvases and histograms
+    add_canvases();
 
     gui->buttonGroups["DUTs"]->SetWidth(55);
     gui->buttonGroups["DUTs"]->SetHeight(8);
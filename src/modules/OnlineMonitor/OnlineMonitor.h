@@ -24,7 +24,14 @@
 #include <TROOT.h>
 #include <TRootEmbeddedCanvas.h>
 #include <TSystem.h>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "GuiDisplay.hpp"
 #include "core/module/Module.hpp"
@@ -37,14 +44,34 @@ namespace corryvreckan {
      */
     class OnlineMonitor : public Module {
 
+        /**
+         * @brief Operation mode of the monitor
+         */
+        enum class Mode {
+            GUI,     ///< Display the histograms in a GUI running in the reconstruction process
+            PUBLISH, ///< Publish snapshots of the histograms for the standalone viewer corry_monitor
+        };
+
+        /**
+         * @brief Histogram placed on one of the canvases
+         */
+        struct Plot {
+            std::string group;
+            std::string canvas;
+            TH1* histogram;
+            std::string style;
+            bool logy;
+        };
+
     public:
         // Constructors and destructors
         OnlineMonitor(Configuration& config, std::vector<std::shared_ptr<Detector>> detectors);
-        ~OnlineMonitor() {}
+        ~OnlineMonitor();
 
         // Functions
         void initialize() override;
         StatusCode run(const std::shared_ptr<Clipboard>& clipboard) override;
+        void finalize(const std::shared_ptr<ReadonlyClipboard>& clipboard) override;
 
         // Application to allow display persistancy
         TApplication* app = nullptr;
@@ -79,9 +106,31 @@ namespace corryvreckan {
         Matrix<std::string> canvas_dutplots, canvas_overview, canvas_tracking, canvas_hitmaps, canvas_residuals, canvas_cx,
             canvas_cy, canvas_cx2d, canvas_cy2d, canvas_charge, canvas_time;
 
+        // Publishing of snapshots
+        Mode mode_;
+        std::string publish_path_;
+        std::chrono::nanoseconds publish_interval_;
+        std::chrono::steady_clock::time_point last_publish_;
+        std::vector<Plot> plots_;
+        std::map<std::string, std::pair<std::string, std::string>> canvas_titles_;
+        std::thread writer_;
+        std::atomic<bool> writer_busy_{false};
+
         // Additional methods
+        void add_canvases();
         void gui_run();
         void gui_update();
+
+        /**
+         * @brief Serialize all plots and their canvas layout into an in-memory ROOT file and hand it to the writer thread
+         */
+        void publish();
+
+        /**
+         * @brief Replace the snapshot file by the given serialized ROOT file, called from the writer thread
+         * @param buffer Content of the in-memory ROOT file
+         */
+        void write_snapshot(const std::vector<char>& buffer) const;
     };
 } // namespace corryvreckan
 #endif // OnlineMonitor_H
@@ -0,0 +1,259 @@
+/**
+ * @file
+ * @brief Standalone viewer for the histogram snapshots published by the OnlineMonitor module
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <TFile.h>
+#include <TGButtonGroup.h>
+#include <TObjString.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GuiDisplay.hpp"
+#include "core/utils/log.h"
+
+using namespace corryvreckan;
+
+namespace {
+    std::atomic<bool> stop_viewer{false};
+
+    /**
+     * @brief Stop the viewer, also triggered by the exit button of the GUI
+     */
+    void interrupt_handler(int) { stop_viewer = true; }
+
+    /**
+     * @brief Histogram placed on one of the canvases, as listed in the layout of the snapshot
+     */
+    struct Plot {
+        std::string group;
+        std::string canvas;
+        std::string key;
+        std::string style;
+        bool logy;
+    };
+
+    /**
+     * @brief Parse the canvas layout stored alongside the histograms
+     * @param file Snapshot file
+     * @return List of all plots in the order they were added to the canvases
+     */
+    std::vector<Plot> read_layout(TFile& file) {
+        std::vector<Plot> plots;
+        auto* layout = file.Get<TObjString>("layout");
+        if(layout == nullptr) {
+            return plots;
+        }
+
+        std::istringstream lines(layout->GetString().Data());
+        std::string line;
+        while(std::getline(lines, line)) {
+            std::istringstream fields(line);
+            Plot plot;
+            std::string logy;
+            std::getline(fields, plot.group, '\t');
+            std::getline(fields, plot.canvas, '\t');
+            std::getline(fields, plot.key, '\t');
+            std::getline(fields, plot.style, '\t');
+            std::getline(fields, logy, '\t');
+            plot.logy = (logy == "1");
+            plots.push_back(plot);
+        }
+        return plots;
+    }
+
+    /**
+     * @brief Copy the content of the histograms of the latest snapshot into the displayed histograms
+     * @param path Path of the snapshot file
+     * @param histograms Displayed histograms by their key in the snapshot
+     * @return False if the snapshot could not be read
+     */
+    bool update_histograms(const std::string& path, std::map<std::string, TH1*>& histograms) {
+        std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "READ"));
+        if(!file || file->IsZombie()) {
+            return false;
+        }
+        for(auto& [key, histogram] : histograms) {
+            auto* snapshot = file->Get<TH1>(key.c_str());
+            if(snapshot != nullptr && snapshot->IsA() == histogram->IsA()) {
+                snapshot->Copy(*histogram);
+                histogram->SetDirectory(nullptr);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Print the command line help
+     */
+    void print_help() {
+        std::cout << "Viewer for the histograms published by the OnlineMonitor module of Corryvreckan" << std::endl;
+        std::cout << "Usage: corry_monitor [-f <file>] [-r <seconds>] [-t <title>]" << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  -f <file>     snapshot file set as publish_path of the module, defaults to "
+                     "/dev/shm/corryvreckan_monitor.root"
+                  << std::endl;
+        std::cout << "  -r <seconds>  refresh interval of the displayed histograms, defaults to 1" << std::endl;
+        std::cout << "  -t <title>    title of the GUI window" << std::endl;
+        std::cout << "  -h            print this help text" << std::endl;
+    }
+} // namespace
+
+/**
+ * @brief Main function running the viewer
+ */
+int main(int argc, const char* argv[]) {
+    Log::addStream(std::cout);
+
+    std::string path = "/dev/shm/corryvreckan_monitor.root";
+    std::string title = "Corryvreckan Testbeam Monitor";
+    double refresh = 1.;
+    for(int i = 1; i < argc; i++) {
+        std::string argument(argv[i]);
+        if(argument == "-h") {
+            print_help();
+            return 0;
+        } else if(argument == "-f" && (i + 1 < argc)) {
+            path = std::string(argv[++i]);
+        } else if(argument == "-r" && (i + 1 < argc)) {
+            refresh = std::stod(argv[++i]);
+        } else if(argument == "-t" && (i + 1 < argc)) {
+            title = std::string(argv[++i]);
+        } else {
+            LOG(ERROR) << "Unrecognized command line argument \"" << argument << "\"";
+            print_help();
+            return 1;
+        }
+    }
+    std::signal(SIGINT, interrupt_handler);
+
+    // Wait for the first snapshot to determine the layout of the canvases
+    LOG(STATUS) << "Waiting for monitoring snapshots in " << path;
+    while(!stop_viewer && !std::filesystem::exists(path)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if(stop_viewer) {
+        return 0;
+    }
+
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "READ"));
+    if(!file || file->IsZombie()) {
+        LOG(FATAL) << "Could not read monitoring snapshot " << path;
+        return 1;
+    }
+    auto plots = read_layout(*file);
+
+    // TApplication keeps the canvases persistent
+    TApplication app("corry_monitor", nullptr, nullptr);
+
+    auto* gui = new GuiDisplay(gClient->GetRoot(), 1200, 600);
+    gui->buttonMenu = new TGHorizontalFrame(gui, 1200, 50);
+    gui->canvas = new TRootEmbeddedCanvas("canvas", gui, 1200, 600);
+    gui->AddFrame(gui->canvas, new TGLayoutHints(kLHintsExpandX | kLHintsExpandY, 10, 10, 10, 10));
+    gui->SetCleanup(kDeepCleanup);
+    gui->DontCallClose();
+
+    // Add canvas groups, canvases and histograms in the order of the layout
+    std::map<std::string, TH1*> histograms;
+    std::string first_canvas;
+    for(const auto& plot : plots) {
+        if(gui->buttonGroups.find(plot.group) == gui->buttonGroups.end()) {
+            gui->buttonGroups[plot.group] = new TGVButtonGroup(gui->buttonMenu, plot.group.c_str());
+            gui->buttonMenu->AddFrame(gui->buttonGroups[plot.group],
+                                      new TGLayoutHints(kLHintsLeft | kLHintsTop, 10, 10, 10, 10));
+            gui->buttonGroups[plot.group]->Show();
+        }
+
+        std::string canvas_name = plot.canvas + "Canvas";
+        if(gui->buttons.find(plot.canvas) == gui->buttons.end()) {
+            gui->buttons[plot.canvas] = new TGTextButton(gui->buttonGroups[plot.group], plot.canvas.c_str());
+            gui->buttonGroups[plot.group]->AddFrame(gui->buttons[plot.canvas],
+                                                    new TGLayoutHints(kLHintsTop | kLHintsExpandX, 0, 0, 0, 0));
+            std::string command = "Display(=\"" + canvas_name + "\")";
+            gui->buttons[plot.canvas]->Connect("Pressed()", "corryvreckan::GuiDisplay", gui, command.c_str());
+            if(first_canvas.empty()) {
+                first_canvas = canvas_name;
+            }
+        }
+
+        // Histograms shown on several canvases are stored once in the snapshot
+        auto histogram = histograms.find(plot.key);
+        if(histogram == histograms.end()) {
+            auto* snapshot = file->Get<TH1>(plot.key.c_str());
+            if(snapshot == nullptr) {
+                LOG(WARNING) << "Histogram " << plot.key << " missing in monitoring snapshot";
+                continue;
+            }
+            snapshot->SetDirectory(nullptr);
+            histogram = histograms.emplace(plot.key, snapshot).first;
+        }
+        gui->histograms[canvas_name].push_back(histogram->second);
+        gui->logarithmic[histogram->second] = plot.logy;
+        gui->styles[histogram->second] = plot.style;
+    }
+    file.reset();
+
+    // Controls
+    gui->buttonGroups["Controls"] = new TGVButtonGroup(gui->buttonMenu, "Controls");
+    gui->buttonMenu->AddFrame(gui->buttonGroups["Controls"], new TGLayoutHints(kLHintsLeft | kLHintsTop, 10, 10, 10, 10));
+    gui->buttonGroups["Controls"]->Show();
+    ULong_t color;
+
+    gClient->GetColorByName("green", color);
+    gui->buttons["pause"] = new TGTextButton(gui->buttonGroups["Controls"], "   &Pause Monitoring   ");
+    gui->buttons["pause"]->ChangeBackground(color);
+    gui->buttons["pause"]->Connect("Pressed()", "corryvreckan::GuiDisplay", gui, "TogglePause()");
+    gui->buttonGroups["Controls"]->AddFrame(gui->buttons["pause"], new TGLayoutHints(kLHintsTop | kLHintsExpandX));
+
+    gClient->GetColorByName("yellow", color);
+    gui->buttons["exit"] = new TGTextButton(gui->buttonGroups["Controls"], "&Exit Monitor");
+    gui->buttons["exit"]->ChangeBackground(color);
+    gui->buttons["exit"]->Connect("Pressed()", "corryvreckan::GuiDisplay", gui, "Exit()");
+    gui->buttonGroups["Controls"]->AddFrame(gui->buttons["exit"], new TGLayoutHints(kLHintsTop | kLHintsExpandX));
+
+    gui->AddFrame(gui->buttonMenu, new TGLayoutHints(kLHintsLeft, 10, 10, 10, 10));
+    gui->SetWindowName(title.c_str());
+    gui->MapSubwindows();
+    gui->Resize(gui->GetDefaultSize());
+    gui->MapWindow();
+
+    if(!first_canvas.empty()) {
+        gui->Display(const_cast<char*>(first_canvas.c_str()));
+    }
+
+    // Reload the histograms whenever a new snapshot has been published
+    std::error_code error;
+    auto last_write = std::filesystem::last_write_time(path, error);
+    auto last_check = std::chrono::steady_clock::now();
+    auto interval = std::chrono::duration<double>(refresh);
+    while(!stop_viewer) {
+        gSystem->ProcessEvents();
+
+        auto now = std::chrono::steady_clock::now();
+        if(!gui->isPaused() && now - last_check >= interval) {
+            last_check = now;
+            auto write_time = std::filesystem::last_write_time(path, error);
+            if(!error && write_time != last_write && update_histograms(path, histograms)) {
+                last_write = write_time;
+                gui->Update();
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    return 0;
+}
@@ -15,6 +15,8 @@
 using namespace corryvreckan;
 using namespace std;
 
+std::map<std::string, bool> Prealignment::converged_;
+
 Prealignment::Prealignment(Configuration& config, std::shared_ptr<Detector> detector)
     : Module(config, detector), m_detector(detector) {
 
@@ -30,6 +32,9 @@ Prealignment::Prealignment(Configuration& config, std::shared_ptr<Detector> dete
     config_.setDefault<double>("time_binning", Units::get<double>(1, "ns"));
     config_.setDefault<int>("nbins_global", 1000);
     config_.setDefault<bool>("align_time", false);
+    config_.setDefault<double>("convergence_precision", 0.);
+    config_.setDefault<double>("convergence_time_precision", Units::get<double>(1, "ns"));
+    config_.setDefault<uint64_t>("convergence_interval", 1000);
 
     if(config_.count({"time_cut_rel", "time_cut_abs"}) == 0) {
         config_.setDefault("time_cut_rel", 3.0);
@@ -49,6 +54,16 @@ Prealignment::Prealignment(Configuration& config, std::shared_ptr<Detector> dete
     align_time_ = config_.get<bool>("align_time");
     time_binning_ = config_.get<double>("time_binning");
 
+    convergence_precision_ = config_.get<double>("convergence_precision");
+    convergence_time_precision_ = config_.get<double>("convergence_time_precision");
+    convergence_interval_ = config_.get<uint64_t>("convergence_interval");
+    if(convergence_precision_ < 0) {
+        throw InvalidValueError(config_, "convergence_precision", "Precision cannot be negative");
+    }
+    if(convergence_interval_ == 0) {
+        throw InvalidValueError(config_, "convergence_interval", "Interval has to be at least one event");
+    }
+
     LOG(DEBUG) << "Setting max_correlation_rms to : " << max_correlation_rms;
     LOG(DEBUG) << "Setting damping_factor to : " << damping_factor;
 }
@@ -120,10 +135,25 @@ void Prealignment::initialize() {
                               nbins_global / 10,
                               -1.0 * range_abs,
                               1.0 * range_abs);
+
+    // Register this plane for the online convergence check, planes which are not moved are converged from the start
+    if(convergence_precision_ > 0) {
+        bool is_fixed = std::find(fixed_planes_.begin(), fixed_planes_.end(), m_detector->getName()) != fixed_planes_.end();
+        converged_[m_detector->getName()] = (m_detector->isReference() || is_fixed);
+        LOG(INFO) << "Ending the run once all planes converged to a precision of "
+                  << Units::display(convergence_precision_, {"um", "mm"}) << ", checked every " << convergence_interval_
+                  << " events";
+    }
 }
 
 StatusCode Prealignment::run(const std::shared_ptr<Clipboard>& clipboard) {
 
+    // Periodically check if the correlation peaks of all planes are established well enough
+    if(convergence_precision_ > 0 && ++m_events % convergence_interval_ == 0 && check_convergence()) {
+        LOG(STATUS) << "Prealignment of all planes converged after " << m_events << " events, ending run";
+        return StatusCode::EndRun;
+    }
+
     // Get the clusters
     auto clusters = clipboard->getData<Cluster>(m_detector->getName());
     if(clusters.empty()) {
@@ -180,78 +210,11 @@ void Prealignment::finalize(const std::shared_ptr<ReadonlyClipboard>&) {
     if(!m_detector->isReference() && !is_fixed) {
         LOG(INFO) << "Running detector " << m_detector->getName();
 
-        double shift_X = 0.;
-        double shift_Y = 0.;
-        double shift_T = 0.;
-
         LOG(INFO) << "Using prealignment method: " << corryvreckan::to_string(method);
-        if(method == PrealignMethod::GAUSS_FIT) {
-            int binMaxX = correlationX->GetMaximumBin();
-            double fit_low_x =
-                correlationX->GetXaxis()->GetBinCenter(binMaxX) - m_detector->getSpatialResolution().x() * fit_range_rel;
-            double fit_high_x =
-                correlationX->GetXaxis()->GetBinCenter(binMaxX) + m_detector->getSpatialResolution().x() * fit_range_rel;
-
-            int binMaxY = correlationY->GetMaximumBin();
-            double fit_low_y =
-                correlationY->GetXaxis()->GetBinCenter(binMaxY) - m_detector->getSpatialResolution().y() * fit_range_rel;
-            double fit_high_y =
-                correlationY->GetXaxis()->GetBinCenter(binMaxY) + m_detector->getSpatialResolution().y() * fit_range_rel;
-
-            LOG(DEBUG) << "Fit range in x direction from: " << Units::display(fit_low_x, {"mm", "um"}) << " to "
-                       << Units::display(fit_high_x, {"mm", "um"});
-            LOG(DEBUG) << "Fit range in y direction from: " << Units::display(fit_low_y, {"mm", "um"}) << " to "
-                       << Units::display(fit_high_y, {"mm", "um"});
-
-            correlationX->Fit("gaus", "Q", "", fit_low_x, fit_high_x);
-            correlationY->Fit("gaus", "Q", "", fit_low_y, fit_high_y);
-
-            shift_X = correlationX->GetFunction("gaus")->GetParameter(1);
-            shift_Y = correlationY->GetFunction("gaus")->GetParameter(1);
-
-            if(align_time_) {
-                int binMaxTime = correlationTime_->GetMaximumBin();
-                double fit_low_t =
-                    correlationTime_->GetXaxis()->GetBinCenter(binMaxTime) - m_detector->getTimeResolution() * fit_range_rel;
-                double fit_high_t =
-                    correlationTime_->GetXaxis()->GetBinCenter(binMaxTime) + m_detector->getTimeResolution() * fit_range_rel;
-                correlationTime_->Fit("gaus", "Q", "", fit_low_t, fit_high_t);
-                shift_T = correlationTime_->GetFunction("gaus")->GetParameter(1);
-            }
-        } else if(method == PrealignMethod::MEAN) {
-            shift_X = correlationX->GetMean();
-            shift_Y = correlationY->GetMean();
-            if(align_time_) {
-                shift_T = correlationTime_->GetMean();
-            }
-        } else if(method == PrealignMethod::MAXIMUM) {
-            int binMaxX = correlationX->GetMaximumBin();
-            shift_X = correlationX->GetXaxis()->GetBinCenter(binMaxX);
-            int binMaxY = correlationY->GetMaximumBin();
-            shift_Y = correlationY->GetXaxis()->GetBinCenter(binMaxY);
-            if(align_time_) {
-                int binMaxTime = correlationTime_->GetMaximumBin();
-                shift_T = correlationTime_->GetXaxis()->GetBinCenter(binMaxTime);
-            }
-        } else if(method == PrealignMethod::MAXIMUM2D) {
-            int binMaxX1 = correlationX->GetMaximumBin();
-            TH1D* ProjY = correlationXY->ProjectionY("_py", binMaxX1 - 1, binMaxX1 + 1);
-            int binMaxY1 = ProjY->GetMaximumBin();
-            auto max1 = correlationXY->GetBinContent(binMaxX1, binMaxY1);
-
-            int binMaxY2 = correlationY->GetMaximumBin();
-            TH1D* ProjX = correlationXY->ProjectionX("_px", binMaxY2 - 1, binMaxY2 + 1);
-            int binMaxX2 = ProjX->GetMaximumBin();
-            auto max2 = correlationXY->GetBinContent(binMaxX2, binMaxY2);
-
-            if(max1 > max2) {
-                shift_X = correlationX->GetXaxis()->GetBinCenter(binMaxX1);
-                shift_Y = ProjY->GetXaxis()->GetBinCenter(binMaxY1);
-            } else {
-                shift_X = ProjX->GetXaxis()->GetBinCenter(binMaxX2);
-                shift_Y = correlationY->GetXaxis()->GetBinCenter(binMaxY2);
-            }
-        }
+        auto shifts = calculate_shifts(false);
+        double shift_X = shifts.x;
+        double shift_Y = shifts.y;
+        double shift_T = shifts.t;
 
         LOG(DEBUG) << "Shift (without damping factor)" << m_detector->getName()
                    << ": x = " << Units::display(shift_X, {"mm", "um"}) << " , y = " << Units::display(shift_Y, {"mm", "um"})
@@ -271,3 +234,127 @@ void Prealignment::finalize(const std::shared_ptr<ReadonlyClipboard>&) {
         m_detector->setTimeOffset(m_detector->timeOffset() + damping_factor * shift_T);
     }
 }
+
+Prealignment::Shifts Prealignment::calculate_shifts(bool intermediate) {
+    Shifts shifts;
+
+    if(method == PrealignMethod::GAUSS_FIT) {
+        int binMaxX = correlationX->GetMaximumBin();
+        double fit_low_x =
+            correlationX->GetXaxis()->GetBinCenter(binMaxX) - m_detector->getSpatialResolution().x() * fit_range_rel;
+        double fit_high_x =
+            correlationX->GetXaxis()->GetBinCenter(binMaxX) + m_detector->getSpatialResolution().x() * fit_range_rel;
+
+        int binMaxY = correlationY->GetMaximumBin();
+        double fit_low_y =
+            correlationY->GetXaxis()->GetBinCenter(binMaxY) - m_detector->getSpatialResolution().y() * fit_range_rel;
+        double fit_high_y =
+            correlationY->GetXaxis()->GetBinCenter(binMaxY) + m_detector->getSpatialResolution().y() * fit_range_rel;
+
+        LOG(DEBUG) << "Fit range in x direction from: " << Units::display(fit_low_x, {"mm", "um"}) << " to "
+                   << Units::display(fit_high_x, {"mm", "um"});
+        LOG(DEBUG) << "Fit range in y direction from: " << Units::display(fit_low_y, {"mm", "um"}) << " to "
+                   << Units::display(fit_high_y, {"mm", "um"});
+
+        correlationX->Fit("gaus", "Q", "", fit_low_x, fit_high_x);
+        correlationY->Fit("gaus", "Q", "", fit_low_y, fit_high_y);
+
+        shifts.x = correlationX->GetFunction("gaus")->GetParameter(1);
+        shifts.y = correlationY->GetFunction("gaus")->GetParameter(1);
+        shifts.error_x = correlationX->GetFunction("gaus")->GetParError(1);
+        shifts.error_y = correlationY->GetFunction("gaus")->GetParError(1);
+
+        if(align_time_) {
+            int binMaxTime = correlationTime_->GetMaximumBin();
+            double fit_low_t =
+                correlationTime_->GetXaxis()->GetBinCenter(binMaxTime) - m_detector->getTimeResolution() * fit_range_rel;
+            double fit_high_t =
+                correlationTime_->GetXaxis()->GetBinCenter(binMaxTime) + m_detector->getTimeResolution() * fit_range_rel;
+            correlationTime_->Fit("gaus", "Q", "", fit_low_t, fit_high_t);
+            shifts.t = correlationTime_->GetFunction("gaus")->GetParameter(1);
+            shifts.error_t = correlationTime_->GetFunction("gaus")->GetParError(1);
+        }
+    } else if(method == PrealignMethod::MEAN) {
+        shifts.x = correlationX->GetMean();
+        shifts.y = correlationY->GetMean();
+        shifts.error_x = correlationX->GetMeanError();
+        shifts.error_y = correlationY->GetMeanError();
+        if(align_time_) {
+            shifts.t = correlationTime_->GetMean();
+            shifts.error_t = correlationTime_->GetMeanError();
+        }
+    } else if(method == PrealignMethod::MAXIMUM) {
+        int binMaxX = correlationX->GetMaximumBin();
+        shifts.x = correlationX->GetXaxis()->GetBinCenter(binMaxX);
+        int binMaxY = correlationY->GetMaximumBin();
+        shifts.y = correlationY->GetXaxis()->GetBinCenter(binMaxY);
+        if(align_time_) {
+            int binMaxTime = correlationTime_->GetMaximumBin();
+            shifts.t = correlationTime_->GetXaxis()->GetBinCenter(binMaxTime);
+        }
+    } else if(method == PrealignMethod::MAXIMUM2D) {
+        int binMaxX1 = correlationX->GetMaximumBin();
+        TH1D* ProjY = correlationXY->ProjectionY("_py", binMaxX1 - 1, binMaxX1 + 1);
+        int binMaxY1 = ProjY->GetMaximumBin();
+        auto max1 = correlationXY->GetBinContent(binMaxX1, binMaxY1);
+
+        int binMaxY2 = correlationY->GetMaximumBin();
+        TH1D* ProjX = correlationXY->ProjectionX("_px", binMaxY2 - 1, binMaxY2 + 1);
+        int binMaxX2 = ProjX->GetMaximumBin();
+        auto max2 = correlationXY->GetBinContent(binMaxX2, binMaxY2);
+
+        if(max1 > max2) {
+            shifts.x = correlationX->GetXaxis()->GetBinCenter(binMaxX1);
+            shifts.y = ProjY->GetXaxis()->GetBinCenter(binMaxY1);
+        } else {
+            shifts.x = ProjX->GetXaxis()->GetBinCenter(binMaxX2);
+            shifts.y = correlationY->GetXaxis()->GetBinCenter(binMaxY2);
+        }
+
+        if(intermediate) {
+            delete ProjY;
+            delete ProjX;
+        }
+    }
+
+    return shifts;
+}
+
+bool Prealignment::check_convergence() {
+    auto& converged = converged_[m_detector->getName()];
+
+    // Planes which are not moved have converged from the start, and planes which converged already are not reevaluated
+    if(!converged) {
+        if(correlationX->GetEntries() > 0 && correlationY->GetEntries() > 0 &&
+           correlationX->GetRMS() <= max_correlation_rms && correlationY->GetRMS() <= max_correlation_rms) {
+            auto shifts = calculate_shifts(true);
+
+            // The uncertainty is estimated as the larger of the statistical uncertainty and the change of the shift since
+            // the previous check, since the maximum methods do not provide a statistical uncertainty
+            auto uncertainty = [](double error, double value, double previous) {
+                return std::max(error, std::fabs(value - previous));
+            };
+            if(has_previous_) {
+                auto uncertainty_x = uncertainty(shifts.error_x, shifts.x, previous_.x);
+                auto uncertainty_y = uncertainty(shifts.error_y, shifts.y, previous_.y);
+                auto uncertainty_t = uncertainty(shifts.error_t, shifts.t, previous_.t);
+                LOG(DEBUG) << "Detector " << m_detector->getName() << " after " << m_events
+                           << " events: x = " << Units::display(shifts.x, {"mm", "um"}) << " +- "
+                           << Units::display(uncertainty_x, {"mm", "um"})
+                           << ", y = " << Units::display(shifts.y, {"mm", "um"}) << " +- "
+                           << Units::display(uncertainty_y, {"mm", "um"});
+
+                converged = uncertainty_x < convergence_precision_ && uncertainty_y < convergence_precision_ &&
+                            (!align_time_ || uncertainty_t < convergence_time_precision_);
+                if(converged) {
+                    LOG(INFO) << "Prealignment of detector " << m_detector->getName() << " converged after " << m_events
+                              << " events";
+                }
+            }
+            previous_ = shifts;
+            has_previous_ = true;
+        }
+    }
+
+    return std::all_of(converged_.begin(), converged_.end(), [](const auto& plane) { return plane.second; });
+}
@@ -17,6 +17,7 @@
 #include <TH1F.h>
 #include <TH2F.h>
 #include <iostream>
+#include <map>
 #include "core/module/Module.hpp"
 #include "objects/Cluster.hpp"
 #include "objects/Pixel.hpp"
@@ -44,6 +45,31 @@ namespace corryvreckan {
         void finalize(const std::shared_ptr<ReadonlyClipboard>& clipboard) override;
 
     private:
+        /**
+         * @brief Estimated shifts of the detector with respect to the reference and their uncertainties
+         */
+        struct Shifts {
+            double x{};
+            double y{};
+            double t{};
+            double error_x{};
+            double error_y{};
+            double error_t{};
+        };
+
+        /**
+         * @brief Calculate the shifts from the current correlation histograms with the configured method
+         * @param intermediate If true, temporary projections are removed again and not stored in the output file
+         * @return Shifts and their statistical uncertainties, the uncertainty is zero if the method does not provide one
+         */
+        Shifts calculate_shifts(bool intermediate);
+
+        /**
+         * @brief Update the convergence state of this plane and check if all planes have converged
+         * @return True if the shifts of all prealigned planes are known to the requested precision
+         */
+        bool check_convergence();
+
         std::shared_ptr<Detector> m_detector;
 
         // Correlation plots
@@ -68,6 +94,17 @@ namespace corryvreckan {
         std::vector<std::string> fixed_planes_;
         bool align_time_;
         double time_binning_;
+
+        // Online prealignment with early termination
+        double convergence_precision_;
+        double convergence_time_precision_;
+        uint64_t convergence_interval_;
+        uint64_t m_events{};
+        bool has_previous_{false};
+        Shifts previous_;
+
+        // Convergence state of all prealignment instances, indexed by detector name
+        static std::map<std::string, bool> converged_;
     };
 } // namespace corryvreckan
 #endif // PREALIGNMENT_H
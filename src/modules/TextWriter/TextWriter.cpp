@@ -11,19 +11,78 @@
 
 #include "TextWriter.h"
 
+#include <charconv>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+
 using namespace corryvreckan;
 
+namespace {
+    // Append an integer value to the line without going through a stream
+    template <typename T> std::enable_if_t<std::is_integral<T>::value> append_number(std::string& line, T value) {
+        char buf[24];
+        auto res = std::to_chars(buf, buf + sizeof(buf), value);
+        line.append(buf, res.ptr);
+    }
+
+    // Append a floating point value in its shortest representation which reads back to the same value
+    void append_number(std::string& line, double value) {
+        char buf[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        auto res = std::to_chars(buf, buf + sizeof(buf), value);
+        line.append(buf, res.ptr);
+#else
+        auto len = std::snprintf(buf, sizeof(buf), "%.*g", std::numeric_limits<double>::max_digits10, value);
+        line.append(buf, static_cast<size_t>(len));
+#endif
+    }
+
+    // Append a text field, quoting it if it contains the separator, quotes or line breaks
+    void append_text(std::string& line, const std::string& text, char separator) {
+        if(text.find_first_of(std::string("\"\n\r") + separator) == std::string::npos) {
+            line += text;
+            return;
+        }
+        line += '"';
+        for(auto c : text) {
+            if(c == '"') {
+                line += "\"\"";
+            } else if(c == '\n' || c == '\r') {
+                line += ' ';
+            } else {
+                line += c;
+            }
+        }
+        line += '"';
+    }
+} // namespace
+
 TextWriter::TextWriter(Configuration& config, std::vector<std::shared_ptr<Detector>> detectors)
     : Module(config, std::move(detectors)) {}
 
 void TextWriter::initialize() {
 
-    // Create output file
     config_.setDefault<std::string>("file_name", "data");
-    output_file_name_ = createOutputFile(config_.get<std::string>("file_name"), "txt", true);
-    output_file_ = std::make_unique<std::ofstream>(output_file_name_);
+    config_.setDefault<OutputFormat>("format", OutputFormat::TEXT);
+    config_.setDefault<size_t>("buffer_size", 1 << 20);
 
-    *output_file_ << "# Corryvreckan ASCII data" << std::endl << std::endl;
+    format_ = config_.get<OutputFormat>("format");
+    separator_ = (format_ == OutputFormat::TSV ? '\t' : ',');
+    buffer_size_ = config_.get<size_t>("buffer_size");
+
+    // Create output file. For column formats, this is the file holding the event table, the object tables are created on
+    // first appearance of the respective type
+    if(format_ == OutputFormat::TEXT) {
+        output_file_name_ = createOutputFile(config_.get<std::string>("file_name"), "txt", true);
+        output_file_ = open_stream(output_file_name_);
+        output_file_->stream << "# Corryvreckan ASCII data\n\n";
+    } else {
+        auto extension = (format_ == OutputFormat::TSV ? "tsv" : "csv");
+        output_file_name_ = createOutputFile(config_.get<std::string>("file_name") + "_Event", extension, true);
+        output_file_ = open_stream(output_file_name_);
+        output_file_->stream << "event" << separator_ << "start" << separator_ << "end" << separator_ << "triggers\n";
+    }
 
     // Read include and exclude list
     if(config_.has("include") && config_.has("exclude")) {
@@ -40,6 +99,143 @@ void TextWriter::initialize() {
     m_eventNumber = 0;
 }
 
+std::unique_ptr<TextWriter::OutputStream> TextWriter::open_stream(const std::string& file_name) const {
+    auto output = std::make_unique<OutputStream>();
+
+    // The buffer has to be installed before the file is opened to be used by all implementations
+    if(buffer_size_ > 0) {
+        output->buffer.resize(buffer_size_);
+        output->stream.rdbuf()->pubsetbuf(output->buffer.data(), static_cast<std::streamsize>(output->buffer.size()));
+    }
+    output->stream.open(file_name);
+    if(!output->stream.good()) {
+        throw ModuleError("Cannot open output file \"" + file_name + "\"");
+    }
+    return output;
+}
+
+std::ofstream& TextWriter::get_table(const std::type_index& type_idx, const std::string& class_name) {
+    auto it = tables_.find(type_idx);
+    if(it != tables_.end()) {
+        return it->second->stream;
+    }
+
+    auto extension = (format_ == OutputFormat::TSV ? "tsv" : "csv");
+    auto file_name = createOutputFile(config_.get<std::string>("file_name") + "_" + class_name, extension, true);
+    LOG(DEBUG) << "Creating table for objects of type \"" << class_name << "\": " << file_name;
+    auto output = open_stream(file_name);
+
+    std::vector<std::string> columns{"event", "detector"};
+    if(type_idx == typeid(Pixel)) {
+        columns.insert(columns.end(), {"column", "row", "raw", "charge", "timestamp"});
+    } else if(type_idx == typeid(Cluster)) {
+        columns.insert(columns.end(),
+                       {"column",
+                        "row",
+                        "local_x",
+                        "local_y",
+                        "global_x",
+                        "global_y",
+                        "global_z",
+                        "charge",
+                        "size",
+                        "width_x",
+                        "width_y",
+                        "split",
+                        "timestamp"});
+    } else if(type_idx == typeid(Track)) {
+        columns.insert(columns.end(), {"type", "chi2", "ndof", "clusters", "timestamp"});
+    } else {
+        columns.insert(columns.end(), {"timestamp", "description"});
+    }
+
+    std::string header;
+    for(const auto& column : columns) {
+        if(!header.empty()) {
+            header += separator_;
+        }
+        header += column;
+    }
+    output->stream << header << '\n';
+
+    return tables_.emplace(type_idx, std::move(output)).first->second->stream;
+}
+
+void TextWriter::write_rows(std::ofstream& out,
+                            const std::type_index& type_idx,
+                            const std::string& detector_name,
+                            const ObjectVector& objects) {
+
+    // Common prefix of all rows of this block
+    std::string prefix;
+    append_number(prefix, m_eventNumber);
+    prefix += separator_;
+    append_text(prefix, detector_name, separator_);
+
+    for(const auto& object : objects) {
+        line_ = prefix;
+        line_ += separator_;
+
+        if(type_idx == typeid(Pixel)) {
+            auto pixel = static_cast<const Pixel*>(object.get());
+            append_number(line_, pixel->column());
+            line_ += separator_;
+            append_number(line_, pixel->row());
+            line_ += separator_;
+            append_number(line_, pixel->raw());
+            line_ += separator_;
+            append_number(line_, pixel->charge());
+            line_ += separator_;
+            append_number(line_, pixel->timestamp());
+        } else if(type_idx == typeid(Cluster)) {
+            auto cluster = static_cast<const Cluster*>(object.get());
+            auto local = cluster->local();
+            auto global = cluster->global();
+            for(auto value : {cluster->column(),
+                              cluster->row(),
+                              local.x(),
+                              local.y(),
+                              global.x(),
+                              global.y(),
+                              global.z(),
+                              cluster->charge()}) {
+                append_number(line_, value);
+                line_ += separator_;
+            }
+            append_number(line_, cluster->size());
+            line_ += separator_;
+            append_number(line_, cluster->columnWidth());
+            line_ += separator_;
+            append_number(line_, cluster->rowWidth());
+            line_ += separator_;
+            append_number(line_, static_cast<int>(cluster->isSplit()));
+            line_ += separator_;
+            append_number(line_, cluster->timestamp());
+        } else if(type_idx == typeid(Track)) {
+            auto track = static_cast<const Track*>(object.get());
+            append_text(line_, track->getType(), separator_);
+            line_ += separator_;
+            append_number(line_, track->getChi2());
+            line_ += separator_;
+            append_number(line_, track->getNdof());
+            line_ += separator_;
+            append_number(line_, track->getNClusters());
+            line_ += separator_;
+            append_number(line_, track->timestamp());
+        } else {
+            // Fall back to the generic print method for all other objects
+            append_number(line_, object->timestamp());
+            line_ += separator_;
+            std::ostringstream description;
+            object->print(description);
+            append_text(line_, description.str(), separator_);
+        }
+
+        line_ += '\n';
+        out.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+    }
+}
+
 StatusCode TextWriter::run(const std::shared_ptr<Clipboard>& clipboard) {
 
     if(!clipboard->isEventDefined()) {
@@ -47,8 +243,23 @@ StatusCode TextWriter::run(const std::shared_ptr<Clipboard>& clipboard) {
     }
 
     // Print the current event:
-    *output_file_ << "=== " << m_eventNumber << " ===" << std::endl;
-    *output_file_ << *clipboard->getEvent() << std::endl;
+    auto event = clipboard->getEvent();
+    auto& output = output_file_->stream;
+    if(format_ == OutputFormat::TEXT) {
+        output << "=== " << m_eventNumber << " ===\n";
+        output << *event << '\n';
+    } else {
+        line_.clear();
+        append_number(line_, m_eventNumber);
+        line_ += separator_;
+        append_number(line_, event->start());
+        line_ += separator_;
+        append_number(line_, event->end());
+        line_ += separator_;
+        append_number(line_, event->triggerList().size());
+        line_ += '\n';
+        output.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+    }
 
     auto data = clipboard->getAll();
     LOG(DEBUG) << "Clipboard has " << data.size() << " different object types.";
@@ -77,11 +288,14 @@ StatusCode TextWriter::run(const std::shared_ptr<Clipboard>& clipboard) {
                     detector_name = "<global>";
                 }
 
-                *output_file_ << "--- " << detector_name << " ---" << std::endl;
-
                 auto objects = std::static_pointer_cast<ObjectVector>(detector_block.second);
-                for(auto& object : *objects) {
-                    *output_file_ << *object << std::endl;
+                if(format_ == OutputFormat::TEXT) {
+                    output << "--- " << detector_name << " ---\n";
+                    for(auto& object : *objects) {
+                        output << *object << '\n';
+                    }
+                } else {
+                    write_rows(get_table(type_idx, class_name), type_idx, detector_name, *objects);
                 }
             }
         } catch(...) {
@@ -99,5 +313,11 @@ StatusCode TextWriter::run(const std::shared_ptr<Clipboard>& clipboard) {
 
 void TextWriter::finalize(const std::shared_ptr<ReadonlyClipboard>&) {
 
+    // Flush remaining buffered data, the streams have not been flushed during the run
+    output_file_->stream.close();
+    for(auto& table : tables_) {
+        table.second->stream.close();
+    }
+
     LOG(DEBUG) << "Analysed " << m_eventNumber << " events";
 }
@@ -16,7 +16,10 @@
 #include <TCanvas.h>
 #include <TH1F.h>
 #include <TH2F.h>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <typeindex>
 #include "core/module/Module.hpp"
 #include "objects/Cluster.hpp"
 #include "objects/Pixel.hpp"
@@ -26,11 +29,22 @@ namespace corryvreckan {
     /** @ingroup Modules
      * @brief Module to write objects into a text file
      *
-     * Loops over the selected objects and writes them into a text file in ASCII format.
+     * Loops over the selected objects and writes them into a text file in ASCII format. Output is written through a large
+     * stream buffer without flushing after every line. In the column formats, one file per object type is created and
+     * numeric values are formatted directly into a line buffer.
      */
     class TextWriter : public Module {
 
     public:
+        /**
+         * @brief Output layout of the written text data
+         */
+        enum class OutputFormat {
+            TEXT, ///< Human-readable event blocks using the print() method of the objects
+            CSV,  ///< One comma-separated table per object type
+            TSV,  ///< One tab-separated table per object type
+        };
+
         /**
          * @brief Constructor for this unique module
          * @param config Configuration object for this module as retrieved from the steering file
@@ -50,20 +64,64 @@ namespace corryvreckan {
         StatusCode run(const std::shared_ptr<Clipboard>& clipboard) override;
 
         /**
-         * @brief No specific actions implemented
+         * @brief Flushes and closes all output files
          */
         void finalize(const std::shared_ptr<ReadonlyClipboard>& clipboard) override;
 
     private:
+        /**
+         * @brief Output file with its own stream buffer
+         */
+        struct OutputStream {
+            std::vector<char> buffer;
+            std::ofstream stream;
+        };
+
+        /**
+         * @brief Open a new output file with an attached stream buffer of the configured size
+         * @param file_name Full path of the file to open
+         * @return Opened output stream
+         */
+        std::unique_ptr<OutputStream> open_stream(const std::string& file_name) const;
+
+        /**
+         * @brief Get the column output stream for a given object type, creating the file and its header on first access
+         * @param type_idx Type of the objects to be written
+         * @param class_name Demangled name of the object type
+         * @return Output stream for this object type
+         */
+        std::ofstream& get_table(const std::type_index& type_idx, const std::string& class_name);
+
+        /**
+         * @brief Write all objects of one detector block as rows of the table for their type
+         * @param out Output stream of the table
+         * @param type_idx Type of the objects to be written
+         * @param detector_name Name of the detector the objects belong to
+         * @param objects Objects to be written
+         */
+        void write_rows(std::ofstream& out,
+                        const std::type_index& type_idx,
+                        const std::string& detector_name,
+                        const ObjectVector& objects);
+
         int m_eventNumber;
 
         // Object names to include or exclude from writing
         std::set<std::string> include_;
         std::set<std::string> exclude_;
 
+        // Output configuration
+        OutputFormat format_;
+        char separator_;
+        size_t buffer_size_;
+
         // Output data file to write
         std::string output_file_name_{};
-        std::unique_ptr<std::ofstream> output_file_;
+        std::unique_ptr<OutputStream> output_file_;
+
+        // Column output files, one per object type
+        std::map<std::type_index, std::unique_ptr<OutputStream>> tables_;
+        std::string line_;
     };
 
 } // namespace corryvreckan
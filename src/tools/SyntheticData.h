@@ -0,0 +1,266 @@
+/**
+ * @file
+ * @brief Seeded generators of synthetic pixels, clusters and tracks
+ *
+ * @copyright Copyright (c) 2024 CERN and the Corryvreckan authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CORRYVRECKAN_SYNTHETIC_DATA_H
+#define CORRYVRECKAN_SYNTHETIC_DATA_H 1
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Math/Point3D.h>
+#include <Math/Vector3D.h>
+
+#include "core/detector/Detector.hpp"
+#include "objects/Cluster.hpp"
+#include "objects/Pixel.hpp"
+#include "objects/Track.hpp"
+
+namespace corryvreckan {
+    /**
+     * @brief Generator of reproducible synthetic data for a telescope of detectors
+     *
+     * Particles cross all detectors along straight lines, starting from a Gaussian beam spot in the plane at z = 0 with
+     * Gaussian slopes and uniformly distributed in time. All data are derived from these particles: pixels at the
+     * intercepts with charge sharing to the direct neighbours, clusters at the smeared intercepts and tracks combining the
+     * clusters of one particle. All random numbers are drawn in a fixed order from a single engine, the data only depend on
+     * the seed and the calls made.
+     */
+    class SyntheticData {
+    public:
+        /**
+         * @brief Straight particle trajectory
+         */
+        struct Particle {
+            ROOT::Math::XYZPoint origin;
+            ROOT::Math::XYZVector direction;
+            double timestamp;
+        };
+
+        /**
+         * @brief Set up the generator for a setup of detectors
+         * @param detectors Detectors crossed by the particles, auxiliary and passive detectors are skipped
+         * @param seed Seed of the random number engine
+         */
+        SyntheticData(std::vector<std::shared_ptr<Detector>> detectors, uint64_t seed) : random_engine_(seed) {
+            for(auto& detector : detectors) {
+                if(!detector->isAuxiliary() && !detector->isPassive()) {
+                    detectors_.push_back(std::move(detector));
+                }
+            }
+        }
+
+        /**
+         * @brief Set the beam parameters
+         * @param size Width of the Gaussian beam spot in x and y
+         * @param divergence Width of the Gaussian distribution of the particle slopes
+         */
+        void setBeam(double size, double divergence) {
+            beam_size_ = size;
+            beam_divergence_ = divergence;
+        }
+
+        /**
+         * @brief Set the width of the Gaussian smearing of all pixel and cluster timestamps
+         */
+        void setTimeResolution(double resolution) { time_resolution_ = resolution; }
+
+        /**
+         * @brief Detectors receiving data
+         */
+        const std::vector<std::shared_ptr<Detector>>& detectors() const { return detectors_; }
+
+        /**
+         * @brief Draw a Poisson-distributed number
+         * @param mean Mean of the distribution, zero is returned for non-positive values
+         */
+        size_t poisson(double mean) {
+            return mean > 0 ? static_cast<size_t>(std::poisson_distribution<int>(mean)(random_engine_)) : 0;
+        }
+
+        /**
+         * @brief Generate particles within a time frame
+         * @param count Number of particles
+         * @param start Begin of the time frame
+         * @param end End of the time frame
+         * @return Particles ordered by their time
+         */
+        std::vector<Particle> particles(size_t count, double start, double end) {
+            std::uniform_real_distribution<double> time(start, end);
+            std::vector<Particle> result;
+            result.reserve(count);
+            for(size_t i = 0; i < count; ++i) {
+                // The evaluation order of function arguments is unspecified, draw the random numbers one by one
+                auto x = beam_size_ * gauss_(random_engine_);
+                auto y = beam_size_ * gauss_(random_engine_);
+                auto slope_x = beam_divergence_ * gauss_(random_engine_);
+                auto slope_y = beam_divergence_ * gauss_(random_engine_);
+                result.push_back({{x, y, 0.}, {slope_x, slope_y, 1.}, time(random_engine_)});
+            }
+            std::sort(result.begin(), result.end(), [](const Particle& a, const Particle& b) {
+                return a.timestamp < b.timestamp;
+            });
+            return result;
+        }
+
+        /**
+         * @brief Generate the pixels fired by particles in a detector
+         * @param detector Detector to generate pixels for
+         * @param particles Particles crossing the detector
+         * @param charge_sharing Probability of each direct neighbour of the intercepted pixel to fire
+         * @return Pixels within the matrix of the detector which are not masked
+         */
+        PixelVector pixels(const Detector& detector, const std::vector<Particle>& particles, double charge_sharing = 0.3) {
+            std::bernoulli_distribution shared(charge_sharing);
+            PixelVector result;
+            for(const auto& particle : particles) {
+                auto [column, row] = detector.getInterceptPixel(intercept(detector, particle));
+                if(!detector.isWithinMatrix(column, row)) {
+                    continue;
+                }
+                add_pixel(result, detector, column, row, particle.timestamp);
+                for(const auto& [dc, dr] : {std::pair(-1, 0), std::pair(1, 0), std::pair(0, -1), std::pair(0, 1)}) {
+                    if(shared(random_engine_)) {
+                        add_pixel(result, detector, column + dc, row + dr, particle.timestamp);
+                    }
+                }
+            }
+            return result;
+        }
+
+        /**
+         * @brief Add noise hits distributed uniformly over the matrix of a detector and a time frame
+         * @param pixels Pixels of the detector the noise hits are added to
+         * @param detector Detector to generate noise hits for
+         * @param count Number of noise hits, before masked pixels are removed
+         * @param start Begin of the time frame
+         * @param end End of the time frame
+         */
+        void noise(PixelVector& pixels, const Detector& detector, size_t count, double start, double end) {
+            auto n_pixels = detector.nPixels();
+            std::uniform_int_distribution<int> column(0, std::max(n_pixels.X() - 1, 0));
+            std::uniform_int_distribution<int> row(0, std::max(n_pixels.Y() - 1, 0));
+            std::uniform_real_distribution<double> time(start, end);
+            for(size_t i = 0; i < count; ++i) {
+                auto hit_column = column(random_engine_);
+                auto hit_row = row(random_engine_);
+                add_pixel(pixels, detector, hit_column, hit_row, time(random_engine_));
+            }
+        }
+
+        /**
+         * @brief Generate the clusters of particles in a detector
+         * @param detector Detector to generate clusters for
+         * @param particles Particles crossing the detector
+         * @return Clusters at the intercepts smeared with the spatial resolution, one per particle within the matrix
+         */
+        ClusterVector clusters(const Detector& detector, const std::vector<Particle>& particles) {
+            auto resolution = detector.getSpatialResolution();
+            ClusterVector result;
+            for(const auto& particle : particles) {
+                auto local = intercept(detector, particle);
+                auto dx = resolution.X() * gauss_(random_engine_);
+                auto dy = resolution.Y() * gauss_(random_engine_);
+                auto dt = time_resolution_ * gauss_(random_engine_);
+                local.SetXYZ(local.X() + dx, local.Y() + dy, 0.);
+
+                auto column = detector.getColumn(local);
+                auto row = detector.getRow(local);
+                if(!detector.isWithinMatrix(static_cast<int>(std::lround(column)), static_cast<int>(std::lround(row)))) {
+                    continue;
+                }
+
+                auto cluster = std::make_shared<Cluster>();
+                cluster->setDetectorID(detector.getName());
+                cluster->setTimestamp(particle.timestamp + dt);
+                cluster->setColumn(column);
+                cluster->setRow(row);
+                cluster->setCharge(1.);
+                cluster->setError(detector.getSpatialResolution(column, row));
+                cluster->setErrorMatrixGlobal(detector.getSpatialResolutionMatrixGlobal(column, row));
+                cluster->setClusterCentreLocal(local);
+                cluster->setClusterCentre(detector.localToGlobal(local));
+                result.push_back(std::move(cluster));
+            }
+            return result;
+        }
+
+        /**
+         * @brief Generate tracks, ready to be fitted, from the clusters of particles in all detectors
+         * @param model Track model, see \ref Track::Factory
+         * @param particles Particles to generate tracks for
+         * @param clusters Storage for the generated clusters, which are referenced by the tracks
+         * @return One track per particle with clusters in at least two detectors
+         */
+        TrackVector
+        tracks(const std::string& model, const std::vector<Particle>& particles, std::vector<ClusterVector>& clusters) {
+            TrackVector result;
+            for(const auto& particle : particles) {
+                auto track = Track::Factory(model);
+                track->setParticleMomentum(momentum_);
+                track->setTimestamp(particle.timestamp);
+
+                ClusterVector track_clusters;
+                for(const auto& detector : detectors_) {
+                    track->registerPlane(
+                        detector->getName(), detector->displacement().z(), detector->materialBudget(), detector->toLocal());
+                    auto cluster = this->clusters(*detector, {particle});
+                    if(!cluster.empty()) {
+                        track->addCluster(cluster.front().get());
+                        track_clusters.push_back(cluster.front());
+                    }
+                }
+                if(track_clusters.size() >= 2) {
+                    clusters.push_back(std::move(track_clusters));
+                    result.push_back(std::move(track));
+                }
+            }
+            return result;
+        }
+
+    private:
+        /**
+         * @brief Local intercept of a particle with the detector plane
+         */
+        static ROOT::Math::XYZPoint intercept(const Detector& detector, const Particle& particle) {
+            auto normal = detector.normal();
+            auto distance = normal.Dot(detector.displacement() - particle.origin) / normal.Dot(particle.direction);
+            return detector.globalToLocal(particle.origin + distance * particle.direction);
+        }
+
+        /**
+         * @brief Add a pixel with smeared timestamp if it is within the matrix of the detector and not masked
+         */
+        void add_pixel(PixelVector& pixels, const Detector& detector, int column, int row, double timestamp) {
+            if(!detector.isWithinMatrix(column, row) || detector.masked(column, row)) {
+                return;
+            }
+            auto smeared = timestamp + time_resolution_ * gauss_(random_engine_);
+            pixels.push_back(std::make_shared<Pixel>(detector.getName(), column, row, 1, 1., smeared));
+        }
+
+        std::vector<std::shared_ptr<Detector>> detectors_;
+        std::mt19937_64 random_engine_;
+        std::normal_distribution<double> gauss_{0., 1.};
+
+        // Beam parameters in internal units
+        double beam_size_{2.};
+        double beam_divergence_{1e-4};
+        double time_resolution_{1.};
+        double momentum_{120e3};
+    };
+} // namespace corryvreckan
+
+#endif // CORRYVRECKAN_SYNTHETIC_DATA_H